@@ -11,6 +11,7 @@
 #include <assert.h>
 #include <time.h>
 #include "http.h"
+#include "timer.h"
 
 #define NLOOP   1000000
 
@@ -33,13 +34,14 @@ static void parse_request( void )
     size_t len = sizeof( req ) + 1;
     uint64_t i = 0;
     int rc = 0;
-    float start = 0, end = 0, elapsed = 0;
+    uint64_t start = 0;
+    double elapsed = 0;
     uint16_t maxurilen = UINT16_MAX;
     uint16_t maxhdrlen = UINT16_MAX;
     uint8_t nheader = 20;
     http_t *r = http_alloc( nheader );
 
-    start = (float)clock()/CLOCKS_PER_SEC;
+    start = timer_ns();
     for( i = 0; i < NLOOP; i++ ){
         rc = http_parse_request( r, req, len, maxurilen, maxhdrlen );
         assert( rc == HTTP_SUCCESS );
@@ -49,8 +51,7 @@ static void parse_request( void )
         //keys( r, req );
         http_init( r );
     }
-    end = (float)clock()/CLOCKS_PER_SEC;
-    elapsed = end - start;
+    elapsed = (double)( timer_ns() - start ) / 1e9;
 
     http_free( r );
 
@@ -86,11 +87,12 @@ static void parse_response( void )
     size_t len = sizeof( res );
     uint64_t i = 0;
     int rc = 0;
-    float start = 0, end = 0, elapsed = 0;
+    uint64_t start = 0;
+    double elapsed = 0;
     uint16_t maxhdrlen = UINT16_MAX;
     http_t *r = http_alloc(20);
 
-    start = (float)clock()/CLOCKS_PER_SEC;
+    start = timer_ns();
     for( i = 0; i < NLOOP; i++ ){
         rc = http_parse_response( r, res, len, maxhdrlen );
         assert( rc == HTTP_SUCCESS );
@@ -99,8 +101,7 @@ static void parse_response( void )
         assert( r->nheader == 19 );
         http_init( r );
     }
-    end = (float)clock()/CLOCKS_PER_SEC;
-    elapsed = end - start;
+    elapsed = (double)( timer_ns() - start ) / 1e9;
 
     http_free( r );
 
@@ -0,0 +1,342 @@
+/**
+ *  bench_corpus.c
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  parses each entry of the header corpus many times and reports ns/request,
+ *  cycles/byte and GB/s of the entry and of each phase.
+ *
+ *  the cost of a phase is measured as the difference between the parse of
+ *  the head truncated at the end of the phase and the parse of the head
+ *  truncated at the end of the previous phase.
+ *
+ *  each measurement is also wrapped by the hardware performance counters
+ *  (instructions, cycles, branch-misses and L1d read misses) that are
+ *  reported per request and per byte. -j prints the results as JSON to
+ *  track the regressions over time. -e selects the parse engine.
+ *
+ *  usage: bench_corpus [-j] [-e engine] [-n iterations] [-d corpus-dir]
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "http.h"
+#include "corpus.h"
+#include "timer.h"
+#include "perf.h"
+
+#ifndef CORPUS_DIR
+#define CORPUS_DIR  "corpus"
+#endif
+
+#define NPHASE  4
+
+static const char *REQ_PHASES[NPHASE] = {
+    "method", "uri", "version", "headers"
+};
+static const char *RES_PHASES[NPHASE] = {
+    "version", "status", "reason", "headers"
+};
+
+static const char *ENGINES[] = {
+    "state", "index", "dfa", NULL
+};
+
+
+typedef struct {
+    uint64_t ns;
+    uint64_t cycles;
+    perf_sample_t perf;
+} sample_t;
+
+
+typedef struct {
+    perf_t perf;
+    unsigned available;
+    int engine;
+    uint64_t n;
+    int json;
+    int nprinted;
+} bench_t;
+
+
+static inline int parse( http_t *h, int isreq, char *buf, size_t len )
+{
+    if( isreq ){
+        return http_parse_request( h, buf, len, UINT16_MAX, UINT16_MAX );
+    }
+    return http_parse_response( h, buf, len, UINT16_MAX );
+}
+
+
+static int measure( bench_t *b, http_t *h, int isreq, char *buf, size_t len,
+                    sample_t *s )
+{
+    uint64_t t = 0, c = 0;
+    uint64_t i = 0;
+    int rc = 0;
+
+    // warm up
+    http_setengine( h, b->engine );
+    http_init( h );
+    rc = parse( h, isreq, buf, len );
+
+    perf_start( &b->perf );
+    t = timer_ns();
+    c = timer_cycles();
+    for(; i < b->n; i++ ){
+        http_init( h );
+        parse( h, isreq, buf, len );
+    }
+    s->cycles = timer_cycles() - c;
+    s->ns = timer_ns() - t;
+    perf_stop( &b->perf, &s->perf );
+
+    return rc;
+}
+
+
+static inline uint64_t diff( uint64_t a, uint64_t b )
+{
+    return a > b ? a - b : 0;
+}
+
+
+static void sample_diff( sample_t *s, const sample_t *a, const sample_t *b )
+{
+    int i = 0;
+
+    s->ns = diff( a->ns, b->ns );
+    s->cycles = diff( a->cycles, b->cycles );
+    s->perf.available = a->perf.available;
+    for(; i < PERF_NCOUNTER; i++ ){
+        s->perf.value[i] = diff( a->perf.value[i], b->perf.value[i] );
+    }
+}
+
+
+/**
+ * end position of each phase
+ */
+static void phase_bounds( http_t *h, const corpus_entry_t *e,
+                          size_t bounds[NPHASE] )
+{
+    char *eol = memchr( e->buf, '\n', e->len );
+
+    if( e->isreq ){
+        // method SP
+        bounds[0] = h->msg;
+        // uri SP
+        bounds[1] = h->msg + h->msglen + 1;
+    }
+    else {
+        // version SP
+        bounds[0] = 9;
+        // status SP
+        bounds[1] = h->msg;
+    }
+    // end of the first line
+    bounds[2] = (size_t)( eol - e->buf ) + 1;
+    bounds[3] = h->cur;
+}
+
+
+static void print_row( bench_t *b, const char *name, int isphase,
+                       size_t len, const sample_t *s )
+{
+    double n = (double)b->n;
+    double ns = (double)s->ns / n;
+    double bytes = len ? (double)len : 1;
+    int i = 0;
+
+    if( !b->json )
+    {
+        printf( "%s%-*s %6zu %10.1f %10.2f %8.2f", isphase ? "  " : "",
+                isphase ? 22 : 24, name, len, ns,
+                (double)s->cycles / n / bytes, ns > 0 ? (double)len / ns : 0 );
+        for(; i < PERF_NCOUNTER; i++ )
+        {
+            if( b->available & ( 1U << i ) ){
+                printf( " %10.2f %8.3f", (double)s->perf.value[i] / n,
+                        (double)s->perf.value[i] / n / bytes );
+            }
+        }
+        printf( "\n" );
+        return;
+    }
+
+    printf( "%s{\"name\": \"%s\", \"bytes\": %zu, \"ns_per_req\": %.3f, "
+            "\"cycles_per_byte\": %.4f, \"gbps\": %.4f, \"counters\": {",
+            b->nprinted++ ? ",\n    " : "\n    ", name, len, ns,
+            (double)s->cycles / n / bytes, ns > 0 ? (double)len / ns : 0 );
+    for(; i < PERF_NCOUNTER; i++ )
+    {
+        printf( "%s\"%s\": ", i ? ", " : "", PERF_NAMES[i] );
+        if( s->perf.available & ( 1U << i ) ){
+            printf( "{\"per_req\": %.3f, \"per_byte\": %.4f}",
+                    (double)s->perf.value[i] / n,
+                    (double)s->perf.value[i] / n / bytes );
+        }
+        else {
+            printf( "null" );
+        }
+    }
+    printf( "}" );
+    if( !isphase ){
+        printf( ", \"type\": \"%s\", \"phases\": [",
+                strncmp( name, "req", 3 ) ? "response" : "request" );
+        b->nprinted = 0;
+    }
+    else {
+        printf( "}" );
+    }
+}
+
+
+static int bench_entry( bench_t *b, http_t *h, const corpus_entry_t *e )
+{
+    const char **names = e->isreq ? REQ_PHASES : RES_PHASES;
+    size_t bounds[NPHASE];
+    sample_t total, prev, s, phase;
+    char *buf = malloc( e->len + 1 );
+    int nprinted = b->nprinted;
+    int rc = 0;
+    int i = 0;
+
+    if( !buf ){
+        perror( "malloc" );
+        return -1;
+    }
+
+    rc = measure( b, h, e->isreq, e->buf, e->len, &total );
+    if( rc != HTTP_SUCCESS ){
+        fprintf( stderr, "%s: failed to parse: %d\n", e->name, rc );
+        free( (void*)buf );
+        return -1;
+    }
+    print_row( b, e->name, 0, e->len, &total );
+
+    phase_bounds( h, e, bounds );
+    memset( &prev, 0, sizeof( prev ) );
+    for( i = 0; i < NPHASE; i++ )
+    {
+        // truncate at the end of the phase
+        memcpy( buf, e->buf, bounds[i] );
+        buf[bounds[i]] = 0;
+        measure( b, h, e->isreq, buf, bounds[i], &s );
+
+        sample_diff( &phase, &s, &prev );
+        print_row( b, names[i], 1, bounds[i] - ( i ? bounds[i - 1] : 0 ),
+                   &phase );
+        prev = s;
+    }
+    if( b->json ){
+        printf( "\n    ]}" );
+        b->nprinted = nprinted + 1;
+    }
+    free( (void*)buf );
+
+    return 0;
+}
+
+
+int main( int argc, char *argv[] )
+{
+    const char *dir = CORPUS_DIR;
+    bench_t b = {
+        .engine = HTTP_ENGINE_STATE,
+        .n = 200000,
+        .json = 0,
+        .nprinted = 0
+    };
+    corpus_t c;
+    http_t *h = http_alloc( UINT8_MAX );
+    size_t i = 0;
+    int opt = 0;
+    int rc = EXIT_SUCCESS;
+
+    while( ( opt = getopt( argc, argv, "je:n:d:" ) ) != -1 )
+    {
+        switch( opt ){
+            case 'j':
+                b.json = 1;
+            break;
+            case 'e':
+                for( b.engine = 0; ENGINES[b.engine] &&
+                     strcmp( ENGINES[b.engine], optarg ); b.engine++ ){}
+                if( !ENGINES[b.engine] ){
+                    fprintf( stderr, "unknown engine: %s\n", optarg );
+                    return EXIT_FAILURE;
+                }
+            break;
+            case 'n':
+                b.n = (uint64_t)strtoull( optarg, NULL, 10 );
+            break;
+            case 'd':
+                dir = optarg;
+            break;
+            default:
+                fprintf( stderr, "usage: %s [-j] [-e engine] [-n iterations] "
+                         "[-d corpus-dir]\n", argv[0] );
+                return EXIT_FAILURE;
+        }
+    }
+    if( !b.n || !h ){
+        fprintf( stderr, "invalid arguments\n" );
+        return EXIT_FAILURE;
+    }
+    else if( corpus_load( &c, dir ) ){
+        perror( dir );
+        return EXIT_FAILURE;
+    }
+    b.available = perf_open( &b.perf );
+
+    if( b.json ){
+        printf( "{\"iterations\": %llu, \"engine\": \"%s\", \"tsc\": %s, "
+                "\"entries\": [", (unsigned long long)b.n, ENGINES[b.engine],
+                timer_cycles() ? "true" : "false" );
+    }
+    else
+    {
+        if( !timer_cycles() ){
+            printf( "time-stamp counter is not available: cycles are 0\n" );
+        }
+        if( b.available != ( 1U << PERF_NCOUNTER ) - 1 ){
+            printf( "performance counters are not available:" );
+            for( i = 0; i < PERF_NCOUNTER; i++ )
+            {
+                if( !( b.available & ( 1U << i ) ) ){
+                    printf( " %s", PERF_NAMES[i] );
+                }
+            }
+            printf( "\n" );
+        }
+        printf( "%-24s %6s %10s %10s %8s", "entry", "bytes", "ns/req",
+                "cycles/B", "GB/s" );
+        for( i = 0; i < PERF_NCOUNTER; i++ )
+        {
+            if( b.available & ( 1U << i ) ){
+                printf( " %10.10s %8s", PERF_NAMES[i], "/B" );
+            }
+        }
+        printf( "\n" );
+    }
+
+    for( i = 0; i < c.nentry; i++ )
+    {
+        if( bench_entry( &b, h, &c.entries[i] ) ){
+            rc = EXIT_FAILURE;
+        }
+    }
+    if( b.json ){
+        printf( "\n]}\n" );
+    }
+
+    perf_close( &b.perf );
+    corpus_free( &c );
+    http_free( h );
+
+    return rc;
+}
+
@@ -0,0 +1,395 @@
+/**
+ *  bench_handoff.c
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  measures the handoff of the parsed requests from the I/O threads to the
+ *  workers through the MPMC ring of example/ring.h and of the responses back.
+ *
+ *  each I/O thread parses the request heads of the corpus, packs them by
+ *  http_snapshot and enqueues them to the shared request ring by batch. the
+ *  workers dequeue them by batch, look up the Host header of the snapshot and
+ *  return the response to the response ring of the I/O thread. the latency
+ *  is measured from the enqueue of the request to the dequeue of its
+ *  response. each I/O thread keeps up to -w requests in flight.
+ *
+ *  -t runs the given number of the I/O threads and the workers, otherwise
+ *  1, 2, 4 ... 64 of each.
+ *
+ *  usage: bench_handoff [-t threads] [-n requests] [-b batch] [-w window]
+ *                       [-d corpus-dir]
+ */
+
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include "http.h"
+#include "ring.h"
+#include "corpus.h"
+#include "hist.h"
+#include "timer.h"
+
+#ifndef CORPUS_DIR
+#define CORPUS_DIR  "corpus"
+#endif
+
+#define MAXBATCH    256
+#define MAXTHREAD   64
+
+static const char RESPONSE[] = "HTTP/1.1 200 OK\r\n"
+                               "Content-Length: 0\r\n"
+                               "\r\n";
+
+
+typedef struct {
+    uint64_t t0;
+    int io;
+    const char *res;
+    size_t reslen;
+    /* snapshot block */
+    http_t *req;
+} msg_t;
+
+
+typedef struct {
+    /* request heads of the corpus */
+    char **heads;
+    size_t *lens;
+    size_t nhead;
+    /* size of the snapshot block */
+    size_t blksize;
+    uint64_t n;
+    size_t batch;
+    size_t window;
+    ring_t *req;
+    ring_t *res[MAXTHREAD];
+    int stop;
+} bench_t;
+
+
+typedef struct {
+    pthread_t tid;
+    bench_t *b;
+    int id;
+    uint64_t n;
+    uint64_t nhost;
+    hist_t *hist;
+} thread_t;
+
+
+static void *io_thread( void *arg )
+{
+    thread_t *t = (thread_t*)arg;
+    bench_t *b = t->b;
+    http_t *h = http_alloc( UINT8_MAX );
+    msg_t *msgs = calloc( b->window, sizeof( msg_t ) );
+    msg_t **free_ = calloc( b->window, sizeof( msg_t* ) );
+    msg_t *batch[MAXBATCH];
+    char **bufs = calloc( b->nhead, sizeof( char* ) );
+    size_t nfree = b->window;
+    size_t next = (size_t)t->id;
+    uint64_t sent = 0;
+    uint64_t recv = 0;
+    uint64_t now = 0;
+    size_t m = 0;
+    size_t k = 0;
+    size_t i = 0;
+
+    if( !h || !msgs || !free_ || !bufs ){
+        perror( "calloc" );
+        exit( EXIT_FAILURE );
+    }
+    // private copy of the heads because the parser lowercases the keys
+    for(; i < b->nhead; i++ )
+    {
+        if( !( bufs[i] = malloc( b->lens[i] + 1 ) ) ){
+            perror( "malloc" );
+            exit( EXIT_FAILURE );
+        }
+        memcpy( bufs[i], b->heads[i], b->lens[i] + 1 );
+    }
+    for( i = 0; i < b->window; i++ )
+    {
+        msgs[i].io = t->id;
+        if( !( msgs[i].req = malloc( b->blksize ) ) ){
+            perror( "malloc" );
+            exit( EXIT_FAILURE );
+        }
+        free_[i] = &msgs[i];
+    }
+
+    while( recv < t->n )
+    {
+        // responses
+        k = ring_dequeue( b->res[t->id], (void**)batch, b->batch );
+        now = timer_ns();
+        for( i = 0; i < k; i++ ){
+            hist_record( t->hist, now - batch[i]->t0 );
+            free_[nfree++] = batch[i];
+        }
+        recv += k;
+
+        // requests
+        for( m = 0; m < b->batch && nfree && sent + m < t->n; m++ )
+        {
+            msg_t *msg = free_[--nfree];
+
+            next = ( next + 1 ) % b->nhead;
+            http_init( h );
+            if( http_parse_request( h, bufs[next], b->lens[next], UINT16_MAX,
+                                    UINT16_MAX ) != HTTP_SUCCESS ||
+                http_snapshot( h, bufs[next], msg->req, b->blksize ) ){
+                fprintf( stderr, "failed to parse the head %zu\n", next );
+                exit( EXIT_FAILURE );
+            }
+            batch[m] = msg;
+        }
+        now = timer_ns();
+        for( i = 0; i < m; i++ ){
+            batch[i]->t0 = now;
+        }
+        // the response ring has room for the window, so the workers never
+        // wait for this thread
+        for( i = 0; i < m; i += k )
+        {
+            if( !( k = ring_enqueue( b->req, (void**)batch + i, m - i ) ) ){
+                sched_yield();
+            }
+        }
+        sent += m;
+
+        if( !k && !m ){
+            sched_yield();
+        }
+    }
+
+    for( i = 0; i < b->window; i++ ){
+        free( (void*)msgs[i].req );
+    }
+    for( i = 0; i < b->nhead; i++ ){
+        free( (void*)bufs[i] );
+    }
+    free( (void*)bufs );
+    free( (void*)free_ );
+    free( (void*)msgs );
+    http_free( h );
+
+    return NULL;
+}
+
+
+static void *worker_thread( void *arg )
+{
+    thread_t *t = (thread_t*)arg;
+    bench_t *b = t->b;
+    msg_t *batch[MAXBATCH];
+    size_t k = 0;
+    size_t i = 0;
+
+    for(;;)
+    {
+        if( !( k = ring_dequeue( b->req, (void**)batch, b->batch ) ) )
+        {
+            if( __atomic_load_n( &b->stop, __ATOMIC_ACQUIRE ) ){
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+
+        for( i = 0; i < k; i++ )
+        {
+            msg_t *msg = batch[i];
+
+            if( http_findheader( msg->req, http_snapshot_buf( msg->req ),
+                                 "host", 4 ) != -1 ){
+                t->nhost++;
+            }
+            msg->res = RESPONSE;
+            msg->reslen = sizeof( RESPONSE ) - 1;
+            while( !ring_enqueue( b->res[msg->io], (void**)&msg, 1 ) ){
+                sched_yield();
+            }
+        }
+        t->n += k;
+    }
+
+    return NULL;
+}
+
+
+static int run( bench_t *b, int nthread )
+{
+    thread_t ios[MAXTHREAD], workers[MAXTHREAD];
+    hist_t *hist = malloc( sizeof( hist_t ) );
+    uint64_t nhost = 0;
+    uint64_t t = 0;
+    int i = 0;
+
+    if( !hist ){
+        perror( "malloc" );
+        return -1;
+    }
+    hist_init( hist );
+    b->stop = 0;
+
+    t = timer_ns();
+    for(; i < nthread; i++ )
+    {
+        workers[i] = (thread_t){ .b = b, .id = i };
+        ios[i] = (thread_t){
+            .b = b,
+            .id = i,
+            .n = b->n / (uint64_t)nthread +
+                 ( (uint64_t)i < b->n % (uint64_t)nthread ),
+            .hist = malloc( sizeof( hist_t ) )
+        };
+        if( !ios[i].hist ){
+            perror( "malloc" );
+            exit( EXIT_FAILURE );
+        }
+        hist_init( ios[i].hist );
+        if( pthread_create( &workers[i].tid, NULL, worker_thread,
+                            &workers[i] ) ||
+            pthread_create( &ios[i].tid, NULL, io_thread, &ios[i] ) ){
+            perror( "pthread_create" );
+            exit( EXIT_FAILURE );
+        }
+    }
+    for( i = 0; i < nthread; i++ ){
+        pthread_join( ios[i].tid, NULL );
+        hist_merge( hist, ios[i].hist );
+        free( (void*)ios[i].hist );
+    }
+    t = timer_ns() - t;
+    __atomic_store_n( &b->stop, 1, __ATOMIC_RELEASE );
+    for( i = 0; i < nthread; i++ ){
+        pthread_join( workers[i].tid, NULL );
+        nhost += workers[i].nhost;
+    }
+
+    printf( "%7d %7d %7zu %12.0f %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+            nthread, nthread, b->batch,
+            (double)hist->count * 1e9 / (double)t,
+            (double)hist_percentile( hist, 50 ) / 1000.0,
+            (double)hist_percentile( hist, 90 ) / 1000.0,
+            (double)hist_percentile( hist, 99 ) / 1000.0,
+            (double)hist_percentile( hist, 99.9 ) / 1000.0,
+            (double)hist->max / 1000.0 );
+    fflush( stdout );
+    free( (void*)hist );
+
+    return nhost == b->n ? 0 : -1;
+}
+
+
+int main( int argc, char *argv[] )
+{
+    const char *dir = CORPUS_DIR;
+    bench_t b = {
+        .n = 1000000,
+        .batch = 16,
+        .window = 256
+    };
+    corpus_t c;
+    size_t maxlen = 0;
+    size_t i = 0;
+    int nthread = 0;
+    int opt = 0;
+    int rc = EXIT_SUCCESS;
+
+    while( ( opt = getopt( argc, argv, "t:n:b:w:d:" ) ) != -1 )
+    {
+        switch( opt ){
+            case 't':
+                nthread = atoi( optarg );
+            break;
+            case 'n':
+                b.n = (uint64_t)strtoull( optarg, NULL, 10 );
+            break;
+            case 'b':
+                b.batch = (size_t)atol( optarg );
+            break;
+            case 'w':
+                b.window = (size_t)atol( optarg );
+            break;
+            case 'd':
+                dir = optarg;
+            break;
+            default:
+                fprintf( stderr, "usage: %s [-t threads] [-n requests] "
+                         "[-b batch] [-w window] [-d corpus-dir]\n", argv[0] );
+                return EXIT_FAILURE;
+        }
+    }
+    if( nthread < 0 || nthread > MAXTHREAD || !b.n || !b.batch ||
+        b.batch > MAXBATCH || !b.window ){
+        fprintf( stderr, "invalid arguments\n" );
+        return EXIT_FAILURE;
+    }
+    else if( corpus_load( &c, dir ) ){
+        perror( dir );
+        return EXIT_FAILURE;
+    }
+
+    // request heads
+    b.heads = calloc( c.nentry, sizeof( char* ) );
+    b.lens = calloc( c.nentry, sizeof( size_t ) );
+    if( !b.heads || !b.lens ){
+        perror( "calloc" );
+        return EXIT_FAILURE;
+    }
+    for(; i < c.nentry; i++ )
+    {
+        if( c.entries[i].isreq ){
+            b.heads[b.nhead] = c.entries[i].buf;
+            b.lens[b.nhead++] = c.entries[i].len;
+            if( c.entries[i].len > maxlen ){
+                maxlen = c.entries[i].len;
+            }
+        }
+    }
+    if( !b.nhead ){
+        fprintf( stderr, "%s: no request heads\n", dir );
+        return EXIT_FAILURE;
+    }
+    b.blksize = http_alloc_size( UINT8_MAX ) + maxlen + 1;
+
+    // shared request ring and the response ring of each I/O thread
+    if( !( b.req = ring_alloc( b.window * MAXTHREAD ) ) ){
+        perror( "ring_alloc" );
+        return EXIT_FAILURE;
+    }
+    for( i = 0; i < MAXTHREAD; i++ )
+    {
+        if( !( b.res[i] = ring_alloc( b.window ) ) ){
+            perror( "ring_alloc" );
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf( "%7s %7s %7s %12s %10s %10s %10s %10s %10s\n", "io", "workers",
+            "batch", "req/s", "p50(us)", "p90(us)", "p99(us)", "p99.9(us)",
+            "max(us)" );
+    for( i = nthread ? (size_t)nthread : 1; i <= MAXTHREAD;
+         i = nthread ? MAXTHREAD + 1 : i * 2 )
+    {
+        if( run( &b, (int)i ) ){
+            fprintf( stderr, "lost requests\n" );
+            rc = EXIT_FAILURE;
+        }
+    }
+
+    for( i = 0; i < MAXTHREAD; i++ ){
+        ring_free( b.res[i] );
+    }
+    ring_free( b.req );
+    free( (void*)b.lens );
+    free( (void*)b.heads );
+    corpus_free( &c );
+
+    return rc;
+}
@@ -0,0 +1,102 @@
+/**
+ *  bench_reqline.c
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  compares the parse of the whole head with the parse that stops after the
+ *  request-line or status-line (HTTP_OPT_REQLINE) on the corpus entries.
+ *
+ *  usage: bench_reqline [-n iterations] [-d corpus-dir]
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "http.h"
+#include "corpus.h"
+#include "timer.h"
+
+#ifndef CORPUS_DIR
+#define CORPUS_DIR  "corpus"
+#endif
+
+
+static double measure( http_t *h, const corpus_entry_t *e, uint8_t opts,
+                       uint64_t n, int *rc )
+{
+    uint64_t t = timer_ns();
+    uint64_t i = 0;
+
+    for(; i < n; i++ )
+    {
+        http_init( h );
+        http_setopt( h, opts );
+        *rc = e->isreq ?
+              http_parse_request( h, e->buf, e->len, UINT16_MAX, UINT16_MAX ) :
+              http_parse_response( h, e->buf, e->len, UINT16_MAX );
+    }
+
+    return (double)( timer_ns() - t ) / (double)n;
+}
+
+
+int main( int argc, char *argv[] )
+{
+    const char *dir = CORPUS_DIR;
+    uint64_t n = 1000000;
+    corpus_t c;
+    http_t *h = http_alloc( UINT8_MAX );
+    size_t i = 0;
+    int opt = 0;
+
+    while( ( opt = getopt( argc, argv, "n:d:" ) ) != -1 )
+    {
+        switch( opt ){
+            case 'n':
+                n = (uint64_t)strtoull( optarg, NULL, 10 );
+            break;
+            case 'd':
+                dir = optarg;
+            break;
+            default:
+                fprintf( stderr, "usage: %s [-n iterations] [-d corpus-dir]\n",
+                         argv[0] );
+                return EXIT_FAILURE;
+        }
+    }
+    if( !n || !h ){
+        fprintf( stderr, "invalid arguments\n" );
+        return EXIT_FAILURE;
+    }
+    else if( corpus_load( &c, dir ) ){
+        perror( dir );
+        return EXIT_FAILURE;
+    }
+
+    printf( "%-24s %6s %8s %10s %8s %10s %8s\n", "entry", "bytes", "line",
+            "head ns", "GB/s", "line ns", "speedup" );
+    for(; i < c.nentry; i++ )
+    {
+        corpus_entry_t *e = &c.entries[i];
+        double head = 0, line = 0;
+        int rc = 0;
+
+        head = measure( h, e, 0, n, &rc );
+        if( rc != HTTP_SUCCESS ){
+            fprintf( stderr, "%s: failed to parse: %d\n", e->name, rc );
+            continue;
+        }
+        line = measure( h, e, HTTP_OPT_REQLINE, n, &rc );
+        if( rc != HTTP_SUCCESS ){
+            fprintf( stderr, "%s: failed to parse: %d\n", e->name, rc );
+            continue;
+        }
+        printf( "%-24s %6zu %8zu %10.1f %8.2f %10.1f %7.1fx\n", e->name,
+                e->len, (size_t)h->cur, head, (double)e->len / head, line,
+                head / line );
+    }
+
+    corpus_free( &c );
+    http_free( h );
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,280 @@
+/**
+ *  bench_router.c
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  measures the lookup of the radix tree router (http_router.h) over the
+ *  routes of a REST API, and compares it with a linear scan of the patterns
+ *  that matches them segment by segment.
+ *
+ *  each resource i of -n routes / 4 resources has the routes
+ *
+ *      GET    /api/v<i % 4>/res<i>
+ *      POST   /api/v<i % 4>/res<i>
+ *      GET    /api/v<i % 4>/res<i>/:id
+ *      DELETE /api/v<i % 4>/res<i>/:id/items/:item
+ *
+ *  and every 16th resource up to 64 has the capture of the rest *path at
+ *  GET /static<i / 16>/.
+ *
+ *  the paths of the lookups are drawn from the routes with the captures
+ *  filled in, and "match" looks up the path strings while "lookup" looks
+ *  up the request-target of the parsed requests.
+ *
+ *  usage: bench_router [-n routes] [-i iterations]
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "http.h"
+#include "http_router.h"
+#include "timer.h"
+
+#define NPATH   1024
+#define MAXLEN  128
+
+
+typedef struct {
+    char pattern[MAXLEN];
+    int method;
+    void *handler;
+} route_t;
+
+
+typedef struct {
+    char path[MAXLEN];
+    size_t len;
+    int method;
+    /* route of the path */
+    void *handler;
+    /* parsed request of the path */
+    char req[MAXLEN + 32];
+    http_t *h;
+} path_t;
+
+
+/**
+ * match the path segment by segment like the list of the patterns that the
+ * applications write by hand
+ */
+static int linear_match( const route_t *routes, size_t nroute, int method,
+                         const char *path, size_t len, http_route_t *route )
+{
+    const char *tail = path + len;
+    size_t i = 0;
+
+    for(; i < nroute; i++ )
+    {
+        const char *p = routes[i].pattern;
+        const char *s = path;
+
+        if( routes[i].method != method ){
+            continue;
+        }
+        route->nparam = 0;
+        while( *p && s < tail )
+        {
+            if( *p == ':' || *p == '*' )
+            {
+                const char *e = s;
+
+                while( e < tail && ( *p == '*' || *e != '/' ) ){
+                    e++;
+                }
+                route->params[route->nparam].val = (uintptr_t)( s - path );
+                route->params[route->nparam++].vlen = (uint16_t)( e - s );
+                s = e;
+                while( *p && *p != '/' ){
+                    p++;
+                }
+            }
+            else if( *p != *s ){
+                break;
+            }
+            else {
+                p++;
+                s++;
+            }
+        }
+        if( !*p && s == tail ){
+            route->handler = routes[i].handler;
+            return HTTP_ROUTER_FOUND;
+        }
+    }
+
+    return HTTP_ROUTER_ENOTFOUND;
+}
+
+
+static const char *method_name( int method )
+{
+    switch( method ){
+        case HTTP_MPOST:
+            return "POST";
+        case HTTP_MDELETE:
+            return "DELETE";
+        default:
+            return "GET";
+    }
+}
+
+
+int main( int argc, char *argv[] )
+{
+    http_router_t *r = http_router_alloc();
+    route_t *routes = NULL;
+    path_t *paths = calloc( NPATH, sizeof( path_t ) );
+    http_route_t route;
+    size_t nroute = 10000;
+    size_t n = 0;
+    size_t i = 0;
+    uint64_t niter = 2000000;
+    uint64_t nfound = 0;
+    uint64_t k = 0;
+    uint64_t t = 0;
+    unsigned seed = 1;
+    int opt = 0;
+
+    while( ( opt = getopt( argc, argv, "n:i:" ) ) != -1 )
+    {
+        switch( opt ){
+            case 'n':
+                nroute = (size_t)atol( optarg );
+            break;
+            case 'i':
+                niter = (uint64_t)strtoull( optarg, NULL, 10 );
+            break;
+            default:
+                fprintf( stderr, "usage: %s [-n routes] [-i iterations]\n",
+                         argv[0] );
+                return EXIT_FAILURE;
+        }
+    }
+    if( nroute < 4 || !niter || !r || !paths ||
+        !( routes = calloc( nroute + nroute / 64 + 1, sizeof( route_t ) ) ) ){
+        fprintf( stderr, "invalid arguments\n" );
+        return EXIT_FAILURE;
+    }
+
+    // routes of the resources
+    for( i = 0; i < nroute / 4; i++ )
+    {
+        int v = (int)( i % 4 );
+
+        snprintf( routes[n].pattern, MAXLEN, "/api/v%d/res%zu", v, i );
+        routes[n++].method = HTTP_MGET;
+        snprintf( routes[n].pattern, MAXLEN, "/api/v%d/res%zu", v, i );
+        routes[n++].method = HTTP_MPOST;
+        snprintf( routes[n].pattern, MAXLEN, "/api/v%d/res%zu/:id", v, i );
+        routes[n++].method = HTTP_MGET;
+        snprintf( routes[n].pattern, MAXLEN,
+                  "/api/v%d/res%zu/:id/items/:item", v, i );
+        routes[n++].method = HTTP_MDELETE;
+        if( i % 16 == 0 && i / 16 < 64 ){
+            snprintf( routes[n].pattern, MAXLEN, "/static%zu/*path", i / 16 );
+            routes[n++].method = HTTP_MGET;
+        }
+    }
+    for( i = 0; i < n; i++ )
+    {
+        routes[i].handler = &routes[i];
+        if( http_router_add( r, routes[i].method, routes[i].pattern,
+                             routes[i].handler ) ){
+            perror( routes[i].pattern );
+            return EXIT_FAILURE;
+        }
+    }
+
+    // paths of the random routes
+    for( i = 0; i < NPATH; i++ )
+    {
+        path_t *p = &paths[i];
+        route_t *rt = &routes[(size_t)rand_r( &seed ) % n];
+        const char *s = rt->pattern;
+        char *d = p->path;
+
+        for(; *s; s++ )
+        {
+            if( *s == ':' || *s == '*' ){
+                d += sprintf( d, "%s%d", *s == '*' ? "css/site-" : "",
+                              rand_r( &seed ) % 100000 );
+                while( s[1] && s[1] != '/' ){
+                    s++;
+                }
+            }
+            else {
+                *d++ = *s;
+            }
+        }
+        *d = 0;
+        p->len = (size_t)( d - p->path );
+        p->method = rt->method;
+        p->handler = rt->handler;
+        snprintf( p->req, sizeof( p->req ), "%s %s?q=1 HTTP/1.1\r\n\r\n",
+                  method_name( p->method ), p->path );
+        if( !( p->h = http_alloc(1) ) ||
+            http_parse_request( p->h, p->req, strlen( p->req ), UINT16_MAX,
+                                UINT16_MAX ) != HTTP_SUCCESS ){
+            fprintf( stderr, "failed to parse: %s", p->req );
+            return EXIT_FAILURE;
+        }
+        // verify the routers
+        if( http_router_match( r, p->method, p->path, p->len,
+                               &route ) != HTTP_ROUTER_FOUND ||
+            route.handler != p->handler ||
+            http_router_lookup( r, p->h, p->req, &route ) !=
+            HTTP_ROUTER_FOUND || route.handler != p->handler ||
+            linear_match( routes, n, p->method, p->path, p->len,
+                          &route ) != HTTP_ROUTER_FOUND ||
+            route.handler != p->handler ){
+            fprintf( stderr, "failed to match: %s %s\n",
+                     method_name( p->method ), p->path );
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf( "%zu routes, %d paths\n", n, NPATH );
+    printf( "%-10s %12s %12s\n", "router", "lookups", "ns/lookup" );
+
+    t = timer_ns();
+    for( k = 0; k < niter; k++ ){
+        path_t *p = &paths[k % NPATH];
+        nfound += http_router_match( r, p->method, p->path, p->len,
+                                     &route ) == HTTP_ROUTER_FOUND;
+    }
+    t = timer_ns() - t;
+    printf( "%-10s %12llu %12.1f\n", "match", (unsigned long long)niter,
+            (double)t / (double)niter );
+
+    t = timer_ns();
+    for( k = 0; k < niter; k++ ){
+        path_t *p = &paths[k % NPATH];
+        nfound += http_router_lookup( r, p->h, p->req,
+                                      &route ) == HTTP_ROUTER_FOUND;
+    }
+    t = timer_ns() - t;
+    printf( "%-10s %12llu %12.1f\n", "lookup", (unsigned long long)niter,
+            (double)t / (double)niter );
+
+    // the linear scan is slower by the number of the routes
+    niter = niter / n + NPATH;
+    t = timer_ns();
+    for( k = 0; k < niter; k++ ){
+        path_t *p = &paths[k % NPATH];
+        nfound += linear_match( routes, n, p->method, p->path, p->len,
+                                &route ) == HTTP_ROUTER_FOUND;
+    }
+    t = timer_ns() - t;
+    printf( "%-10s %12llu %12.1f\n", "linear", (unsigned long long)niter,
+            (double)t / (double)niter );
+
+    for( i = 0; i < NPATH; i++ ){
+        http_free( paths[i].h );
+    }
+    free( (void*)paths );
+    free( (void*)routes );
+    http_router_free( r );
+
+    return nfound ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,236 @@
+/**
+ *  bench_vhost.c
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  measures the lookup of the virtual host table (http_vhost.h) over the
+ *  host names of a multi-tenant server, and compares it with a linear scan
+ *  of the names that copies the host in lowercase without the port first.
+ *
+ *  of -n names, every 5th is the wildcard "*.t<i>.cdn.example" and the
+ *  others are the exact names "www<i>.site<i % 100>.example", and "*" is
+ *  the default.
+ *
+ *  the hosts of the lookups are drawn from the names in mixed case with
+ *  the ports, the subdomains of the wildcards, and the unknown names, and
+ *  "lookup" looks up the host strings while "request" looks up the Host
+ *  header of the parsed requests.
+ *
+ *  usage: bench_vhost [-n names] [-i iterations]
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include "http.h"
+#include "http_vhost.h"
+#include "timer.h"
+
+#define NHOST   1024
+#define MAXLEN  64
+
+
+typedef struct {
+    char name[MAXLEN];
+    void *udata;
+} name_t;
+
+
+typedef struct {
+    char host[MAXLEN + 16];
+    size_t len;
+    /* udata of the host */
+    void *udata;
+    /* parsed request of the host */
+    char req[MAXLEN + 80];
+    http_t *h;
+} host_t;
+
+
+/**
+ * compare the names one by one like the list of the server blocks that the
+ * applications scan by hand
+ */
+static void *linear_lookup( const name_t *names, size_t nname, void *any,
+                            const char *host, size_t len )
+{
+    char buf[MAXLEN];
+    void *udata = any;
+    size_t wlen = 0;
+    size_t blen = 0;
+    size_t i = 0;
+
+    // lowercase copy without the port
+    for(; i < len && host[i] != ':' && i < MAXLEN - 1; i++ ){
+        buf[i] = (char)( host[i] >= 'A' && host[i] <= 'Z' ?
+                         host[i] | 0x20 : host[i] );
+    }
+    buf[i] = 0;
+    blen = i;
+
+    for( i = 0; i < nname; i++ )
+    {
+        const char *name = names[i].name;
+
+        if( *name == '*' ){
+            size_t nlen = strlen( name + 1 );
+
+            // keep the longest wildcard
+            if( blen > nlen && nlen > wlen &&
+                strcmp( buf + blen - nlen, name + 1 ) == 0 ){
+                udata = names[i].udata;
+                wlen = nlen;
+            }
+        }
+        else if( strcmp( buf, name ) == 0 ){
+            return names[i].udata;
+        }
+    }
+
+    return udata;
+}
+
+
+int main( int argc, char *argv[] )
+{
+    http_vhost_t *v = http_vhost_alloc();
+    name_t *names = NULL;
+    host_t *hosts = calloc( NHOST, sizeof( host_t ) );
+    static char any[] = "*";
+    uint64_t nfound = 0;
+    size_t nname = 5000;
+    size_t i = 0;
+    uint64_t niter = 5000000;
+    uint64_t k = 0;
+    uint64_t t = 0;
+    unsigned seed = 1;
+    int opt = 0;
+
+    while( ( opt = getopt( argc, argv, "n:i:" ) ) != -1 )
+    {
+        switch( opt ){
+            case 'n':
+                nname = (size_t)atol( optarg );
+            break;
+            case 'i':
+                niter = (uint64_t)strtoull( optarg, NULL, 10 );
+            break;
+            default:
+                fprintf( stderr, "usage: %s [-n names] [-i iterations]\n",
+                         argv[0] );
+                return EXIT_FAILURE;
+        }
+    }
+    if( nname < 5 || !niter || !v || !hosts ||
+        !( names = calloc( nname, sizeof( name_t ) ) ) ){
+        fprintf( stderr, "invalid arguments\n" );
+        return EXIT_FAILURE;
+    }
+
+    for( i = 0; i < nname; i++ )
+    {
+        if( i % 5 == 0 ){
+            snprintf( names[i].name, MAXLEN, "*.t%zu.cdn.example", i );
+        }
+        else {
+            snprintf( names[i].name, MAXLEN, "www%zu.site%zu.example", i,
+                      i % 100 );
+        }
+        names[i].udata = &names[i];
+        if( http_vhost_add( v, names[i].name, names[i].udata ) ){
+            perror( names[i].name );
+            return EXIT_FAILURE;
+        }
+    }
+    http_vhost_add( v, "*", any );
+
+    // hosts of the random names
+    for( i = 0; i < NHOST; i++ )
+    {
+        host_t *p = &hosts[i];
+        name_t *n = &names[(size_t)rand_r( &seed ) % nname];
+        int r = rand_r( &seed );
+        char *c = NULL;
+
+        if( r % 10 == 0 ){
+            snprintf( p->host, sizeof( p->host ), "unknown%d.example:8080", r );
+            p->udata = any;
+        }
+        else if( *n->name == '*' ){
+            snprintf( p->host, sizeof( p->host ), "img%d%s", r % 1000,
+                      n->name + 1 );
+            p->udata = n->udata;
+        }
+        else {
+            snprintf( p->host, sizeof( p->host ), "%s%s", n->name,
+                      r % 3 ? "" : ":443" );
+            p->udata = n->udata;
+        }
+        // mixed case
+        for( c = p->host; *c; c++ ){
+            if( *c >= 'a' && *c <= 'z' && rand_r( &seed ) % 4 == 0 ){
+                *c &= ~0x20;
+            }
+        }
+        p->len = strlen( p->host );
+        snprintf( p->req, sizeof( p->req ),
+                  "GET / HTTP/1.1\r\nHost: %s\r\n\r\n", p->host );
+        if( !( p->h = http_alloc(1) ) ||
+            http_parse_request( p->h, p->req, strlen( p->req ), UINT16_MAX,
+                                UINT16_MAX ) != HTTP_SUCCESS ){
+            fprintf( stderr, "failed to parse: %s", p->req );
+            return EXIT_FAILURE;
+        }
+        // verify the tables
+        if( http_vhost_lookup( v, p->host, p->len ) != p->udata ||
+            http_vhost_request( v, p->h, p->req ) != p->udata ||
+            linear_lookup( names, nname, any, p->host,
+                           p->len ) != p->udata ){
+            fprintf( stderr, "failed to look up: %s\n", p->host );
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf( "%zu names, %d hosts\n", nname, NHOST );
+    printf( "%-10s %12s %12s\n", "table", "lookups", "ns/lookup" );
+
+    t = timer_ns();
+    for( k = 0; k < niter; k++ ){
+        host_t *p = &hosts[k % NHOST];
+        nfound += http_vhost_lookup( v, p->host, p->len ) != any;
+    }
+    t = timer_ns() - t;
+    printf( "%-10s %12llu %12.1f\n", "lookup", (unsigned long long)niter,
+            (double)t / (double)niter );
+
+    t = timer_ns();
+    for( k = 0; k < niter; k++ ){
+        host_t *p = &hosts[k % NHOST];
+        nfound += http_vhost_request( v, p->h, p->req ) != any;
+    }
+    t = timer_ns() - t;
+    printf( "%-10s %12llu %12.1f\n", "request", (unsigned long long)niter,
+            (double)t / (double)niter );
+
+    // the linear scan is slower by the number of the names
+    niter = niter / nname + NHOST;
+    t = timer_ns();
+    for( k = 0; k < niter; k++ ){
+        host_t *p = &hosts[k % NHOST];
+        nfound += linear_lookup( names, nname, any, p->host,
+                                 p->len ) != any;
+    }
+    t = timer_ns() - t;
+    printf( "%-10s %12llu %12.1f\n", "linear", (unsigned long long)niter,
+            (double)t / (double)niter );
+
+    for( i = 0; i < NHOST; i++ ){
+        http_free( hosts[i].h );
+    }
+    free( (void*)hosts );
+    free( (void*)names );
+    http_vhost_free( v );
+
+    return nfound ? EXIT_SUCCESS : EXIT_FAILURE;
+}
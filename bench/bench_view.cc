@@ -0,0 +1,168 @@
+/**
+ *  bench_view.cc
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  compares the header iteration and lookup by http_getheader_at with the
+ *  inline http::view on the parsed corpus entries.
+ *
+ *  usage: bench_view [-n iterations] [-d corpus-dir]
+ */
+
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "http_view.hpp"
+extern "C" {
+#include "corpus.h"
+}
+#include "timer.h"
+
+#ifndef CORPUS_DIR
+#define CORPUS_DIR  "corpus"
+#endif
+
+static const char *NAMES[] = {
+    "host", "user-agent", "cookie", "x-not-found", NULL
+};
+
+static volatile size_t SINK = 0;
+
+
+static size_t iterate_c( http_t *h, const char *buf )
+{
+    uintptr_t key, val;
+    uint16_t klen, vlen;
+    size_t sum = 0;
+
+    for( uint8_t i = 0; http_getheader_at( h, &key, &klen, &val, &vlen,
+                                           i ) == 0; i++ ){
+        sum += klen + vlen + (unsigned char)buf[key];
+    }
+    return sum;
+}
+
+
+static size_t iterate_view( http_t *h, const char *buf )
+{
+    http::view v( h, buf );
+    size_t sum = 0;
+
+    for( auto [key, val] : v.headers() ){
+        sum += key.size() + val.size() + (unsigned char)key[0];
+    }
+    return sum;
+}
+
+
+static size_t lookup_c( http_t *h, const char *buf )
+{
+    uintptr_t key, val;
+    uint16_t klen, vlen;
+    size_t sum = 0;
+
+    for( const char **name = NAMES; *name; name++ )
+    {
+        size_t len = std::strlen( *name );
+
+        for( uint8_t i = 0; http_getheader_at( h, &key, &klen, &val, &vlen,
+                                               i ) == 0; i++ )
+        {
+            if( klen == len && strncasecmp( buf + key, *name, len ) == 0 ){
+                sum += vlen;
+                break;
+            }
+        }
+    }
+    return sum;
+}
+
+
+static size_t lookup_view( http_t *h, const char *buf )
+{
+    http::view v( h, buf );
+    size_t sum = 0;
+
+    for( const char **name = NAMES; *name; name++ ){
+        sum += v.find( *name ).size();
+    }
+    return sum;
+}
+
+
+template<class F>
+static double measure( F fn, http_t *h, const char *buf, uint64_t n )
+{
+    uint64_t t = timer_ns();
+    size_t sum = 0;
+
+    for( uint64_t i = 0; i < n; i++ ){
+        sum += fn( h, buf );
+    }
+    t = timer_ns() - t;
+    SINK = SINK + sum;
+
+    return (double)t / (double)n;
+}
+
+
+int main( int argc, char *argv[] )
+{
+    const char *dir = CORPUS_DIR;
+    uint64_t n = 1000000;
+    corpus_t c;
+    http_t *h = http_alloc( UINT8_MAX );
+    int opt = 0;
+
+    while( ( opt = getopt( argc, argv, "n:d:" ) ) != -1 )
+    {
+        switch( opt ){
+            case 'n':
+                n = (uint64_t)strtoull( optarg, NULL, 10 );
+            break;
+            case 'd':
+                dir = optarg;
+            break;
+            default:
+                fprintf( stderr, "usage: %s [-n iterations] [-d corpus-dir]\n",
+                         argv[0] );
+                return EXIT_FAILURE;
+        }
+    }
+    if( !n || !h ){
+        fprintf( stderr, "invalid arguments\n" );
+        return EXIT_FAILURE;
+    }
+    else if( corpus_load( &c, dir ) ){
+        perror( dir );
+        return EXIT_FAILURE;
+    }
+
+    printf( "%-24s %8s %12s %12s %12s %12s\n", "entry", "headers",
+            "iter C ns", "iter view ns", "find C ns", "find view ns" );
+    for( size_t i = 0; i < c.nentry; i++ )
+    {
+        corpus_entry_t *e = &c.entries[i];
+        int rc = 0;
+
+        http_init( h );
+        rc = e->isreq ?
+             http_parse_request( h, e->buf, e->len, UINT16_MAX, UINT16_MAX ) :
+             http_parse_response( h, e->buf, e->len, UINT16_MAX );
+        if( rc != HTTP_SUCCESS ){
+            fprintf( stderr, "%s: failed to parse: %d\n", e->name, rc );
+            continue;
+        }
+        printf( "%-24s %8u %12.1f %12.1f %12.1f %12.1f\n", e->name,
+                h->nheader,
+                measure( iterate_c, h, e->buf, n ),
+                measure( iterate_view, h, e->buf, n ),
+                measure( lookup_c, h, e->buf, n ),
+                measure( lookup_view, h, e->buf, n ) );
+    }
+
+    corpus_free( &c );
+    http_free( h );
+
+    return EXIT_SUCCESS;
+}
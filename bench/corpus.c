@@ -0,0 +1,126 @@
+/**
+ *  corpus.c
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "corpus.h"
+
+
+static int cmp_entry( const void *a, const void *b )
+{
+    return strcmp( ((const corpus_entry_t*)a)->name,
+                   ((const corpus_entry_t*)b)->name );
+}
+
+
+/**
+ * map the file into the zero-filled anonymous mapping that is one byte
+ * larger than the file, so the file is always followed by a null-terminator.
+ */
+static int map_entry( corpus_entry_t *e, int fd, size_t len )
+{
+    size_t pagesize = (size_t)sysconf( _SC_PAGESIZE );
+    void *mem = NULL;
+
+    e->size = ( len + 1 + pagesize - 1 ) & ~( pagesize - 1 );
+    mem = mmap( NULL, e->size, PROT_READ|PROT_WRITE,
+                MAP_PRIVATE|MAP_ANONYMOUS, -1, 0 );
+    if( mem == MAP_FAILED ){
+        return -1;
+    }
+    else if( len && mmap( mem, len, PROT_READ|PROT_WRITE,
+                          MAP_PRIVATE|MAP_FIXED, fd, 0 ) == MAP_FAILED ){
+        munmap( mem, e->size );
+        return -1;
+    }
+    e->buf = (char*)mem;
+    e->len = len;
+
+    return 0;
+}
+
+
+int corpus_load( corpus_t *c, const char *dir )
+{
+    DIR *dp = opendir( dir );
+    struct dirent *de = NULL;
+    char path[4096];
+    size_t nalloc = 0;
+
+    c->entries = NULL;
+    c->nentry = 0;
+    if( !dp ){
+        return -1;
+    }
+
+    while( ( de = readdir( dp ) ) )
+    {
+        size_t len = strlen( de->d_name );
+        corpus_entry_t *e = NULL;
+        struct stat st;
+        int fd = 0;
+
+        if( len < 5 || len >= sizeof( e->name ) ||
+            ( strcmp( de->d_name + len - 4, ".req" ) &&
+              strcmp( de->d_name + len - 4, ".res" ) ) ){
+            continue;
+        }
+        else if( c->nentry == nalloc )
+        {
+            nalloc = nalloc ? nalloc * 2 : 16;
+            e = realloc( c->entries, nalloc * sizeof( corpus_entry_t ) );
+            if( !e ){
+                goto FAILED;
+            }
+            c->entries = e;
+        }
+
+        e = &c->entries[c->nentry];
+        memcpy( e->name, de->d_name, len - 4 );
+        e->name[len - 4] = 0;
+        e->isreq = de->d_name[len - 2] == 'e' && de->d_name[len - 1] == 'q';
+        snprintf( path, sizeof( path ), "%s/%s", dir, de->d_name );
+        if( ( fd = open( path, O_RDONLY ) ) == -1 ){
+            goto FAILED;
+        }
+        else if( fstat( fd, &st ) || map_entry( e, fd, (size_t)st.st_size ) ){
+            close( fd );
+            goto FAILED;
+        }
+        close( fd );
+        c->nentry++;
+    }
+    closedir( dp );
+    qsort( c->entries, c->nentry, sizeof( corpus_entry_t ), cmp_entry );
+
+    return 0;
+
+FAILED:
+    closedir( dp );
+    corpus_free( c );
+
+    return -1;
+}
+
+
+void corpus_free( corpus_t *c )
+{
+    size_t i = 0;
+
+    for(; i < c->nentry; i++ ){
+        munmap( c->entries[i].buf, c->entries[i].size );
+    }
+    free( (void*)c->entries );
+    c->entries = NULL;
+    c->nentry = 0;
+}
+
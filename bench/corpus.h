@@ -0,0 +1,38 @@
+/**
+ *  corpus.h
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  loads the request heads (*.req) and response heads (*.res) of the corpus
+ *  directory. each entry is mapped privately, so the parser can lowercase
+ *  the header names, and it is always followed by a null-terminator.
+ */
+
+#ifndef BENCH_CORPUS_H
+#define BENCH_CORPUS_H
+
+#include <stddef.h>
+
+typedef struct {
+    char name[64];
+    /* 1 = request, 0 = response */
+    int isreq;
+    char *buf;
+    size_t len;
+    /* length of the mapping */
+    size_t size;
+} corpus_entry_t;
+
+typedef struct {
+    corpus_entry_t *entries;
+    size_t nentry;
+} corpus_t;
+
+
+/**
+ * load the entries sorted by name, return -1 on failure
+ */
+int corpus_load( corpus_t *c, const char *dir );
+void corpus_free( corpus_t *c );
+
+
+#endif
@@ -0,0 +1,15 @@
+HTTP/1.1 200 OK
+Content-Type: image/jpeg
+Content-Length: 48213
+Connection: keep-alive
+Date: Sat, 27 Jun 2015 04:10:06 GMT
+Last-Modified: Tue, 02 Jun 2015 11:31:40 GMT
+ETag: "5c0b0c6a4e0f1f2a3b4c5d6e7f809162"
+Cache-Control: public, max-age=31536000
+Accept-Ranges: bytes
+Server: AmazonS3
+Age: 86124
+X-Cache: Hit from cloudfront
+Via: 1.1 0f2b8d7e9a1c3e5f7a9b1d3f5e7c9a1b.cloudfront.net (CloudFront)
+X-Amz-Cf-Id: 9LIP8Ohe9YYZqW12opmLDJp4FK67R4TdzQYzYORX8v0yz8foPR1YvQM5
+
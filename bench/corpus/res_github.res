@@ -0,0 +1,21 @@
+HTTP/1.1 200 OK
+Server: GitHub.com
+Date: Sat, 27 Jun 2015 04:10:06 GMT
+Content-Type: text/html; charset=utf-8
+Transfer-Encoding: chunked
+Status: 200 OK
+Content-Security-Policy: default-src *; script-src assets-cdn.github.com collector-cdn.github.com; object-src assets-cdn.github.com; style-src 'self' 'unsafe-inline' 'unsafe-eval' assets-cdn.github.com; img-src 'self' data: assets-cdn.github.com identicons.github.com www.google-analytics.com collector.githubapp.com *.githubusercontent.com *.gravatar.com *.wp.com; media-src 'none'; frame-src 'self' render.githubusercontent.com gist.github.com www.youtube.com player.vimeo.com checkout.paypal.com; font-src assets-cdn.github.com; connect-src 'self' live.github.com wss://live.github.com uploads.github.com status.github.com api.github.com www.google-analytics.com github-cloud.s3.amazonaws.com
+Cache-Control: no-cache
+Vary: X-PJAX
+X-UA-Compatible: IE=Edge,chrome=1
+Set-Cookie: logged_in=no; domain=.github.com; path=/; expires=Wed, 27 Jun 2035 04:10:06 -0000; secure; HttpOnly
+X-Request-Id: 8ea8d359ded1d2d30094d38b2a4e73d3
+X-Runtime: 0.037659
+X-GitHub-Request-Id: 999DDDE5:0A3A:102882A:558E221D
+Strict-Transport-Security: max-age=31536000; includeSubdomains; preload
+X-Content-Type-Options: nosniff
+X-XSS-Protection: 1; mode=block
+X-Frame-Options: deny
+Vary: Accept-Encoding
+X-Served-By: 1868c9f28a71d80b2987f48dbd1824a0
+
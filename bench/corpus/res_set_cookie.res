@@ -0,0 +1,16 @@
+HTTP/1.1 302 Found
+Location: https://www.example.com/home
+Content-Length: 0
+Set-Cookie: 1BYtatFM=b8h4ZEAAMtDjvInfwz2DNcsvfrlS4CAQIZphnROcy05lyrv9jxkow40N459ztFu9; Domain=.example.com; Path=/; Expires=Wed, 27 Jun 2035 04:10:06 GMT; Secure; HttpOnly
+Set-Cookie: 4GYMm219=kzHaa2lg8pDKZQqVwRgJV3WGQyi7W5qQAeGNvCr9sxtQTORy8HZRd6PFFxSbd414; Domain=.example.com; Path=/; Expires=Wed, 27 Jun 2035 04:10:06 GMT; Secure; HttpOnly
+Set-Cookie: RhJyCtWG=5jUMVDc8uEia875rjmL6KGczlVLPrOWpsXIbAJAPfZ8ROyF9TxS5ruk1KF0dYIw5; Domain=.example.com; Path=/; Expires=Wed, 27 Jun 2035 04:10:06 GMT; Secure; HttpOnly
+Set-Cookie: imHZ4dkt=VHkRt6dLtyX9x9Slrt58EmNu7CzgRqxzuyY9Erhn76NCG1AOkX5ucjrWIEQJ2QAW; Domain=.example.com; Path=/; Expires=Wed, 27 Jun 2035 04:10:06 GMT; Secure; HttpOnly
+Set-Cookie: erzxT6zH=Zs2OhqCXacI0SKtwM8xqp4e4JgWMR1A1ZTh7tkPl9UOVShXzz18YV1vzzFZvw3lT; Domain=.example.com; Path=/; Expires=Wed, 27 Jun 2035 04:10:06 GMT; Secure; HttpOnly
+Set-Cookie: 3jIVHAQ7=5sinvRe7AeGa2KQpKBznKUrY2RY21ijoQ2WpGh5s5cV07Py4siPT4TyN5rTeXMM0; Domain=.example.com; Path=/; Expires=Wed, 27 Jun 2035 04:10:06 GMT; Secure; HttpOnly
+Set-Cookie: GrMn5otg=xRK4ZfxbSHeh19unaDOWiCrGdCLJMZccI0DhEosO7v9vHKonJY0ns1ZKITboXlbZ; Domain=.example.com; Path=/; Expires=Wed, 27 Jun 2035 04:10:06 GMT; Secure; HttpOnly
+Set-Cookie: GrBxe9Or=UfLhzyG9LAoQ34dZx9IvQqePEKiBDR4TNDmvNmhzksWmeV5HbCXmYTVmXqmJWS1s; Domain=.example.com; Path=/; Expires=Wed, 27 Jun 2035 04:10:06 GMT; Secure; HttpOnly
+Set-Cookie: VY8b6VUN=UbewnAa13PUVOIqJwOkKOuwtgcVlSwA5bZTDXgvg2jxX4EFf6vYuE50i2gHKqGyn; Domain=.example.com; Path=/; Expires=Wed, 27 Jun 2035 04:10:06 GMT; Secure; HttpOnly
+Set-Cookie: wqQb86mT=r80HBXUUykZ51BiiahnULIyba01YfDXcn4KI6e2uvNJ4DFXO5napn5wy4ggL4i8m; Domain=.example.com; Path=/; Expires=Wed, 27 Jun 2035 04:10:06 GMT; Secure; HttpOnly
+Set-Cookie: CDKL6ORT=6CWeKUUd3EkzPR3TpTPES4EMjh6FMyeSpZ4oazKYV0oOVVPcpg6mZacDdzp879oX; Domain=.example.com; Path=/; Expires=Wed, 27 Jun 2035 04:10:06 GMT; Secure; HttpOnly
+Set-Cookie: Rc7JOK6A=qcjDbEW9gW4TgljZHkNGugGY94y64ae2bJP0fGJNNMYZIeTdQINsDzQaJVnbl1GZ; Domain=.example.com; Path=/; Expires=Wed, 27 Jun 2035 04:10:06 GMT; Secure; HttpOnly
+
@@ -0,0 +1,3 @@
+HTTP/1.1 204 No Content
+Date: Sat, 27 Jun 2015 04:10:06 GMT
+
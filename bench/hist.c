@@ -0,0 +1,122 @@
+/**
+ *  hist.c
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ */
+
+#include <string.h>
+#include "hist.h"
+
+
+static inline int hist_index( uint64_t v )
+{
+    int e = 0;
+
+    if( v < HIST_NSUB * 2 ){
+        return (int)v;
+    }
+    // position of the most significant bit: 7-63
+    e = 63 - __builtin_clzll( v );
+
+    return HIST_NSUB * 2 + ( e - 7 ) * HIST_NSUB +
+           (int)( ( v >> ( e - 6 ) ) - HIST_NSUB );
+}
+
+
+/**
+ * highest value of the bucket
+ */
+static inline uint64_t hist_value( int idx )
+{
+    int e = 0;
+    uint64_t sub = 0;
+
+    if( idx < HIST_NSUB * 2 ){
+        return (uint64_t)idx;
+    }
+    idx -= HIST_NSUB * 2;
+    e = idx / HIST_NSUB + 7;
+    sub = (uint64_t)( idx % HIST_NSUB + HIST_NSUB );
+
+    return ( ( sub + 1 ) << ( e - 6 ) ) - 1;
+}
+
+
+void hist_init( hist_t *h )
+{
+    memset( h, 0, sizeof( hist_t ) );
+    h->min = UINT64_MAX;
+}
+
+
+void hist_record( hist_t *h, uint64_t v )
+{
+    h->buckets[hist_index( v )]++;
+    h->count++;
+    h->sum += v;
+    if( v < h->min ){
+        h->min = v;
+    }
+    if( v > h->max ){
+        h->max = v;
+    }
+}
+
+
+void hist_merge( hist_t *dst, const hist_t *src )
+{
+    int i = 0;
+
+    for(; i < HIST_NBUCKET; i++ ){
+        dst->buckets[i] += src->buckets[i];
+    }
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if( src->min < dst->min ){
+        dst->min = src->min;
+    }
+    if( src->max > dst->max ){
+        dst->max = src->max;
+    }
+}
+
+
+uint64_t hist_percentile( const hist_t *h, double p )
+{
+    uint64_t rank = 0;
+    uint64_t n = 0;
+    int i = 0;
+
+    if( !h->count ){
+        return 0;
+    }
+    rank = (uint64_t)( p / 100.0 * (double)h->count + 0.5 );
+    if( rank < 1 ){
+        rank = 1;
+    }
+    for(; i < HIST_NBUCKET; i++ )
+    {
+        n += h->buckets[i];
+        if( n >= rank ){
+            uint64_t v = hist_value( i );
+            return v > h->max ? h->max : v;
+        }
+    }
+
+    return h->max;
+}
+
+
+void hist_print( const hist_t *h, FILE *fp, const char *unit, double div )
+{
+    fprintf( fp, "\tcount %llu, mean %.2f%s, min %.2f%s, max %.2f%s\n",
+             (unsigned long long)h->count,
+             h->count ? (double)h->sum / (double)h->count / div : 0, unit,
+             h->count ? (double)h->min / div : 0, unit,
+             (double)h->max / div, unit );
+    fprintf( fp, "\tp50 %.2f%s, p90 %.2f%s, p99 %.2f%s, p99.9 %.2f%s\n",
+             (double)hist_percentile( h, 50 ) / div, unit,
+             (double)hist_percentile( h, 90 ) / div, unit,
+             (double)hist_percentile( h, 99 ) / div, unit,
+             (double)hist_percentile( h, 99.9 ) / div, unit );
+}
+
@@ -0,0 +1,44 @@
+/**
+ *  hist.h
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  HDR-style log-linear histogram.
+ *  values below 128 are recorded exactly, and each power of 2 range above
+ *  it is divided into 64 sub-buckets, so the relative error of the recorded
+ *  values is less than 1/64.
+ */
+
+#ifndef BENCH_HIST_H
+#define BENCH_HIST_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define HIST_NSUB       64
+#define HIST_NBUCKET    (HIST_NSUB * 2 + ( 63 - 7 + 1 ) * HIST_NSUB)
+
+typedef struct {
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+    uint64_t buckets[HIST_NBUCKET];
+} hist_t;
+
+
+void hist_init( hist_t *h );
+void hist_record( hist_t *h, uint64_t v );
+void hist_merge( hist_t *dst, const hist_t *src );
+
+/**
+ * return the value at the percentile p (0-100)
+ */
+uint64_t hist_percentile( const hist_t *h, double p );
+
+/**
+ * print the count, mean, percentiles and max in the unit of 1/div
+ */
+void hist_print( const hist_t *h, FILE *fp, const char *unit, double div );
+
+
+#endif
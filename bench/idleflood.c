@@ -0,0 +1,420 @@
+/**
+ *  idleflood.c
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  opens a large number of idle connections to the server and reports when
+ *  the server closes them, to test the connection deadlines of the server.
+ *
+ *  -m selects what the connections do after the connect:
+ *
+ *    silent:    send nothing (closed by the header deadline)
+ *    keepalive: send a request, read the response and then send nothing
+ *               (closed by the idle deadline)
+ *    slowloris: send the request head one byte at every -i milliseconds
+ *               and never finish it (closed by the header deadline)
+ *
+ *  the time to the close is measured from the call of connect, or from the
+ *  write of the request of the keep-alive connection, so it never includes
+ *  the delay of this loop before the server starts the deadline.
+ *
+ *  the connections to 127.0.0.1 rotate the source address over 127.0.0.2
+ *  ... every CONN_PER_ADDR connections, so the number of the connections is
+ *  not limited by the ephemeral ports. the limit of the open files is raised
+ *  to the hard limit.
+ *
+ *  usage: idleflood [-a addr] [-p port] [-n connections] [-d seconds]
+ *                   [-m silent|keepalive|slowloris] [-i msec]
+ *
+ *      $ ./server -p 8080 -t 1 -T 10:30:60 &
+ *      $ ./idleflood -p 8080 -n 200000 -d 15
+ */
+
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "timer.h"
+
+#define NEVENT          1024
+/* connects in progress */
+#define MAXCONNECTING   512
+#define CONN_PER_ADDR   20000
+
+#ifndef IP_BIND_ADDRESS_NO_PORT
+#define IP_BIND_ADDRESS_NO_PORT 24
+#endif
+
+static const char REQUEST[] = "GET / HTTP/1.1\r\n"
+                              "Host: localhost\r\n"
+                              "\r\n";
+/* the head of slowloris that is never finished */
+static const char DRIBBLE[] = "GET / HTTP/1.1\r\n"
+                              "Host: localhost\r\n"
+                              "X-Dribble: aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\r\n";
+
+
+enum {
+    MODE_SILENT = 0,
+    MODE_KEEPALIVE,
+    MODE_SLOWLORIS
+};
+
+
+enum {
+    CONN_NONE = 0,
+    CONN_CONNECTING,
+    CONN_OPEN,
+    CONN_CLOSED
+};
+
+
+typedef struct {
+    int fd;
+    int state;
+    /* bytes sent of the request */
+    size_t sent;
+    uint64_t t0;
+} conn_t;
+
+
+typedef struct {
+    const char *addr;
+    uint16_t port;
+    int nconn;
+    int duration;
+    int mode;
+    int interval;
+} cfg_t;
+
+
+typedef struct {
+    int nopen;
+    int nconnecting;
+    int nclosed;
+    int nfail;
+    int nreset;
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+} stat_t;
+
+
+static volatile int Stop = 0;
+
+
+static void on_signal( int signo )
+{
+    (void)signo;
+    Stop = 1;
+}
+
+
+static int conn_connect( const cfg_t *cfg, conn_t *c, int epfd, int i )
+{
+    struct sockaddr_in addr;
+    struct epoll_event ev;
+    int enable = 1;
+
+    c->fd = socket( AF_INET, SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC, 0 );
+    if( c->fd == -1 ){
+        return -1;
+    }
+
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sin_family = AF_INET;
+    // rotate the source address of the loopback
+    if( strcmp( cfg->addr, "127.0.0.1" ) == 0 )
+    {
+        addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK + 1 +
+                                      (uint32_t)( i / CONN_PER_ADDR ) );
+        // pick the port at the connect by the 4-tuple
+        setsockopt( c->fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &enable,
+                    sizeof( enable ) );
+        if( bind( c->fd, (struct sockaddr*)&addr, sizeof( addr ) ) ){
+            close( c->fd );
+            return -1;
+        }
+    }
+
+    addr.sin_port = htons( cfg->port );
+    inet_pton( AF_INET, cfg->addr, &addr.sin_addr );
+    ev.events = EPOLLIN|EPOLLOUT|EPOLLRDHUP|EPOLLET;
+    ev.data.u32 = (uint32_t)i;
+    if( ( connect( c->fd, (struct sockaddr*)&addr, sizeof( addr ) ) &&
+          errno != EINPROGRESS ) ||
+        epoll_ctl( epfd, EPOLL_CTL_ADD, c->fd, &ev ) ){
+        close( c->fd );
+        return -1;
+    }
+    c->state = CONN_CONNECTING;
+    c->t0 = timer_ns();
+
+    return 0;
+}
+
+
+static void conn_write( const cfg_t *cfg, conn_t *c, size_t len )
+{
+    const char *data = cfg->mode == MODE_SLOWLORIS ? DRIBBLE : REQUEST;
+    size_t size = cfg->mode == MODE_SLOWLORIS ? sizeof( DRIBBLE ) - 1 :
+                                                sizeof( REQUEST ) - 1;
+    ssize_t n = 0;
+
+    if( c->sent + len > size ){
+        len = size - c->sent;
+    }
+    if( len && ( n = write( c->fd, data + c->sent, len ) ) > 0 ){
+        c->sent += (size_t)n;
+    }
+}
+
+
+static void conn_closed( conn_t *c, stat_t *s, int reset )
+{
+    uint64_t t = timer_ns() - c->t0;
+
+    close( c->fd );
+    c->state = CONN_CLOSED;
+    s->nopen--;
+    s->nclosed++;
+    s->nreset += reset;
+    s->sum += t;
+    if( t < s->min ){
+        s->min = t;
+    }
+    if( t > s->max ){
+        s->max = t;
+    }
+}
+
+
+static void conn_event( const cfg_t *cfg, conn_t *c, uint32_t events,
+                        stat_t *s )
+{
+    char buf[4096];
+    ssize_t n = 0;
+
+    if( c->state == CONN_CONNECTING )
+    {
+        s->nconnecting--;
+        if( events & ( EPOLLERR|EPOLLHUP ) ){
+            close( c->fd );
+            c->state = CONN_NONE;
+            s->nfail++;
+            return;
+        }
+        c->state = CONN_OPEN;
+        s->nopen++;
+        if( cfg->mode == MODE_KEEPALIVE ){
+            // the idle time starts after the response of the request
+            c->t0 = timer_ns();
+            conn_write( cfg, c, sizeof( REQUEST ) - 1 );
+        }
+        else if( cfg->mode == MODE_SLOWLORIS ){
+            conn_write( cfg, c, 1 );
+        }
+    }
+    if( c->state != CONN_OPEN || !( events & ( EPOLLIN|EPOLLRDHUP|EPOLLHUP|
+                                               EPOLLERR ) ) ){
+        return;
+    }
+
+    for(;;)
+    {
+        n = read( c->fd, buf, sizeof( buf ) );
+        if( n > 0 ){
+            continue;
+        }
+        else if( n == 0 ){
+            conn_closed( c, s, 0 );
+        }
+        else if( errno == EINTR ){
+            continue;
+        }
+        else if( errno != EAGAIN ){
+            conn_closed( c, s, 1 );
+        }
+        return;
+    }
+}
+
+
+static void print_stat( double t, const stat_t *s )
+{
+    printf( "%8.1f %10d %10d %10d\n", t, s->nopen, s->nclosed, s->nfail );
+    fflush( stdout );
+}
+
+
+int main( int argc, char *argv[] )
+{
+    cfg_t cfg = {
+        .addr = "127.0.0.1",
+        .port = 8080,
+        .nconn = 200000,
+        .duration = 75,
+        .mode = MODE_SILENT,
+        .interval = 1000
+    };
+    stat_t s = {
+        .min = UINT64_MAX
+    };
+    struct epoll_event evs[NEVENT];
+    struct rlimit rl;
+    conn_t *conns = NULL;
+    uint64_t start = 0;
+    uint64_t now = 0;
+    uint64_t report = 0;
+    uint64_t dribble = 0;
+    int next = 0;
+    int epfd = 0;
+    int nev = 0;
+    int opt = 0;
+    int i = 0;
+
+    while( ( opt = getopt( argc, argv, "a:p:n:d:m:i:" ) ) != -1 )
+    {
+        switch( opt ){
+            case 'a':
+                cfg.addr = optarg;
+            break;
+            case 'p':
+                cfg.port = (uint16_t)atoi( optarg );
+            break;
+            case 'n':
+                cfg.nconn = atoi( optarg );
+            break;
+            case 'd':
+                cfg.duration = atoi( optarg );
+            break;
+            case 'i':
+                cfg.interval = atoi( optarg );
+            break;
+            case 'm':
+                if( strcmp( optarg, "silent" ) == 0 ){
+                    cfg.mode = MODE_SILENT;
+                    break;
+                }
+                else if( strcmp( optarg, "keepalive" ) == 0 ){
+                    cfg.mode = MODE_KEEPALIVE;
+                    break;
+                }
+                else if( strcmp( optarg, "slowloris" ) == 0 ){
+                    cfg.mode = MODE_SLOWLORIS;
+                    break;
+                }
+                // invalid mode
+                // fall through
+            default:
+                fprintf( stderr, "usage: %s [-a addr] [-p port] "
+                         "[-n connections] [-d seconds] "
+                         "[-m silent|keepalive|slowloris] [-i msec]\n",
+                         argv[0] );
+                return EXIT_FAILURE;
+        }
+    }
+    if( cfg.nconn < 1 || cfg.duration < 1 || cfg.interval < 1 ){
+        fprintf( stderr, "invalid arguments\n" );
+        return EXIT_FAILURE;
+    }
+
+    // descriptors of the connections
+    if( getrlimit( RLIMIT_NOFILE, &rl ) == 0 )
+    {
+        if( rl.rlim_cur < rl.rlim_max ){
+            rl.rlim_cur = rl.rlim_max;
+            setrlimit( RLIMIT_NOFILE, &rl );
+        }
+        if( rl.rlim_cur < (rlim_t)cfg.nconn + 16 ){
+            printf( "limit of the open files is %llu: open %llu "
+                    "connections\n", (unsigned long long)rl.rlim_cur,
+                    (unsigned long long)rl.rlim_cur - 16 );
+            cfg.nconn = (int)rl.rlim_cur - 16;
+        }
+    }
+
+    signal( SIGINT, on_signal );
+    signal( SIGPIPE, SIG_IGN );
+    conns = calloc( (size_t)cfg.nconn, sizeof( conn_t ) );
+    if( !conns || ( epfd = epoll_create1( EPOLL_CLOEXEC ) ) == -1 ){
+        perror( "epoll_create1" );
+        return EXIT_FAILURE;
+    }
+
+    printf( "%d %s connections, %d seconds: %s:%d\n", cfg.nconn,
+            cfg.mode == MODE_SILENT ? "silent" :
+            cfg.mode == MODE_KEEPALIVE ? "keepalive" : "slowloris",
+            cfg.duration, cfg.addr, cfg.port );
+    printf( "%8s %10s %10s %10s\n", "sec", "open", "closed", "failed" );
+    start = report = dribble = timer_ns();
+    while( !Stop )
+    {
+        now = timer_ns();
+        if( now - start >= (uint64_t)cfg.duration * 1000000000ULL ||
+            ( next == cfg.nconn && !s.nopen && !s.nconnecting ) ){
+            break;
+        }
+
+        // keep up to MAXCONNECTING connects in progress
+        for(; next < cfg.nconn && s.nconnecting < MAXCONNECTING; next++ )
+        {
+            if( conn_connect( &cfg, &conns[next], epfd, next ) ){
+                s.nfail++;
+                continue;
+            }
+            s.nconnecting++;
+        }
+
+        nev = epoll_wait( epfd, evs, NEVENT, 100 );
+        for( i = 0; i < nev; i++ ){
+            conn_event( &cfg, &conns[evs[i].data.u32], evs[i].events, &s );
+        }
+
+        now = timer_ns();
+        if( cfg.mode == MODE_SLOWLORIS &&
+            now - dribble >= (uint64_t)cfg.interval * 1000000ULL )
+        {
+            for( i = 0; i < next; i++ )
+            {
+                if( conns[i].state == CONN_OPEN ){
+                    conn_write( &cfg, &conns[i], 1 );
+                }
+            }
+            dribble = now;
+        }
+        if( now - report >= 1000000000ULL ){
+            print_stat( (double)( now - start ) / 1e9, &s );
+            report = now;
+        }
+    }
+    print_stat( (double)( timer_ns() - start ) / 1e9, &s );
+
+    printf( "\t%d connected, %d closed by the server (%d reset), "
+            "%d still open, %d failed\n", s.nopen + s.nclosed, s.nclosed,
+            s.nreset, s.nopen, s.nfail );
+    if( s.nclosed ){
+        printf( "\tclosed after min %.2f / avg %.2f / max %.2f seconds\n",
+                (double)s.min / 1e9,
+                (double)s.sum / (double)s.nclosed / 1e9,
+                (double)s.max / 1e9 );
+    }
+
+    for( i = 0; i < cfg.nconn; i++ )
+    {
+        if( conns[i].state == CONN_OPEN || conns[i].state == CONN_CONNECTING ){
+            close( conns[i].fd );
+        }
+    }
+    close( epfd );
+    free( (void*)conns );
+
+    return s.nfail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,696 @@
+/**
+ *  loadgen.c
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  loopback load generator built on http_parse_response.
+ *
+ *  each thread drives its share of the connections with an epoll loop and
+ *  keeps the configured number of requests in-flight on every connection.
+ *  the latency of each request is measured from the time it is written to
+ *  the time its response is parsed, and recorded into the histogram.
+ *
+ *  usage: loadgen [-a addr] [-p port] [-c connections] [-t threads]
+ *                 [-d seconds] [-P pipeline] [-u uri[:weight]]...
+ *                 [-r file[:weight]]... [-H uri[:connections]]
+ *
+ *  -u adds a GET request of the uri, and -r adds the raw request read from
+ *  the file to the request mix. requests are picked by the weight.
+ *
+ *  -H skews the load: the given number of connections (1 by default) send
+ *  only the GET request of the uri, and their latency is reported apart
+ *  from the latency of the request mix.
+ *
+ *      $ ./loadgen -p 8080 -c 64 -t 2 -d 10 -P 4
+ *      $ ./loadgen -p 8080 -u /:99 -u /large:1
+ *      $ ./loadgen -p 8080 -c 64 -H /spin/2000:1
+ */
+
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "http.h"
+#include "http_rbuf.h"
+#include "hist.h"
+
+#define MAXREQ      64
+#define MAXPIPE     256
+#define NEVENT      256
+
+
+typedef struct {
+    char *data;
+    size_t len;
+    unsigned weight;
+} req_t;
+
+
+typedef struct {
+    const char *addr;
+    uint16_t port;
+    int nconn;
+    int nthread;
+    int duration;
+    int depth;
+    req_t reqs[MAXREQ];
+    int nreq;
+    unsigned total;
+    /* request of the skewed connections */
+    req_t heavy;
+    const char *heavyuri;
+    int nheavy;
+} cfg_t;
+
+
+typedef struct {
+    int fd;
+    /* sends only the heavy request */
+    int heavy;
+    http_t *h;
+    http_rbuf_t *b;
+    /* remaining response-body bytes */
+    size_t skip;
+    int closing;
+    /* send time of the in-flight requests */
+    uint64_t sent[MAXPIPE];
+    unsigned head;
+    unsigned tail;
+    /* request bytes that could not be written */
+    char *out;
+    size_t outlen;
+    size_t outsize;
+} conn_t;
+
+
+typedef struct {
+    const cfg_t *cfg;
+    pthread_t tid;
+    int nconn;
+    /* index of the first connection */
+    int first;
+    unsigned seed;
+    uint64_t nres;
+    uint64_t nbyte;
+    uint64_t nerr;
+    uint64_t nconnect;
+    hist_t hist;
+    hist_t heavy;
+} worker_t;
+
+
+static volatile int Stop = 0;
+
+
+static inline uint64_t now_ns( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+
+static int conn_connect( const cfg_t *cfg, conn_t *c )
+{
+    struct sockaddr_in addr;
+    int enable = 1;
+
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons( cfg->port );
+    inet_pton( AF_INET, cfg->addr, &addr.sin_addr );
+
+    c->fd = socket( AF_INET, SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC, 0 );
+    if( c->fd == -1 ){
+        return -1;
+    }
+    setsockopt( c->fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof( enable ) );
+    if( connect( c->fd, (struct sockaddr*)&addr, sizeof( addr ) ) &&
+        errno != EINPROGRESS ){
+        close( c->fd );
+        c->fd = -1;
+        return -1;
+    }
+    http_init( c->h );
+    http_rbuf_consume( c->b, http_rbuf_msglen( c->b ) );
+    c->skip = 0;
+    c->closing = 0;
+    c->head = c->tail = 0;
+    c->outlen = 0;
+
+    return 0;
+}
+
+
+static int conn_save( conn_t *c, const char *data, size_t len )
+{
+    if( c->outlen + len > c->outsize )
+    {
+        size_t size = c->outsize ? c->outsize : 4096;
+        char *out = NULL;
+
+        while( size < c->outlen + len ){
+            size <<= 1;
+        }
+        if( !( out = (char*)realloc( c->out, size ) ) ){
+            return -1;
+        }
+        c->out = out;
+        c->outsize = size;
+    }
+    memcpy( c->out + c->outlen, data, len );
+    c->outlen += len;
+
+    return 0;
+}
+
+
+static int conn_flush( conn_t *c )
+{
+    size_t cur = 0;
+    ssize_t n = 0;
+
+    while( cur < c->outlen )
+    {
+        n = write( c->fd, c->out + cur, c->outlen - cur );
+        if( n > 0 ){
+            cur += (size_t)n;
+        }
+        else if( n == -1 && errno == EINTR ){
+            continue;
+        }
+        else if( n == -1 && errno == EAGAIN ){
+            break;
+        }
+        else {
+            return -1;
+        }
+    }
+    c->outlen -= cur;
+    if( c->outlen ){
+        memmove( c->out, c->out + cur, c->outlen );
+    }
+
+    return 0;
+}
+
+
+/**
+ * fill the pipeline by the requests picked from the request mix
+ */
+static int conn_fill( worker_t *w, conn_t *c )
+{
+    const cfg_t *cfg = w->cfg;
+    uint64_t t = 0;
+    unsigned r = 0;
+    int i = 0;
+
+    if( c->closing || c->tail - c->head >= (unsigned)cfg->depth ){
+        return 0;
+    }
+
+    t = now_ns();
+    while( c->tail - c->head < (unsigned)cfg->depth )
+    {
+        if( c->heavy ){
+            if( conn_save( c, cfg->heavy.data, cfg->heavy.len ) ){
+                return -1;
+            }
+        }
+        else
+        {
+            r = (unsigned)rand_r( &w->seed ) % cfg->total;
+            for( i = 0; r >= cfg->reqs[i].weight; i++ ){
+                r -= cfg->reqs[i].weight;
+            }
+            if( conn_save( c, cfg->reqs[i].data, cfg->reqs[i].len ) ){
+                return -1;
+            }
+        }
+        c->sent[c->tail++ % MAXPIPE] = t;
+    }
+
+    return conn_flush( c );
+}
+
+
+static size_t content_length( http_t *h, const char *msg )
+{
+    uintptr_t key, val;
+    uint16_t klen, vlen;
+    size_t n = 0;
+    uint16_t i = 0;
+    uint8_t at = 0;
+
+    for(; at < h->nheader; at++ )
+    {
+        http_getheader_at( h, &key, &klen, &val, &vlen, at );
+        if( klen == 14 && !memcmp( msg + key, "content-length", 14 ) ){
+            for( i = 0; i < vlen; i++ ){
+                n = n * 10 + (size_t)( msg[val + i] - '0' );
+            }
+        }
+        else if( klen == 10 && !memcmp( msg + key, "connection", 10 ) &&
+                 vlen == 5 && !strncasecmp( msg + val, "close", 5 ) ){
+            return SIZE_MAX;
+        }
+    }
+
+    return n;
+}
+
+
+/**
+ * parse the buffered responses
+ */
+static int conn_process( worker_t *w, conn_t *c )
+{
+    uint64_t t = 0;
+    size_t len = 0;
+    int rc = 0;
+
+    for(;;)
+    {
+        // discard the response-body
+        if( c->skip )
+        {
+            len = http_rbuf_msglen( c->b );
+            if( len > c->skip ){
+                len = c->skip;
+            }
+            http_rbuf_consume( c->b, len );
+            if( ( c->skip -= len ) ){
+                return 0;
+            }
+            t = now_ns();
+            hist_record( c->heavy ? &w->heavy : &w->hist,
+                         t - c->sent[c->head++ % MAXPIPE] );
+            w->nres++;
+            if( c->closing ){
+                return -1;
+            }
+        }
+        if( !http_rbuf_msglen( c->b ) ){
+            return 0;
+        }
+
+        rc = http_rbuf_parse_response( c->b, c->h, UINT16_MAX );
+        if( rc == HTTP_EAGAIN ){
+            return 0;
+        }
+        else if( rc != HTTP_SUCCESS || c->head == c->tail ){
+            w->nerr++;
+            return -1;
+        }
+
+        len = content_length( c->h, http_rbuf_msg( c->b ) );
+        // reconnect after the response-body
+        if( len == SIZE_MAX ){
+            c->closing = 1;
+            len = 0;
+        }
+        w->nbyte += c->h->cur + len;
+        http_rbuf_consume( c->b, c->h->cur );
+        http_init( c->h );
+        if( !( c->skip = len ) ){
+            t = now_ns();
+            hist_record( c->heavy ? &w->heavy : &w->hist,
+                         t - c->sent[c->head++ % MAXPIPE] );
+            w->nres++;
+            if( c->closing ){
+                return -1;
+            }
+        }
+    }
+}
+
+
+static int conn_read( worker_t *w, conn_t *c )
+{
+    size_t space = 0;
+    char *tail = NULL;
+    ssize_t n = 0;
+
+    for(;;)
+    {
+        if( !( tail = http_rbuf_reserve( c->b, &space ) ) ){
+            w->nerr++;
+            return -1;
+        }
+
+        n = read( c->fd, tail, space );
+        if( n > 0 ){
+            http_rbuf_commit( c->b, (size_t)n );
+            if( conn_process( w, c ) ){
+                return -1;
+            }
+        }
+        else if( n == 0 ){
+            return -1;
+        }
+        else if( errno == EAGAIN ){
+            break;
+        }
+        else if( errno != EINTR ){
+            w->nerr++;
+            return -1;
+        }
+    }
+
+    return conn_fill( w, c );
+}
+
+
+static int conn_open( worker_t *w, int epfd, conn_t *c )
+{
+    struct epoll_event ev;
+
+    if( conn_connect( w->cfg, c ) ){
+        w->nerr++;
+        return -1;
+    }
+    w->nconnect++;
+    ev.events = EPOLLIN|EPOLLOUT|EPOLLRDHUP|EPOLLET;
+    ev.data.ptr = c;
+    if( epoll_ctl( epfd, EPOLL_CTL_ADD, c->fd, &ev ) ){
+        close( c->fd );
+        c->fd = -1;
+        w->nerr++;
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static void *worker( void *arg )
+{
+    worker_t *w = (worker_t*)arg;
+    struct epoll_event evs[NEVENT];
+    conn_t *conns = calloc( (size_t)w->nconn, sizeof( conn_t ) );
+    conn_t *c = NULL;
+    int epfd = epoll_create1( EPOLL_CLOEXEC );
+    int nev = 0;
+    int i = 0;
+
+    if( !conns || epfd == -1 ){
+        perror( "worker" );
+        Stop = 1;
+        return NULL;
+    }
+
+    for( i = 0; i < w->nconn; i++ )
+    {
+        c = &conns[i];
+        c->heavy = w->first + i < w->cfg->nheavy;
+        c->h = http_alloc( 64 );
+        c->b = http_rbuf_alloc( 4096, 1024 * 1024 );
+        if( !c->h || !c->b ){
+            perror( "worker" );
+            Stop = 1;
+            return NULL;
+        }
+        if( conn_open( w, epfd, c ) == 0 && conn_fill( w, c ) ){
+            close( c->fd );
+            c->fd = -1;
+        }
+    }
+
+    while( !Stop )
+    {
+        nev = epoll_wait( epfd, evs, NEVENT, 100 );
+        for( i = 0; i < nev; i++ )
+        {
+            c = (conn_t*)evs[i].data.ptr;
+            if( ( evs[i].events & EPOLLERR ) ||
+                ( ( evs[i].events & EPOLLOUT ) && conn_flush( c ) ) ||
+                ( ( evs[i].events & ( EPOLLIN|EPOLLRDHUP|EPOLLHUP ) ) &&
+                  conn_read( w, c ) ) )
+            {
+                // reconnect
+                close( c->fd );
+                c->fd = -1;
+                if( !Stop && conn_open( w, epfd, c ) == 0 &&
+                    conn_fill( w, c ) ){
+                    close( c->fd );
+                    c->fd = -1;
+                }
+            }
+        }
+    }
+
+    for( i = 0; i < w->nconn; i++ )
+    {
+        c = &conns[i];
+        if( c->fd != -1 ){
+            close( c->fd );
+        }
+        http_free( c->h );
+        http_rbuf_free( c->b );
+        free( (void*)c->out );
+    }
+    free( (void*)conns );
+    close( epfd );
+
+    return NULL;
+}
+
+
+/**
+ * load the request of arg[:weight]
+ */
+static int load_req( req_t *r, char *arg, int isfile )
+{
+    char *sep = strrchr( arg, ':' );
+    unsigned weight = 1;
+
+    if( sep && sep[1] ){
+        *sep = 0;
+        weight = (unsigned)atoi( sep + 1 );
+    }
+
+    if( isfile )
+    {
+        struct stat st;
+        int fd = open( arg, O_RDONLY );
+
+        if( fd == -1 || fstat( fd, &st ) ||
+            !( r->data = malloc( (size_t)st.st_size ) ) ||
+            read( fd, r->data, (size_t)st.st_size ) != st.st_size ){
+            perror( arg );
+            return -1;
+        }
+        close( fd );
+        r->len = (size_t)st.st_size;
+    }
+    else
+    {
+        size_t len = strlen( arg ) + 64;
+
+        if( !( r->data = malloc( len ) ) ){
+            perror( "malloc" );
+            return -1;
+        }
+        r->len = (size_t)snprintf( r->data, len,
+                                   "GET %s HTTP/1.1\r\n"
+                                   "Host: localhost\r\n"
+                                   "\r\n", arg );
+    }
+    r->weight = weight;
+
+    return 0;
+}
+
+
+/**
+ * add the request with its weight to the request mix
+ */
+static int add_req( cfg_t *cfg, char *arg, int isfile )
+{
+    req_t *r = &cfg->reqs[cfg->nreq];
+
+    if( cfg->nreq == MAXREQ ){
+        fprintf( stderr, "too many requests\n" );
+        return -1;
+    }
+    else if( load_req( r, arg, isfile ) ){
+        return -1;
+    }
+    cfg->total += r->weight;
+    cfg->nreq++;
+
+    return 0;
+}
+
+
+static void on_signal( int signo )
+{
+    (void)signo;
+    Stop = 1;
+}
+
+
+int main( int argc, char *argv[] )
+{
+    cfg_t cfg = {
+        .addr = "127.0.0.1",
+        .port = 8080,
+        .nconn = 64,
+        .nthread = 1,
+        .duration = 10,
+        .depth = 1,
+        .nreq = 0,
+        .total = 0,
+        .nheavy = 0
+    };
+    char defreq[] = "/";
+    worker_t *workers = NULL;
+    hist_t *hist = NULL;
+    uint64_t nres = 0, nbyte = 0, nerr = 0, nconnect = 0;
+    uint64_t start = 0;
+    double elapsed = 0;
+    int first = 0;
+    int opt = 0;
+    int i = 0;
+
+    while( ( opt = getopt( argc, argv, "a:p:c:t:d:P:u:r:H:" ) ) != -1 )
+    {
+        switch( opt ){
+            case 'a':
+                cfg.addr = optarg;
+            break;
+            case 'p':
+                cfg.port = (uint16_t)atoi( optarg );
+            break;
+            case 'c':
+                cfg.nconn = atoi( optarg );
+            break;
+            case 't':
+                cfg.nthread = atoi( optarg );
+            break;
+            case 'd':
+                cfg.duration = atoi( optarg );
+            break;
+            case 'P':
+                cfg.depth = atoi( optarg );
+            break;
+            case 'u':
+            case 'r':
+                if( add_req( &cfg, optarg, opt == 'r' ) ){
+                    return EXIT_FAILURE;
+                }
+            break;
+            case 'H':
+                free( (void*)cfg.heavy.data );
+                if( load_req( &cfg.heavy, optarg, 0 ) ){
+                    return EXIT_FAILURE;
+                }
+                cfg.heavyuri = optarg;
+                cfg.nheavy = (int)cfg.heavy.weight;
+            break;
+            default:
+                fprintf( stderr, "usage: %s [-a addr] [-p port] "
+                         "[-c connections] [-t threads] [-d seconds] "
+                         "[-P pipeline] [-u uri[:weight]]... "
+                         "[-r file[:weight]]... [-H uri[:connections]]\n",
+                         argv[0] );
+                return EXIT_FAILURE;
+        }
+    }
+    if( !cfg.nreq && add_req( &cfg, defreq, 0 ) ){
+        return EXIT_FAILURE;
+    }
+    else if( cfg.nthread < 1 || cfg.nconn < cfg.nthread ||
+             cfg.depth < 1 || cfg.depth > MAXPIPE || !cfg.total ||
+             cfg.nheavy < 0 || cfg.nheavy >= cfg.nconn ){
+        fprintf( stderr, "invalid arguments\n" );
+        return EXIT_FAILURE;
+    }
+
+    signal( SIGINT, on_signal );
+    signal( SIGPIPE, SIG_IGN );
+
+    workers = calloc( (size_t)cfg.nthread, sizeof( worker_t ) );
+    hist = malloc( sizeof( hist_t ) );
+    if( !workers || !hist ){
+        perror( "calloc" );
+        return EXIT_FAILURE;
+    }
+    hist_init( hist );
+
+    printf( "%d connections, %d threads, pipeline %d, %d seconds: %s:%d\n",
+            cfg.nconn, cfg.nthread, cfg.depth, cfg.duration, cfg.addr,
+            cfg.port );
+    start = now_ns();
+    for( i = 0; i < cfg.nthread; i++ )
+    {
+        workers[i].cfg = &cfg;
+        workers[i].nconn = cfg.nconn / cfg.nthread +
+                           ( i < cfg.nconn % cfg.nthread );
+        workers[i].first = first;
+        first += workers[i].nconn;
+        workers[i].seed = (unsigned)i + 1;
+        hist_init( &workers[i].hist );
+        hist_init( &workers[i].heavy );
+        if( pthread_create( &workers[i].tid, NULL, worker, &workers[i] ) ){
+            perror( "pthread_create" );
+            return EXIT_FAILURE;
+        }
+    }
+
+    for( i = 0; i < cfg.duration * 10 && !Stop; i++ ){
+        usleep( 100000 );
+    }
+    Stop = 1;
+
+    for( i = 0; i < cfg.nthread; i++ ){
+        pthread_join( workers[i].tid, NULL );
+        hist_merge( hist, &workers[i].hist );
+        nres += workers[i].nres;
+        nbyte += workers[i].nbyte;
+        nerr += workers[i].nerr;
+        nconnect += workers[i].nconnect;
+    }
+    elapsed = (double)( now_ns() - start ) / 1e9;
+
+    printf( "\t%llu responses in %.2f seconds, %llu connects, %llu errors\n",
+            (unsigned long long)nres, elapsed, (unsigned long long)nconnect,
+            (unsigned long long)nerr );
+    printf( "\t%.2f req/sec, %.2f MB/sec\n", (double)nres / elapsed,
+            (double)nbyte / elapsed / 1048576.0 );
+    printf( "latency:\n" );
+    hist_print( hist, stdout, "us", 1000.0 );
+    if( cfg.nheavy )
+    {
+        hist_init( hist );
+        for( i = 0; i < cfg.nthread; i++ ){
+            hist_merge( hist, &workers[i].heavy );
+        }
+        printf( "latency of %s on %d connections:\n", cfg.heavyuri,
+                cfg.nheavy );
+        hist_print( hist, stdout, "us", 1000.0 );
+    }
+
+    free( (void*)hist );
+    free( (void*)workers );
+    for( i = 0; i < cfg.nreq; i++ ){
+        free( (void*)cfg.reqs[i].data );
+    }
+    free( (void*)cfg.heavy.data );
+
+    return nres ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
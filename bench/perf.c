@@ -0,0 +1,158 @@
+/**
+ *  perf.c
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ */
+
+#include <unistd.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include "perf.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#endif
+
+
+const char *PERF_NAMES[PERF_NCOUNTER] = {
+    "instructions",
+    "cycles",
+    "branch_misses",
+    "l1d_misses"
+};
+
+
+#ifdef __linux__
+
+static int open_counter( uint32_t type, uint64_t config )
+{
+    struct perf_event_attr attr;
+
+    memset( &attr, 0, sizeof( attr ) );
+    attr.size = sizeof( attr );
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return (int)syscall( __NR_perf_event_open, &attr, 0, -1, -1, 0 );
+}
+
+
+unsigned perf_open( perf_t *p )
+{
+    unsigned available = 0;
+    int i = 0;
+
+    p->fd[PERF_INSTRUCTIONS] = open_counter( PERF_TYPE_HARDWARE,
+                                             PERF_COUNT_HW_INSTRUCTIONS );
+    p->fd[PERF_CYCLES] = open_counter( PERF_TYPE_HARDWARE,
+                                       PERF_COUNT_HW_CPU_CYCLES );
+    p->fd[PERF_BRANCH_MISSES] = open_counter( PERF_TYPE_HARDWARE,
+                                              PERF_COUNT_HW_BRANCH_MISSES );
+    p->fd[PERF_L1D_MISSES] = open_counter( PERF_TYPE_HW_CACHE,
+                                PERF_COUNT_HW_CACHE_L1D |
+                                PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                                PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+    for(; i < PERF_NCOUNTER; i++ )
+    {
+        if( p->fd[i] != -1 ){
+            available |= 1U << i;
+        }
+    }
+
+    return available;
+}
+
+
+void perf_close( perf_t *p )
+{
+    int i = 0;
+
+    for(; i < PERF_NCOUNTER; i++ )
+    {
+        if( p->fd[i] != -1 ){
+            close( p->fd[i] );
+            p->fd[i] = -1;
+        }
+    }
+}
+
+
+void perf_start( perf_t *p )
+{
+    int i = 0;
+
+    for(; i < PERF_NCOUNTER; i++ )
+    {
+        if( p->fd[i] != -1 ){
+            ioctl( p->fd[i], PERF_EVENT_IOC_RESET, 0 );
+        }
+    }
+    for( i = 0; i < PERF_NCOUNTER; i++ )
+    {
+        if( p->fd[i] != -1 ){
+            ioctl( p->fd[i], PERF_EVENT_IOC_ENABLE, 0 );
+        }
+    }
+}
+
+
+void perf_stop( perf_t *p, perf_sample_t *s )
+{
+    int i = 0;
+
+    for(; i < PERF_NCOUNTER; i++ )
+    {
+        if( p->fd[i] != -1 ){
+            ioctl( p->fd[i], PERF_EVENT_IOC_DISABLE, 0 );
+        }
+    }
+
+    s->available = 0;
+    for( i = 0; i < PERF_NCOUNTER; i++ )
+    {
+        s->value[i] = 0;
+        if( p->fd[i] != -1 &&
+            read( p->fd[i], &s->value[i], sizeof( uint64_t ) ) ==
+            sizeof( uint64_t ) ){
+            s->available |= 1U << i;
+        }
+    }
+}
+
+#else
+
+unsigned perf_open( perf_t *p )
+{
+    int i = 0;
+
+    for(; i < PERF_NCOUNTER; i++ ){
+        p->fd[i] = -1;
+    }
+
+    return 0;
+}
+
+
+void perf_close( perf_t *p )
+{
+    (void)p;
+}
+
+
+void perf_start( perf_t *p )
+{
+    (void)p;
+}
+
+
+void perf_stop( perf_t *p, perf_sample_t *s )
+{
+    (void)p;
+    memset( s, 0, sizeof( perf_sample_t ) );
+}
+
+#endif
+
@@ -0,0 +1,53 @@
+/**
+ *  perf.h
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  hardware performance counters of the calling thread by perf_event_open.
+ *  a counter that cannot be opened (no PMU, perf_event_paranoid, ...) is
+ *  reported as unavailable instead of failing the benchmark.
+ */
+
+#ifndef BENCH_PERF_H
+#define BENCH_PERF_H
+
+#include <stdint.h>
+
+enum {
+    PERF_INSTRUCTIONS = 0,
+    PERF_CYCLES,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_NCOUNTER
+};
+
+typedef struct {
+    int fd[PERF_NCOUNTER];
+} perf_t;
+
+typedef struct {
+    uint64_t value[PERF_NCOUNTER];
+    /* bit flags of the available counters */
+    unsigned available;
+} perf_sample_t;
+
+
+/**
+ * names of the counters
+ */
+extern const char *PERF_NAMES[PERF_NCOUNTER];
+
+
+/**
+ * open the counters and return the bit flags of the available counters
+ */
+unsigned perf_open( perf_t *p );
+void perf_close( perf_t *p );
+
+/**
+ * reset and enable the counters, and disable and read them
+ */
+void perf_start( perf_t *p );
+void perf_stop( perf_t *p, perf_sample_t *s );
+
+
+#endif
@@ -0,0 +1,43 @@
+/**
+ *  timer.h
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ */
+
+#ifndef BENCH_TIMER_H
+#define BENCH_TIMER_H
+
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC  1
+#endif
+
+
+/**
+ * monotonic time in nanoseconds
+ */
+static inline uint64_t timer_ns( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+
+/**
+ * time-stamp counter, or 0 if not available
+ */
+static inline uint64_t timer_cycles( void )
+{
+#ifdef HAVE_RDTSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+
+#endif
@@ -0,0 +1,194 @@
+/**
+ *  ring.h
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  bounded lock-free MPMC ring of pointers to hand the parsed requests
+ *  (http_snapshot) from the I/O loops to the workers and the responses back.
+ *
+ *  each cell has a sequence number that tells whether the cell is free for
+ *  the producer of the position or full for the consumer of the position, so
+ *  the producers and the consumers claim the positions by a CAS on their own
+ *  index and never wait for each other while the ring is neither full nor
+ *  empty. the indexes are on separate cache lines.
+ *
+ *  a batch claims the consecutive cells that are ready at its position by a
+ *  single CAS. the cells that are ready stay ready until they are claimed,
+ *  because only the owner of a position changes its cell.
+ */
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+
+#define RING_CACHELINE  64
+
+typedef struct {
+    size_t seq;
+    void *data;
+} ring_cell_t;
+
+typedef struct {
+    /* next position to enqueue */
+    size_t tail __attribute__((aligned(RING_CACHELINE)));
+    /* next position to dequeue */
+    size_t head __attribute__((aligned(RING_CACHELINE)));
+    size_t mask __attribute__((aligned(RING_CACHELINE)));
+    ring_cell_t *cells;
+} ring_t;
+
+
+#define RING_LOAD(p)    __atomic_load_n( p, __ATOMIC_ACQUIRE )
+#define RING_STORE(p,v) __atomic_store_n( p, v, __ATOMIC_RELEASE )
+
+
+/**
+ * allocate ring_t* of the size rounded up to a power of 2
+ * return NULL and set errno on failure.
+ */
+static inline ring_t *ring_alloc( size_t size )
+{
+    ring_t *r = NULL;
+    size_t n = 2;
+    size_t i = 0;
+
+    for(; n < size; n <<= 1 )
+    {
+        if( n > SIZE_MAX / 2 / sizeof( ring_cell_t ) ){
+            errno = EINVAL;
+            return NULL;
+        }
+    }
+
+    if( posix_memalign( (void**)&r, RING_CACHELINE, sizeof( ring_t ) ) ){
+        errno = ENOMEM;
+        return NULL;
+    }
+    else if( posix_memalign( (void**)&r->cells, RING_CACHELINE,
+                             n * sizeof( ring_cell_t ) ) ){
+        free( (void*)r );
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    r->tail = r->head = 0;
+    r->mask = n - 1;
+    for(; i < n; i++ ){
+        r->cells[i].seq = i;
+        r->cells[i].data = NULL;
+    }
+
+    return r;
+}
+
+
+static inline void ring_free( ring_t *r )
+{
+    free( (void*)r->cells );
+    free( (void*)r );
+}
+
+
+/**
+ * return the number of the consecutive cells from pos (up to n) whose
+ * sequence is the position + ready
+ */
+static inline size_t ring_ready( ring_t *r, size_t pos, size_t n,
+                                 size_t ready )
+{
+    size_t i = 0;
+
+    for(; i < n; i++ )
+    {
+        if( RING_LOAD( &r->cells[( pos + i ) & r->mask].seq ) !=
+            pos + i + ready ){
+            break;
+        }
+    }
+
+    return i;
+}
+
+
+/**
+ * claim up to n cells at the index idx, and return the number of the
+ * claimed cells from pos
+ */
+static inline size_t ring_claim( ring_t *r, size_t *idx, size_t *pos,
+                                 size_t n, size_t ready )
+{
+    size_t cur = __atomic_load_n( idx, __ATOMIC_RELAXED );
+    size_t nready = 0;
+
+    for(;;)
+    {
+        if( !( nready = ring_ready( r, cur, n, ready ) ) )
+        {
+            size_t seq = RING_LOAD( &r->cells[cur & r->mask].seq );
+
+            // full or empty
+            if( (intptr_t)( seq - ( cur + ready ) ) < 0 ){
+                return 0;
+            }
+            // claimed by another thread
+            cur = __atomic_load_n( idx, __ATOMIC_RELAXED );
+        }
+        else if( __atomic_compare_exchange_n( idx, &cur, cur + nready, 1,
+                                              __ATOMIC_RELAXED,
+                                              __ATOMIC_RELAXED ) ){
+            *pos = cur;
+            return nready;
+        }
+    }
+}
+
+
+/**
+ * enqueue up to n pointers in order, and return the number of the enqueued
+ * pointers, or 0 if the ring is full.
+ */
+static inline size_t ring_enqueue( ring_t *r, void *const *data, size_t n )
+{
+    size_t pos = 0;
+    size_t i = 0;
+
+    n = ring_claim( r, &r->tail, &pos, n, 0 );
+    for(; i < n; i++ )
+    {
+        ring_cell_t *c = &r->cells[( pos + i ) & r->mask];
+
+        c->data = data[i];
+        // full for the consumer of the position
+        RING_STORE( &c->seq, pos + i + 1 );
+    }
+
+    return n;
+}
+
+
+/**
+ * dequeue up to n pointers in order, and return the number of the dequeued
+ * pointers, or 0 if the ring is empty.
+ */
+static inline size_t ring_dequeue( ring_t *r, void **data, size_t n )
+{
+    size_t pos = 0;
+    size_t i = 0;
+
+    n = ring_claim( r, &r->head, &pos, n, 1 );
+    for(; i < n; i++ )
+    {
+        ring_cell_t *c = &r->cells[( pos + i ) & r->mask];
+
+        data[i] = c->data;
+        // free for the producer of the next lap
+        RING_STORE( &c->seq, pos + i + r->mask + 1 );
+    }
+
+    return n;
+}
+
+
+#endif
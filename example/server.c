@@ -0,0 +1,533 @@
+/**
+ *  server.c
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  reference HTTP/1.1 keep-alive server built on http_parse_request.
+ *
+ *  each thread runs its own event loop on its own SO_REUSEPORT listen
+ *  socket, so the kernel spreads the incoming connections over the loops
+ *  and no state is shared between them.
+ *
+ *  usage: server [-a addr] [-p port] [-t nthread] [-b bufsize] [-m maxhead]
+ *                [-e epoll|uring] [-s none|static|steal]
+ *                [-T header:body:idle]
+ *
+ *  -e uring runs the io_uring loop, and falls back to the epoll loop if the
+ *  kernel does not support it.
+ *
+ *  -s static runs the parsed requests as the tasks of the epoll loop that
+ *  parsed them (server_pool.c), and -s steal lets the idle loops steal the
+ *  tasks of the busy loops. GET /spin/<usec> burns the CPU for usec
+ *  microseconds (up to 1 second) to simulate an expensive request.
+ *
+ *  -T sets the header-read, body-read and keep-alive idle deadlines of the
+ *  epoll loop in seconds (default 10:30:60, 0 disables the deadline). the
+ *  connections that miss them are closed (server_epoll.c). the limit of the
+ *  open files is raised to the hard limit to keep the idle connections:
+ *
+ *      $ ./server -p 8080 -t 1 -T 10:30:60 &
+ *      $ ./idleflood -p 8080 -n 200000 -d 15
+ *
+ *  skewed load: 1 connection sends only the expensive requests, and the
+ *  latency of the other 63 connections depends on the loop that runs them.
+ *
+ *      $ ./server -p 8080 -t 4 -s static|steal &
+ *      $ ./loadgen -p 8080 -c 64 -t 1 -d 10 -H /spin/2000:1
+ *
+ *      $ ./server -p 8080 -t 4 &
+ *      $ curl -v http://127.0.0.1:8080/
+ *
+ *  measured by bench/loadgen over loopback with 64 connections:
+ *
+ *      $ ./loadgen -p 8080 -c 64 -t 1 -d 5 -P <pipeline>
+ *
+ *      cores  loop   pipeline       req/sec     p99
+ *      1      epoll  1               77,007     2.46ms
+ *      1      epoll  16             815,476     4.19ms
+ *      1      uring  1               79,487     1.77ms
+ *      1      uring  16             667,127     3.74ms
+ *
+ *  (Intel Xeon, 1 vCPU shared by the server and the load generator. run the
+ *   same commands with -t <ncore> on a larger host to fill in more rows.)
+ */
+
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "server.h"
+
+
+#define BODY    "Hello, World!"
+
+#define SPIN_URI    "/spin/"
+#define SPIN_MAX    1000000
+
+#define RES_OK_HEAD(conn) \
+    "HTTP/1.1 200 OK\r\n" \
+    "Content-Type: text/plain\r\n" \
+    "Content-Length: 13\r\n" \
+    conn \
+    "\r\n"
+
+static const char RES_OK[] = RES_OK_HEAD( "" ) BODY;
+// persistent connection of HTTP/1.0
+static const char RES_OK_KEEPALIVE[] =
+    RES_OK_HEAD( "Connection: keep-alive\r\n" ) BODY;
+static const char RES_OK_CLOSE[] = RES_OK_HEAD( "Connection: close\r\n" ) BODY;
+
+#define RES_ERROR(status) \
+    "HTTP/1.1 " status "\r\n" \
+    "Content-Length: 0\r\n" \
+    "Connection: close\r\n" \
+    "\r\n"
+
+static const char RES_400[] = RES_ERROR( "400 Bad Request" );
+static const char RES_414[] = RES_ERROR( "414 URI Too Long" );
+static const char RES_431[] = RES_ERROR( "431 Request Header Fields Too Large" );
+static const char RES_501[] = RES_ERROR( "501 Not Implemented" );
+static const char RES_505[] = RES_ERROR( "505 HTTP Version Not Supported" );
+
+#define SET_RES(res,str,c) do{ \
+    (res)->data = (str); \
+    (res)->len = sizeof( str ) - 1; \
+    (res)->close = (c); \
+}while(0)
+
+
+volatile int server_stop = 0;
+
+
+int server_listen( const server_cfg_t *cfg )
+{
+    struct sockaddr_in addr;
+    int fd = socket( AF_INET, SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC, 0 );
+    int enable = 1;
+
+    if( fd == -1 ){
+        return -1;
+    }
+
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons( cfg->port );
+    if( inet_pton( AF_INET, cfg->addr, &addr.sin_addr ) != 1 ){
+        errno = EINVAL;
+    }
+    else if( setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &enable,
+                         sizeof( enable ) ) == 0 &&
+             setsockopt( fd, SOL_SOCKET, SO_REUSEPORT, &enable,
+                         sizeof( enable ) ) == 0 &&
+             bind( fd, (struct sockaddr*)&addr, sizeof( addr ) ) == 0 &&
+             listen( fd, cfg->backlog ) == 0 ){
+        return fd;
+    }
+    close( fd );
+
+    return -1;
+}
+
+
+/**
+ * compare the header value case-insensitively
+ */
+static int hvaleq( const char *msg, uintptr_t val, uint16_t vlen,
+                   const char *str, size_t len )
+{
+    return vlen == len && strncasecmp( msg + val, str, len ) == 0;
+}
+
+
+/**
+ * burn the CPU for the microseconds of GET /spin/<usec>
+ */
+static void spin( http_t *h, const char *msg )
+{
+    const char *str = msg + h->msg + sizeof( SPIN_URI ) - 1;
+    const char *tail = msg + h->msg + h->msglen;
+    struct timespec ts;
+    uint64_t usec = 0;
+    uint64_t t = 0;
+
+    if( h->msglen < sizeof( SPIN_URI ) ||
+        memcmp( msg + h->msg, SPIN_URI, sizeof( SPIN_URI ) - 1 ) ){
+        return;
+    }
+    for(; str < tail && *str >= '0' && *str <= '9' && usec < SPIN_MAX; str++ ){
+        usec = usec * 10 + (uint64_t)( *str - '0' );
+    }
+    if( usec > SPIN_MAX ){
+        usec = SPIN_MAX;
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    t = (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+    do {
+        clock_gettime( CLOCK_MONOTONIC, &ts );
+    } while( (uint64_t)ts.tv_sec * 1000000ULL +
+             (uint64_t)ts.tv_nsec / 1000 - t < usec );
+}
+
+
+void server_handle( server_res_t *res, http_t *h, const char *msg )
+{
+    int keepalive = http_version( h ) == HTTP_V11;
+    uintptr_t key, val;
+    uint16_t klen, vlen;
+    uint8_t i = 0;
+    int clen = 0;
+
+    res->bodylen = 0;
+    if( http_method( h ) == HTTP_MGET ){
+        spin( h, msg );
+    }
+    // keys are lowercased by the parser
+    for(; i < h->nheader; i++ )
+    {
+        http_getheader_at( h, &key, &klen, &val, &vlen, i );
+        switch( klen ){
+            case 10:
+                if( !memcmp( msg + key, "connection", 10 ) )
+                {
+                    if( hvaleq( msg, val, vlen, "close", 5 ) ){
+                        keepalive = 0;
+                    }
+                    else if( hvaleq( msg, val, vlen, "keep-alive", 10 ) ){
+                        keepalive = 1;
+                    }
+                }
+            break;
+
+            case 14:
+                if( !memcmp( msg + key, "content-length", 14 ) )
+                {
+                    const char *str = msg + val;
+                    const char *tail = str + vlen;
+                    size_t n = 0;
+                    size_t d = 0;
+
+                    if( str == tail ){
+                        SET_RES( res, RES_400, 1 );
+                        return;
+                    }
+                    for(; str < tail; str++ )
+                    {
+                        d = (size_t)( *str - '0' );
+                        if( *str < '0' || *str > '9' ||
+                            n > ( SIZE_MAX - d ) / 10 ){
+                            SET_RES( res, RES_400, 1 );
+                            return;
+                        }
+                        n = n * 10 + d;
+                    }
+                    // the repeated content-length must have the same value
+                    // (RFC 9112 6.3)
+                    if( clen && n != res->bodylen ){
+                        SET_RES( res, RES_400, 1 );
+                        return;
+                    }
+                    res->bodylen = n;
+                    clen = 1;
+                }
+            break;
+
+            case 17:
+                // chunked request-body is not supported
+                if( !memcmp( msg + key, "transfer-encoding", 17 ) ){
+                    SET_RES( res, RES_501, 1 );
+                    return;
+                }
+            break;
+        }
+    }
+
+    if( !keepalive ){
+        SET_RES( res, RES_OK_CLOSE, 1 );
+    }
+    // HTTP/1.0 client waits for the close without the keep-alive
+    else if( http_version( h ) != HTTP_V11 ){
+        SET_RES( res, RES_OK_KEEPALIVE, 0 );
+    }
+    else {
+        SET_RES( res, RES_OK, 0 );
+    }
+    // the response to HEAD has no body
+    if( http_method( h ) == HTTP_MHEAD ){
+        res->len -= sizeof( BODY ) - 1;
+    }
+}
+
+
+void server_error( server_res_t *res, int rc )
+{
+    res->bodylen = 0;
+    switch( rc ){
+        // head budget exhausted
+        case HTTP_EAGAIN:
+        case HTTP_EHDRLEN:
+        case HTTP_ENHDR:
+            SET_RES( res, RES_431, 1 );
+        break;
+
+        case HTTP_EURILEN:
+            SET_RES( res, RES_414, 1 );
+        break;
+
+        case HTTP_EMETHOD:
+            SET_RES( res, RES_501, 1 );
+        break;
+
+        case HTTP_EVERSION:
+            SET_RES( res, RES_505, 1 );
+        break;
+
+        default:
+            SET_RES( res, RES_400, 1 );
+    }
+}
+
+
+typedef struct {
+    const server_cfg_t *cfg;
+    pthread_t tid;
+    int id;
+} worker_t;
+
+
+static void *worker( void *arg )
+{
+    worker_t *w = (worker_t*)arg;
+    int sfd = server_listen( w->cfg );
+
+    if( sfd == -1 ){
+        perror( "server_listen" );
+    }
+    else
+    {
+        // the pool runs on the epoll loops
+        if( !w->cfg->uring || w->cfg->sched ){
+            server_loop_epoll( w->cfg, sfd );
+        }
+        else if( server_loop_uring( w->cfg, sfd ) == -1 )
+        {
+            // fall back only if io_uring is not available
+            if( errno == ENOSYS ){
+                if( w->id == 0 ){
+                    fprintf( stderr, "io_uring is not supported: "
+                             "fall back to epoll\n" );
+                }
+                server_loop_epoll( w->cfg, sfd );
+            }
+            else {
+                perror( "server_loop_uring" );
+            }
+        }
+        close( sfd );
+    }
+
+    return NULL;
+}
+
+
+static int usage( const char *prog )
+{
+    fprintf( stderr, "usage: %s [-a addr] [-p port] [-t nthread] "
+             "[-b bufsize] [-m maxhead] [-e epoll|uring] "
+             "[-s none|static|steal] [-T header:body:idle]\n", prog );
+
+    return EXIT_FAILURE;
+}
+
+
+/**
+ * parse the deadlines of header:body:idle in seconds
+ */
+static int timeouts( server_cfg_t *cfg, const char *str )
+{
+    uint32_t *dst[] = {
+        &cfg->header_timeout, &cfg->body_timeout, &cfg->idle_timeout
+    };
+    char *tail = NULL;
+    unsigned long sec = 0;
+    int i = 0;
+
+    for(; i < 3; i++ )
+    {
+        sec = strtoul( str, &tail, 10 );
+        if( tail == str || sec > UINT32_MAX / 1000 ||
+            *tail != ( i < 2 ? ':' : 0 ) ){
+            return -1;
+        }
+        *dst[i] = (uint32_t)sec * 1000;
+        str = tail + 1;
+    }
+
+    return 0;
+}
+
+
+static void on_signal( int signo )
+{
+    (void)signo;
+    server_stop = 1;
+}
+
+
+int main( int argc, char *argv[] )
+{
+    server_cfg_t cfg = {
+        .addr = "127.0.0.1",
+        .port = 8080,
+        .nthread = (int)sysconf( _SC_NPROCESSORS_ONLN ),
+        .backlog = 4096,
+        .bufsize = 4096,
+        .maxhead = 65536,
+        .maxurilen = UINT16_MAX,
+        .maxhdrlen = UINT16_MAX,
+        .maxheader = 64,
+        .uring = 0,
+        .sched = SERVER_SCHED_NONE,
+        .header_timeout = 10000,
+        .body_timeout = 30000,
+        .idle_timeout = 60000
+    };
+    struct sigaction sa;
+    struct rlimit rl;
+    http_tune_t tune;
+    worker_t *workers = NULL;
+    int ncpu = cfg.nthread;
+    int opt = 0;
+    int i = 0;
+
+    while( ( opt = getopt( argc, argv, "a:p:t:b:m:e:s:T:" ) ) != -1 )
+    {
+        switch( opt ){
+            case 'a':
+                cfg.addr = optarg;
+            break;
+            case 'p':
+                cfg.port = (uint16_t)atoi( optarg );
+            break;
+            case 't':
+                cfg.nthread = atoi( optarg );
+            break;
+            case 'b':
+                cfg.bufsize = (size_t)atol( optarg );
+            break;
+            case 'm':
+                cfg.maxhead = (size_t)atol( optarg );
+            break;
+            case 'e':
+                if( strcmp( optarg, "uring" ) == 0 ){
+                    cfg.uring = 1;
+                    break;
+                }
+                else if( strcmp( optarg, "epoll" ) == 0 ){
+                    cfg.uring = 0;
+                    break;
+                }
+                // invalid engine
+                return usage( argv[0] );
+            case 's':
+                if( strcmp( optarg, "none" ) == 0 ){
+                    cfg.sched = SERVER_SCHED_NONE;
+                    break;
+                }
+                else if( strcmp( optarg, "static" ) == 0 ){
+                    cfg.sched = SERVER_SCHED_STATIC;
+                    break;
+                }
+                else if( strcmp( optarg, "steal" ) == 0 ){
+                    cfg.sched = SERVER_SCHED_STEAL;
+                    break;
+                }
+                // invalid scheduling
+                return usage( argv[0] );
+            case 'T':
+                if( timeouts( &cfg, optarg ) == 0 ){
+                    break;
+                }
+                // invalid deadlines
+                // fall through
+            default:
+                return usage( argv[0] );
+        }
+    }
+    if( cfg.nthread < 1 || ncpu < 1 || !cfg.bufsize ||
+        cfg.bufsize > cfg.maxhead ){
+        fprintf( stderr, "invalid arguments\n" );
+        return EXIT_FAILURE;
+    }
+
+    memset( &sa, 0, sizeof( sa ) );
+    sa.sa_handler = on_signal;
+    sigaction( SIGINT, &sa, NULL );
+    sigaction( SIGTERM, &sa, NULL );
+    signal( SIGPIPE, SIG_IGN );
+
+    // descriptors of the idle connections
+    if( getrlimit( RLIMIT_NOFILE, &rl ) == 0 && rl.rlim_cur < rl.rlim_max ){
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit( RLIMIT_NOFILE, &rl );
+    }
+
+    if( !( workers = calloc( (size_t)cfg.nthread, sizeof( worker_t ) ) ) ){
+        perror( "calloc" );
+        return EXIT_FAILURE;
+    }
+    else if( server_pool_init( &cfg ) ){
+        perror( "server_pool_init" );
+        return EXIT_FAILURE;
+    }
+    // the connections inherit the engine selected before the workers start
+    if( http_autotune( &tune ) == -1 ){
+        perror( "http_autotune" );
+        return EXIT_FAILURE;
+    }
+    printf( "parse engine: %s (%s)", http_engine_name( tune.engine ),
+            tune.source == HTTP_TUNE_ENV ? "HTTP_ENGINE" : "measured" );
+    for( i = 0; tune.source == HTTP_TUNE_BENCH && i < HTTP_NENGINE; i++ ){
+        printf( " %s=%lluns", http_engine_name( i ),
+                (unsigned long long)tune.ns[i] );
+    }
+    printf( "\n" );
+    printf( "listen %s:%d with %d threads\n", cfg.addr, cfg.port,
+            cfg.nthread );
+    fflush( stdout );
+
+    for( i = 0; i < cfg.nthread; i++ )
+    {
+        cpu_set_t cpus;
+
+        workers[i].cfg = &cfg;
+        workers[i].id = i;
+        if( pthread_create( &workers[i].tid, NULL, worker, &workers[i] ) ){
+            perror( "pthread_create" );
+            return EXIT_FAILURE;
+        }
+        // one event loop per core
+        CPU_ZERO( &cpus );
+        CPU_SET( i % ncpu, &cpus );
+        pthread_setaffinity_np( workers[i].tid, sizeof( cpus ), &cpus );
+    }
+    for( i = 0; i < cfg.nthread; i++ ){
+        pthread_join( workers[i].tid, NULL );
+    }
+    free( workers );
+    server_pool_free();
+
+    return EXIT_SUCCESS;
+}
+
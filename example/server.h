@@ -0,0 +1,165 @@
+/**
+ *  server.h
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "http.h"
+#include "http_rbuf.h"
+
+
+/**
+ * server configuration
+ */
+typedef struct {
+    const char *addr;
+    uint16_t port;
+    int nthread;
+    int backlog;
+    /* initial read buffer size and head budget of the connection */
+    size_t bufsize;
+    size_t maxhead;
+    uint16_t maxurilen;
+    uint16_t maxhdrlen;
+    uint8_t maxheader;
+    /* use server_loop_uring */
+    int uring;
+    /* SERVER_SCHED_* */
+    int sched;
+    /*
+     * deadlines of the epoll loop in milliseconds, 0 disables them.
+     * header: from the first byte of the request head (or from the accept)
+     * body: from the last progress of the request-body
+     * idle: from the last response of the keep-alive connection
+     */
+    uint32_t header_timeout;
+    uint32_t body_timeout;
+    uint32_t idle_timeout;
+} server_cfg_t;
+
+
+/**
+ * scheduling of the parsed requests
+ */
+enum {
+    /* handle the requests in the event loop */
+    SERVER_SCHED_NONE = 0,
+    /* run the requests as the tasks of the loop that parsed them */
+    SERVER_SCHED_STATIC,
+    /* and let the idle loops steal the tasks of the other loops */
+    SERVER_SCHED_STEAL
+};
+
+
+/**
+ * response of the request
+ */
+typedef struct {
+    /* static response bytes */
+    const char *data;
+    size_t len;
+    /* length of the request-body to discard */
+    size_t bodylen;
+    /* close the connection after the response */
+    int close;
+} server_res_t;
+
+
+/**
+ * task of the parsed request
+ */
+typedef struct {
+    /* connection of the owner loop */
+    void *conn;
+    int owner;
+    server_res_t res;
+    /* snapshot of the request (http_snapshot) */
+    http_t *req;
+} server_task_t;
+
+
+/**
+ * set to non-zero by SIGINT/SIGTERM
+ */
+extern volatile int server_stop;
+
+
+/**
+ * create the non-blocking listen socket with SO_REUSEPORT
+ */
+int server_listen( const server_cfg_t *cfg );
+
+
+/**
+ * create the response of the parsed request, or of the parse error
+ */
+void server_handle( server_res_t *res, http_t *h, const char *msg );
+void server_error( server_res_t *res, int rc );
+
+
+/**
+ * work-stealing pool of the event loops (server_pool.c)
+ *
+ * each loop pushes the tasks to its own deque and runs them in order
+ * between the I/O events. with SERVER_SCHED_STEAL, a loop that has no task
+ * takes the oldest task of a random loop, and hands the completed task back
+ * to the owner loop that writes the response.
+ */
+typedef struct server_loop_st server_loop_t;
+
+int server_pool_init( const server_cfg_t *cfg );
+void server_pool_free( void );
+
+/**
+ * attach the calling event loop to the pool and register the wakeup
+ * descriptors to epfd with the data.ptr of tag
+ */
+server_loop_t *server_pool_attach( int epfd, void *tag );
+
+/**
+ * allocate the task of the parsed request, deallocate it by free
+ */
+server_task_t *server_task_alloc( server_loop_t *l, void *conn, http_t *h,
+                                  const char *msg );
+
+/**
+ * push the task to the deque of the loop, return -1 if the deque is full
+ */
+int server_pool_push( server_loop_t *l, server_task_t *t );
+
+/**
+ * return 1 if the loop should poll without blocking
+ */
+int server_pool_busy( server_loop_t *l );
+
+/**
+ * run a task of the loop, or steal and run a task of another loop.
+ * return the completed task of the loop, or NULL if no task was run or the
+ * task was handed back to its owner.
+ */
+server_task_t *server_pool_run( server_loop_t *l );
+
+/**
+ * dequeue up to n completed tasks that were handed back to the loop
+ */
+size_t server_pool_done( server_loop_t *l, server_task_t **tasks, size_t n );
+
+
+/**
+ * run the event loop until server_stop is set
+ */
+int server_loop_epoll( const server_cfg_t *cfg, int sfd );
+
+/**
+ * run the event loop until server_stop is set.
+ * return -1 and set errno to ENOSYS if io_uring is not available, or to the
+ * error of io_uring_enter if the loop failed.
+ */
+int server_loop_uring( const server_cfg_t *cfg, int sfd );
+
+
+#endif
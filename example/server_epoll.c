@@ -0,0 +1,631 @@
+/**
+ *  server_epoll.c
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  edge-triggered epoll event loop. pipelined requests that are parsed from
+ *  a single read are answered by a single writev.
+ *
+ *  with the pool (server_pool.c), a parsed request becomes a task and the
+ *  connection stops parsing until the task is completed, so the responses
+ *  keep the request order even if another loop runs the task.
+ *
+ *  the deadlines of the connections are the timers of the hierarchical
+ *  timer wheel (wheel.h) of the loop with the tick of TICK_MSEC, so a loop
+ *  keeps the hundreds of thousands of timers without a descriptor per
+ *  connection. the deadline is chosen by the parse progress:
+ *
+ *    header: a part of the request head is buffered, or no request has been
+ *            received since the accept. it is not extended by the bytes of
+ *            the head, so a client that dribbles the head is closed.
+ *    body:   discarding the request-body. it is extended by the progress.
+ *    idle:   waiting for the next request of the keep-alive connection.
+ *
+ *  no deadline while the task of the request is running.
+ */
+
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "server.h"
+#include "wheel.h"
+
+#define NEVENT      256
+#define NIOV        64
+#define TICK_MSEC   100
+
+
+enum {
+    DEADLINE_NONE = 0,
+    DEADLINE_HEADER,
+    DEADLINE_BODY,
+    DEADLINE_IDLE
+};
+
+
+typedef struct {
+    wheel_timer_t timer;
+    wheel_t *wheel;
+    /* DEADLINE_* of the timer and the progress when it was set */
+    int deadline;
+    size_t progress;
+    /* number of the queued responses */
+    size_t nres;
+    int fd;
+    int closing;
+    /* waiting for the task of the request */
+    int pending;
+    /* peer closed while pending */
+    int eof;
+    /* closed while pending: free after the task is completed */
+    int dead;
+    server_loop_t *loop;
+    http_t *h;
+    http_rbuf_t *b;
+    /* remaining request-body bytes to discard */
+    size_t skip;
+    /* response bytes that could not be written */
+    char *out;
+    size_t outlen;
+    size_t outsize;
+    /* queued responses */
+    int niov;
+    struct iovec iov[NIOV];
+} conn_t;
+
+
+static conn_t *conn_alloc( const server_cfg_t *cfg, int fd )
+{
+    conn_t *c = (conn_t*)calloc( 1, sizeof( conn_t ) );
+
+    if( c )
+    {
+        c->fd = fd;
+        if( ( c->h = http_alloc( cfg->maxheader ) ) )
+        {
+            if( ( c->b = http_rbuf_alloc( cfg->bufsize, cfg->maxhead ) ) ){
+                return c;
+            }
+            http_free( c->h );
+        }
+        free( (void*)c );
+    }
+
+    return NULL;
+}
+
+
+// wakeup descriptors of the pool
+static char POOL_TAG;
+
+
+static void conn_free( conn_t *c )
+{
+    wheel_del( c->wheel, &c->timer );
+    close( c->fd );
+    http_rbuf_free( c->b );
+    http_free( c->h );
+    free( (void*)c->out );
+    free( (void*)c );
+}
+
+
+static int conn_save( conn_t *c, const char *data, size_t len )
+{
+    if( c->outlen + len > c->outsize )
+    {
+        size_t size = c->outsize ? c->outsize : 4096;
+        char *out = NULL;
+
+        while( size < c->outlen + len ){
+            size <<= 1;
+        }
+        if( !( out = (char*)realloc( c->out, size ) ) ){
+            return -1;
+        }
+        c->out = out;
+        c->outsize = size;
+    }
+    memcpy( c->out + c->outlen, data, len );
+    c->outlen += len;
+
+    return 0;
+}
+
+
+/**
+ * write the pending bytes
+ */
+static int conn_drain( conn_t *c )
+{
+    size_t cur = 0;
+    ssize_t n = 0;
+
+    while( cur < c->outlen )
+    {
+        n = write( c->fd, c->out + cur, c->outlen - cur );
+        if( n > 0 ){
+            cur += (size_t)n;
+        }
+        else if( n == -1 && errno == EINTR ){
+            continue;
+        }
+        else if( n == -1 && errno == EAGAIN ){
+            break;
+        }
+        else {
+            return -1;
+        }
+    }
+    c->outlen -= cur;
+    if( c->outlen ){
+        memmove( c->out, c->out + cur, c->outlen );
+    }
+
+    return 0;
+}
+
+
+/**
+ * write the queued responses by writev
+ */
+static int conn_flush( conn_t *c )
+{
+    struct iovec *iov = c->iov;
+    int niov = c->niov;
+    ssize_t n = 0;
+
+    if( !niov ){
+        return 0;
+    }
+    c->niov = 0;
+
+    do {
+        n = writev( c->fd, iov, niov );
+    } while( n == -1 && errno == EINTR );
+
+    if( n == -1 )
+    {
+        if( errno != EAGAIN ){
+            return -1;
+        }
+        n = 0;
+    }
+
+    // save the rest of responses
+    for(; niov; iov++, niov-- )
+    {
+        if( (size_t)n >= iov->iov_len ){
+            n -= (ssize_t)iov->iov_len;
+        }
+        else if( conn_save( c, (char*)iov->iov_base + n,
+                            iov->iov_len - (size_t)n ) ){
+            return -1;
+        }
+        else {
+            n = 0;
+        }
+    }
+
+    return 0;
+}
+
+
+static int conn_queue( conn_t *c, const server_res_t *res )
+{
+    c->nres++;
+    // keep the response order
+    if( c->outlen ){
+        return conn_save( c, res->data, res->len );
+    }
+
+    c->iov[c->niov].iov_base = (void*)(uintptr_t)res->data;
+    c->iov[c->niov].iov_len = res->len;
+    if( ++c->niov == NIOV ){
+        return conn_flush( c );
+    }
+
+    return 0;
+}
+
+
+static inline uint64_t tick_now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( (uint64_t)ts.tv_sec * 1000 +
+             (uint64_t)ts.tv_nsec / 1000000 ) / TICK_MSEC;
+}
+
+
+/**
+ * (re)set the deadline of the connection by the parse progress
+ */
+static void conn_schedule( const server_cfg_t *cfg, conn_t *c )
+{
+    uint32_t msec = 0;
+    size_t progress = c->nres;
+    int deadline = DEADLINE_NONE;
+
+    if( c->pending ){
+        wheel_del( c->wheel, &c->timer );
+        c->deadline = DEADLINE_NONE;
+        return;
+    }
+    else if( c->skip ){
+        deadline = DEADLINE_BODY;
+        msec = cfg->body_timeout;
+        progress = c->skip;
+    }
+    else if( http_rbuf_msglen( c->b ) || !c->nres ){
+        deadline = DEADLINE_HEADER;
+        msec = cfg->header_timeout;
+    }
+    else {
+        deadline = DEADLINE_IDLE;
+        msec = cfg->idle_timeout;
+    }
+
+    // keep the deadline until the next request or the body progress
+    if( deadline == c->deadline && progress == c->progress ){
+        return;
+    }
+    c->deadline = deadline;
+    c->progress = progress;
+    if( !msec ){
+        wheel_del( c->wheel, &c->timer );
+    }
+    else {
+        // round up to never expire early
+        wheel_add( c->wheel, &c->timer,
+                   tick_now() + 1 + ( msec + TICK_MSEC - 1 ) / TICK_MSEC );
+    }
+}
+
+
+static void conn_close( conn_t *c )
+{
+    if( c->pending ){
+        c->dead = 1;
+    }
+    else {
+        conn_free( c );
+    }
+}
+
+
+/**
+ * return 1 if the parsed request was pushed to the pool as a task
+ */
+static int conn_submit( conn_t *c )
+{
+    server_task_t *t = NULL;
+
+    if( !c->loop ||
+        !( t = server_task_alloc( c->loop, c, c->h, http_rbuf_msg( c->b ) ) ) ){
+        return 0;
+    }
+    // the deque is full: handle it in place
+    else if( server_pool_push( c->loop, t ) ){
+        free( (void*)t );
+        return 0;
+    }
+
+    // the task has a copy of the head
+    http_rbuf_consume( c->b, c->h->cur );
+    http_init( c->h );
+    c->pending = 1;
+
+    return 1;
+}
+
+
+/**
+ * parse all buffered requests
+ */
+static int conn_process( const server_cfg_t *cfg, conn_t *c )
+{
+    server_res_t res;
+    size_t len = 0;
+    int rc = 0;
+
+    while( !c->closing && !c->pending )
+    {
+        // discard the request-body
+        if( c->skip )
+        {
+            len = http_rbuf_msglen( c->b );
+            if( len > c->skip ){
+                len = c->skip;
+            }
+            http_rbuf_consume( c->b, len );
+            if( ( c->skip -= len ) ){
+                break;
+            }
+        }
+        if( !http_rbuf_msglen( c->b ) ){
+            break;
+        }
+
+        rc = http_rbuf_parse_request( c->b, c->h, cfg->maxurilen,
+                                      cfg->maxhdrlen );
+        if( rc == HTTP_EAGAIN ){
+            break;
+        }
+        else if( rc != HTTP_SUCCESS ){
+            server_error( &res, rc );
+        }
+        else if( conn_submit( c ) ){
+            break;
+        }
+        else {
+            server_handle( &res, c->h, http_rbuf_msg( c->b ) );
+            http_rbuf_consume( c->b, c->h->cur );
+            c->skip = res.bodylen;
+            http_init( c->h );
+        }
+
+        c->closing = res.close;
+        if( conn_queue( c, &res ) ){
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+static int conn_read( const server_cfg_t *cfg, conn_t *c )
+{
+    server_res_t res;
+    size_t space = 0;
+    char *tail = NULL;
+    ssize_t n = 0;
+
+    while( !c->closing )
+    {
+        if( !( tail = http_rbuf_reserve( c->b, &space ) ) )
+        {
+            if( errno != ENOBUFS ){
+                return -1;
+            }
+            // the task consumes the head
+            else if( c->pending ){
+                break;
+            }
+            // head budget exhausted
+            server_error( &res, HTTP_EAGAIN );
+            c->closing = 1;
+            if( conn_queue( c, &res ) ){
+                return -1;
+            }
+            break;
+        }
+
+        n = read( c->fd, tail, space );
+        if( n > 0 ){
+            http_rbuf_commit( c->b, (size_t)n );
+            if( conn_process( cfg, c ) ){
+                return -1;
+            }
+        }
+        // peer closed: answer the buffered requests, then close
+        else if( n == 0 )
+        {
+            if( c->pending ){
+                c->eof = 1;
+                break;
+            }
+            c->closing = 1;
+        }
+        else if( errno == EAGAIN ){
+            break;
+        }
+        else if( errno != EINTR ){
+            return -1;
+        }
+    }
+
+    return conn_flush( c );
+}
+
+
+/**
+ * write the response of the completed task, and resume the connection
+ */
+static int conn_complete( const server_cfg_t *cfg, conn_t *c,
+                          server_task_t *t )
+{
+    int rc = 0;
+
+    c->pending = 0;
+    c->skip = t->res.bodylen;
+    c->closing = t->res.close;
+    rc = c->dead || conn_queue( c, &t->res );
+    free( (void*)t );
+    if( rc || conn_process( cfg, c ) ){
+        return -1;
+    }
+    else if( !c->eof ){
+        // resume the read stopped by the task
+        return conn_read( cfg, c );
+    }
+    else if( !c->pending ){
+        c->closing = 1;
+    }
+
+    return conn_flush( c );
+}
+
+
+static void task_done( const server_cfg_t *cfg, server_task_t *t )
+{
+    conn_t *c = (conn_t*)t->conn;
+
+    if( conn_complete( cfg, c, t ) || ( c->closing && !c->outlen ) ){
+        conn_close( c );
+    }
+    else {
+        conn_schedule( cfg, c );
+    }
+}
+
+
+static void accept_all( const server_cfg_t *cfg, server_loop_t *l, wheel_t *w,
+                        int epfd, int sfd )
+{
+    struct epoll_event ev;
+    conn_t *c = NULL;
+    int enable = 1;
+    int fd = 0;
+
+    while( ( fd = accept4( sfd, NULL, NULL,
+                           SOCK_NONBLOCK|SOCK_CLOEXEC ) ) != -1 )
+    {
+        setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof( enable ) );
+        if( !( c = conn_alloc( cfg, fd ) ) ){
+            close( fd );
+            continue;
+        }
+        c->loop = l;
+        c->wheel = w;
+
+        ev.events = EPOLLIN|EPOLLOUT|EPOLLRDHUP|EPOLLET;
+        ev.data.ptr = c;
+        if( epoll_ctl( epfd, EPOLL_CTL_ADD, fd, &ev ) ){
+            conn_free( c );
+            continue;
+        }
+        conn_schedule( cfg, c );
+    }
+}
+
+
+int server_loop_epoll( const server_cfg_t *cfg, int sfd )
+{
+    struct epoll_event evs[NEVENT];
+    struct epoll_event ev;
+    server_task_t *tasks[NEVENT];
+    server_loop_t *l = NULL;
+    conn_t *c = NULL;
+    wheel_t *w = (wheel_t*)malloc( sizeof( wheel_t ) );
+    wheel_timer_t expired;
+    wheel_timer_t *t = NULL;
+    int epfd = epoll_create1( EPOLL_CLOEXEC );
+    size_t n = 0;
+    int done = 0;
+    int nev = 0;
+    int i = 0;
+
+    if( epfd == -1 || !w ){
+        perror( "epoll_create1" );
+        if( epfd != -1 ){
+            close( epfd );
+        }
+        free( (void*)w );
+        return -1;
+    }
+    wheel_init( w, tick_now() );
+
+    // listen socket is identified by NULL
+    ev.events = EPOLLIN|EPOLLET;
+    ev.data.ptr = NULL;
+    if( epoll_ctl( epfd, EPOLL_CTL_ADD, sfd, &ev ) ){
+        perror( "epoll_ctl" );
+        close( epfd );
+        free( (void*)w );
+        return -1;
+    }
+    else if( cfg->sched && !( l = server_pool_attach( epfd, &POOL_TAG ) ) ){
+        perror( "server_pool_attach" );
+        close( epfd );
+        free( (void*)w );
+        return -1;
+    }
+
+    while( !server_stop )
+    {
+        // poll while the pool has tasks, and wake up at each tick while
+        // the wheel has timers
+        nev = epoll_wait( epfd, evs, NEVENT,
+                          l && server_pool_busy( l ) ? 0 :
+                          w->ntimer ? TICK_MSEC : 1000 );
+        for( i = 0; i < nev; i++ )
+        {
+            if( !( c = (conn_t*)evs[i].data.ptr ) ){
+                accept_all( cfg, l, w, epfd, sfd );
+                continue;
+            }
+            // tasks completed by the other loops
+            else if( evs[i].data.ptr == &POOL_TAG ){
+                done = 1;
+                continue;
+            }
+            else if( c->dead ){
+                continue;
+            }
+            else if( evs[i].events & ( EPOLLERR|EPOLLHUP ) ){
+                conn_close( c );
+                continue;
+            }
+            else if( ( evs[i].events & EPOLLOUT ) && conn_drain( c ) ){
+                conn_close( c );
+                continue;
+            }
+            else if( ( evs[i].events & ( EPOLLIN|EPOLLRDHUP ) ) &&
+                     conn_read( cfg, c ) ){
+                conn_close( c );
+                continue;
+            }
+
+            // close after all responses are written
+            if( c->closing && !c->outlen ){
+                conn_close( c );
+            }
+            else {
+                conn_schedule( cfg, c );
+            }
+        }
+
+        // after the events, because it may close their connections
+        if( done )
+        {
+            while( ( n = server_pool_done( l, tasks, NEVENT ) ) ){
+                while( n ){
+                    task_done( cfg, tasks[--n] );
+                }
+            }
+            done = 0;
+        }
+
+        // run a task between the I/O events
+        if( l && ( tasks[0] = server_pool_run( l ) ) ){
+            task_done( cfg, tasks[0] );
+        }
+
+        // close the connections that missed the deadlines
+        if( wheel_expire( w, tick_now(), &expired ) )
+        {
+            while( ( t = expired.next ) != &expired ){
+                wheel_list_del( t );
+                c = (conn_t*)( (char*)t - offsetof( conn_t, timer ) );
+                c->deadline = DEADLINE_NONE;
+                conn_close( c );
+            }
+        }
+    }
+    close( epfd );
+    free( (void*)w );
+
+    return 0;
+}
+
@@ -0,0 +1,302 @@
+/**
+ *  server_pool.c
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  work-stealing pool of the event loops.
+ *
+ *  the deque of each loop is a Chase-Lev deque without the pop from the
+ *  bottom: the owner pushes the tasks to the bottom, and the owner and the
+ *  thieves take the oldest task from the top by a CAS, so the tasks of a
+ *  loop run in the arrival order. a thief starts at a random victim, and
+ *  returns the completed task through the done ring (ring.h) of the owner
+ *  and wakes it by its eventfd.
+ *
+ *  a push to a deque that already has a task wakes the idle loops by the
+ *  shared level-triggered eventfd, and the loops poll without blocking
+ *  while any deque has a task.
+ */
+
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "server.h"
+#include "ring.h"
+
+#define DEQUE_SIZE  4096
+#define DEQUE_MASK  (DEQUE_SIZE - 1)
+
+struct server_loop_st {
+    /* next task to take */
+    int64_t top __attribute__((aligned(RING_CACHELINE)));
+    /* next slot to push */
+    int64_t bottom __attribute__((aligned(RING_CACHELINE)));
+    server_task_t *tasks[DEQUE_SIZE] __attribute__((aligned(RING_CACHELINE)));
+    /* completed tasks handed back by the other loops */
+    ring_t *done;
+    int donefd;
+    int id;
+    unsigned seed;
+};
+
+
+static struct {
+    server_loop_t *loops;
+    int nloop;
+    int nattach;
+    int sched;
+    /* wakes the idle loops */
+    int stealfd;
+    /* number of the tasks in the deques */
+    int64_t queued;
+} Pool = {
+    .loops = NULL,
+    .stealfd = -1
+};
+
+
+static inline void wakeup( int fd )
+{
+    uint64_t one = 1;
+    // EAGAIN: the counter is already set
+    ssize_t n = write( fd, &one, sizeof( one ) );
+
+    (void)n;
+}
+
+
+static inline void reset( int fd )
+{
+    uint64_t v = 0;
+    // EAGAIN: another loop reset the counter
+    ssize_t n = read( fd, &v, sizeof( v ) );
+
+    (void)n;
+}
+
+
+int server_pool_init( const server_cfg_t *cfg )
+{
+    int i = 0;
+
+    if( cfg->sched == SERVER_SCHED_NONE ){
+        return 0;
+    }
+    else if( posix_memalign( (void**)&Pool.loops, RING_CACHELINE,
+                             sizeof( server_loop_t ) *
+                             (size_t)cfg->nthread ) ){
+        errno = ENOMEM;
+        return -1;
+    }
+    memset( (void*)Pool.loops, 0,
+            sizeof( server_loop_t ) * (size_t)cfg->nthread );
+    Pool.nloop = cfg->nthread;
+    Pool.sched = cfg->sched;
+    if( ( Pool.stealfd = eventfd( 0, EFD_NONBLOCK|EFD_CLOEXEC ) ) == -1 ){
+        return -1;
+    }
+
+    for(; i < Pool.nloop; i++ )
+    {
+        server_loop_t *l = &Pool.loops[i];
+
+        l->id = i;
+        l->seed = (unsigned)i + 1;
+        // the tasks of the owner that are in the deque or being run
+        if( !( l->done = ring_alloc( DEQUE_SIZE * 2 ) ) ||
+            ( l->donefd = eventfd( 0, EFD_NONBLOCK|EFD_CLOEXEC ) ) == -1 ){
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+void server_pool_free( void )
+{
+    int i = 0;
+
+    if( !Pool.loops ){
+        return;
+    }
+    for(; i < Pool.nloop; i++ )
+    {
+        if( Pool.loops[i].done ){
+            ring_free( Pool.loops[i].done );
+            close( Pool.loops[i].donefd );
+        }
+    }
+    close( Pool.stealfd );
+    free( (void*)Pool.loops );
+    Pool.loops = NULL;
+}
+
+
+server_loop_t *server_pool_attach( int epfd, void *tag )
+{
+    struct epoll_event ev;
+    server_loop_t *l = NULL;
+    int id = __atomic_fetch_add( &Pool.nattach, 1, __ATOMIC_RELAXED );
+
+    if( !Pool.loops || id >= Pool.nloop ){
+        errno = EINVAL;
+        return NULL;
+    }
+    l = &Pool.loops[id];
+
+    ev.events = EPOLLIN|EPOLLET;
+    ev.data.ptr = tag;
+    if( epoll_ctl( epfd, EPOLL_CTL_ADD, l->donefd, &ev ) ){
+        return NULL;
+    }
+    else if( Pool.sched == SERVER_SCHED_STEAL )
+    {
+        ev.events = EPOLLIN;
+        if( epoll_ctl( epfd, EPOLL_CTL_ADD, Pool.stealfd, &ev ) ){
+            return NULL;
+        }
+    }
+
+    return l;
+}
+
+
+server_task_t *server_task_alloc( server_loop_t *l, void *conn, http_t *h,
+                                  const char *msg )
+{
+    size_t size = sizeof( server_task_t ) + http_snapshot_size( h );
+    server_task_t *t = (server_task_t*)malloc( size );
+
+    if( t )
+    {
+        t->conn = conn;
+        t->owner = l->id;
+        t->req = (http_t*)( t + 1 );
+        if( http_snapshot( h, msg, (void*)t->req, size - sizeof( *t ) ) ){
+            free( (void*)t );
+            return NULL;
+        }
+    }
+
+    return t;
+}
+
+
+int server_pool_push( server_loop_t *l, server_task_t *t )
+{
+    int64_t b = __atomic_load_n( &l->bottom, __ATOMIC_RELAXED );
+    int64_t top = __atomic_load_n( &l->top, __ATOMIC_ACQUIRE );
+
+    if( b - top >= DEQUE_SIZE ){
+        return -1;
+    }
+
+    __atomic_store_n( &l->tasks[b & DEQUE_MASK], t, __ATOMIC_RELAXED );
+    // publish the task before the bottom
+    __atomic_store_n( &l->bottom, b + 1, __ATOMIC_RELEASE );
+    __atomic_add_fetch( &Pool.queued, 1, __ATOMIC_RELAXED );
+
+    // the loop is behind
+    if( Pool.sched == SERVER_SCHED_STEAL && b > top ){
+        wakeup( Pool.stealfd );
+    }
+
+    return 0;
+}
+
+
+/**
+ * take the oldest task of the deque, or return NULL if it is empty or
+ * another loop took the task
+ */
+static server_task_t *deque_take( server_loop_t *l )
+{
+    int64_t top = __atomic_load_n( &l->top, __ATOMIC_ACQUIRE );
+    int64_t b = __atomic_load_n( &l->bottom, __ATOMIC_ACQUIRE );
+    server_task_t *t = NULL;
+
+    if( top >= b ){
+        return NULL;
+    }
+    t = __atomic_load_n( &l->tasks[top & DEQUE_MASK], __ATOMIC_RELAXED );
+    if( !__atomic_compare_exchange_n( &l->top, &top, top + 1, 0,
+                                      __ATOMIC_SEQ_CST, __ATOMIC_RELAXED ) ){
+        return NULL;
+    }
+    __atomic_sub_fetch( &Pool.queued, 1, __ATOMIC_RELAXED );
+
+    return t;
+}
+
+
+static inline int deque_empty( server_loop_t *l )
+{
+    return __atomic_load_n( &l->top, __ATOMIC_ACQUIRE ) >=
+           __atomic_load_n( &l->bottom, __ATOMIC_ACQUIRE );
+}
+
+
+int server_pool_busy( server_loop_t *l )
+{
+    if( Pool.sched == SERVER_SCHED_STEAL ){
+        return __atomic_load_n( &Pool.queued, __ATOMIC_RELAXED ) > 0;
+    }
+
+    return !deque_empty( l );
+}
+
+
+server_task_t *server_pool_run( server_loop_t *l )
+{
+    server_loop_t *owner = NULL;
+    server_task_t *t = NULL;
+    int victim = 0;
+    int i = 0;
+
+    // own tasks first
+    while( !( t = deque_take( l ) ) && !deque_empty( l ) ){}
+
+    if( !t && Pool.sched == SERVER_SCHED_STEAL )
+    {
+        victim = rand_r( &l->seed ) % Pool.nloop;
+        for(; i < Pool.nloop && !t; i++, victim = ( victim + 1 ) % Pool.nloop )
+        {
+            if( victim != l->id ){
+                t = deque_take( &Pool.loops[victim] );
+            }
+        }
+    }
+    if( !t ){
+        return NULL;
+    }
+
+    server_handle( &t->res, t->req, http_snapshot_buf( t->req ) );
+    if( t->owner == l->id ){
+        return t;
+    }
+
+    // hand back to the owner that writes the response
+    owner = &Pool.loops[t->owner];
+    while( !ring_enqueue( owner->done, (void**)&t, 1 ) ){
+        sched_yield();
+    }
+    wakeup( owner->donefd );
+
+    return NULL;
+}
+
+
+size_t server_pool_done( server_loop_t *l, server_task_t **tasks, size_t n )
+{
+    reset( l->donefd );
+    if( Pool.sched == SERVER_SCHED_STEAL ){
+        reset( Pool.stealfd );
+    }
+
+    return ring_dequeue( l->done, (void**)tasks, n );
+}
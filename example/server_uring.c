@@ -0,0 +1,763 @@
+/**
+ *  server_uring.c
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  io_uring event loop.
+ *
+ *  - connections are accepted by a multishot accept.
+ *  - each connection has a multishot recv that picks the buffers from a
+ *    provided buffer ring, and requests are parsed directly from the
+ *    completed buffer. only the bytes of an incomplete request are copied
+ *    into the read buffer of the connection.
+ *  - responses are written by IORING_OP_WRITE_FIXED from the per-connection
+ *    area of a registered buffer.
+ *
+ *  the loop talks to the kernel interface directly, so it does not depend on
+ *  liburing. server_loop_uring returns -1 with ENOSYS before accepting any
+ *  connection if the kernel lacks one of the features above, so that the
+ *  caller can fall back to server_loop_epoll.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "server.h"
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#endif
+
+#if defined(IORING_RECV_MULTISHOT) && defined(IORING_ACCEPT_MULTISHOT) && \
+    defined(IORING_FEAT_EXT_ARG)
+#define USE_IO_URING    1
+#endif
+
+
+#ifndef USE_IO_URING
+
+int server_loop_uring( const server_cfg_t *cfg, int sfd )
+{
+    (void)cfg;
+    (void)sfd;
+    errno = ENOSYS;
+    return -1;
+}
+
+#else
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/time_types.h>
+
+/* number of submission queue entries */
+#define NENTRY      1024
+/* provided buffers: must be power of 2 */
+#define NBUF        1024
+#define BUFSIZE     4096
+#define BUFGROUP    0
+/* connections per loop and size of their registered response area */
+#define MAXCONN     4096
+#define OUTSIZE     1024
+/* largest static response of server_handle/server_error */
+#define MAXRES      128
+
+enum {
+    OP_ACCEPT = 1,
+    OP_RECV,
+    OP_WRITE
+};
+
+#define UDATA(op,idx)   (((uint64_t)(idx) << 8) | (op))
+#define UDATA_OP(u)     ((int)((u) & 0xFF))
+#define UDATA_IDX(u)    ((uint32_t)((u) >> 8))
+
+
+typedef struct {
+    int fd;
+    unsigned entries;
+    unsigned tail;
+    unsigned submitted;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr;
+    size_t sq_size;
+    void *cq_ptr;
+    size_t cq_size;
+    size_t sqes_size;
+} ring_t;
+
+
+typedef struct {
+    int fd;
+    int closing;
+    /* number of operations in-flight */
+    int nref;
+    /* recv is armed */
+    int recving;
+    http_t *h;
+    http_rbuf_t *b;
+    size_t skip;
+    /* response area in the registered buffer */
+    char *out;
+    size_t outlen;
+    /* length of the in-flight write */
+    size_t inflight;
+} uconn_t;
+
+
+typedef struct {
+    const server_cfg_t *cfg;
+    int sfd;
+    int naccept;
+    ring_t ring;
+    /* provided buffer ring */
+    struct io_uring_buf_ring *br;
+    size_t brsize;
+    uint16_t brtail;
+    char *bufs;
+    /* registered response area */
+    char *outs;
+    /* connections */
+    uconn_t *conns;
+    uint32_t *freelist;
+    uint32_t nfree;
+} loop_t;
+
+
+static int ring_init( ring_t *r, unsigned entries )
+{
+    struct io_uring_params p;
+
+    memset( r, 0, sizeof( ring_t ) );
+    memset( &p, 0, sizeof( p ) );
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = entries * 4;
+
+    r->fd = (int)syscall( __NR_io_uring_setup, entries, &p );
+    if( r->fd == -1 ){
+        return -1;
+    }
+    else if( !( p.features & IORING_FEAT_SINGLE_MMAP ) ||
+             !( p.features & IORING_FEAT_EXT_ARG ) ){
+        close( r->fd );
+        errno = ENOSYS;
+        return -1;
+    }
+
+    r->sq_size = p.sq_off.array + p.sq_entries * sizeof( unsigned );
+    r->cq_size = p.cq_off.cqes + p.cq_entries * sizeof( struct io_uring_cqe );
+    if( r->cq_size > r->sq_size ){
+        r->sq_size = r->cq_size;
+    }
+    r->sq_ptr = mmap( NULL, r->sq_size, PROT_READ|PROT_WRITE,
+                      MAP_SHARED|MAP_POPULATE, r->fd, IORING_OFF_SQ_RING );
+    if( r->sq_ptr == MAP_FAILED ){
+        close( r->fd );
+        return -1;
+    }
+    // single mmap for both rings
+    r->cq_ptr = r->sq_ptr;
+    r->cq_size = r->sq_size;
+
+    r->sqes_size = p.sq_entries * sizeof( struct io_uring_sqe );
+    r->sqes = mmap( NULL, r->sqes_size, PROT_READ|PROT_WRITE,
+                    MAP_SHARED|MAP_POPULATE, r->fd, IORING_OFF_SQES );
+    if( r->sqes == MAP_FAILED ){
+        munmap( r->sq_ptr, r->sq_size );
+        close( r->fd );
+        return -1;
+    }
+
+    r->entries = p.sq_entries;
+    r->sq_head = (unsigned*)((char*)r->sq_ptr + p.sq_off.head);
+    r->sq_tail = (unsigned*)((char*)r->sq_ptr + p.sq_off.tail);
+    r->sq_mask = (unsigned*)((char*)r->sq_ptr + p.sq_off.ring_mask);
+    r->sq_array = (unsigned*)((char*)r->sq_ptr + p.sq_off.array);
+    r->cq_head = (unsigned*)((char*)r->cq_ptr + p.cq_off.head);
+    r->cq_tail = (unsigned*)((char*)r->cq_ptr + p.cq_off.tail);
+    r->cq_mask = (unsigned*)((char*)r->cq_ptr + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe*)((char*)r->cq_ptr + p.cq_off.cqes);
+    r->tail = r->submitted = *r->sq_tail;
+
+    return 0;
+}
+
+
+static void ring_exit( ring_t *r )
+{
+    munmap( r->sqes, r->sqes_size );
+    munmap( r->sq_ptr, r->sq_size );
+    close( r->fd );
+}
+
+
+/**
+ * submit the queued entries and wait for a completion at most 1 second
+ */
+static int ring_enter( ring_t *r, unsigned nwait )
+{
+    struct __kernel_timespec ts = {
+        .tv_sec = 1,
+        .tv_nsec = 0
+    };
+    struct io_uring_getevents_arg arg = {
+        .sigmask = 0,
+        .sigmask_sz = _NSIG / 8,
+        .pad = 0,
+        .ts = (uint64_t)(uintptr_t)&ts
+    };
+    unsigned nsubmit = r->tail - r->submitted;
+    int rc = 0;
+
+    __atomic_store_n( r->sq_tail, r->tail, __ATOMIC_RELEASE );
+    rc = (int)syscall( __NR_io_uring_enter, r->fd, nsubmit, nwait,
+                       nwait ? IORING_ENTER_GETEVENTS|IORING_ENTER_EXT_ARG : 0,
+                       nwait ? &arg : NULL, sizeof( arg ) );
+    if( rc >= 0 ){
+        r->submitted += (unsigned)rc;
+        return 0;
+    }
+    else if( errno == ETIME || errno == EINTR || errno == EBUSY ){
+        return 0;
+    }
+
+    return -1;
+}
+
+
+static struct io_uring_sqe *ring_sqe( ring_t *r )
+{
+    struct io_uring_sqe *sqe = NULL;
+    unsigned idx = 0;
+
+    // submission queue is full
+    while( r->tail - __atomic_load_n( r->sq_head, __ATOMIC_ACQUIRE ) >=
+           r->entries )
+    {
+        if( ring_enter( r, 0 ) ){
+            return NULL;
+        }
+    }
+
+    idx = r->tail & *r->sq_mask;
+    r->sq_array[idx] = idx;
+    r->tail++;
+    sqe = &r->sqes[idx];
+    memset( sqe, 0, sizeof( struct io_uring_sqe ) );
+
+    return sqe;
+}
+
+
+static int submit_accept( loop_t *l )
+{
+    struct io_uring_sqe *sqe = ring_sqe( &l->ring );
+
+    if( !sqe ){
+        return -1;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = l->sfd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = UDATA( OP_ACCEPT, 0 );
+
+    return 0;
+}
+
+
+static int submit_recv( loop_t *l, uint32_t idx )
+{
+    struct io_uring_sqe *sqe = ring_sqe( &l->ring );
+    uconn_t *c = &l->conns[idx];
+
+    if( !sqe ){
+        return -1;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = c->fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFGROUP;
+    sqe->user_data = UDATA( OP_RECV, idx );
+    c->recving = 1;
+    c->nref++;
+
+    return 0;
+}
+
+
+static int submit_write( loop_t *l, uint32_t idx )
+{
+    uconn_t *c = &l->conns[idx];
+    struct io_uring_sqe *sqe = NULL;
+
+    if( c->inflight || !c->outlen ){
+        return 0;
+    }
+    else if( !( sqe = ring_sqe( &l->ring ) ) ){
+        return -1;
+    }
+    sqe->opcode = IORING_OP_WRITE_FIXED;
+    sqe->fd = c->fd;
+    sqe->addr = (uint64_t)(uintptr_t)c->out;
+    sqe->len = (uint32_t)c->outlen;
+    sqe->buf_index = 0;
+    sqe->user_data = UDATA( OP_WRITE, idx );
+    c->inflight = c->outlen;
+    c->nref++;
+
+    return 0;
+}
+
+
+/**
+ * give the buffer back to the provided buffer ring
+ */
+static void recycle_buf( loop_t *l, uint16_t bid )
+{
+    struct io_uring_buf *buf = &l->br->bufs[l->brtail & ( NBUF - 1 )];
+
+    buf->addr = (uint64_t)(uintptr_t)( l->bufs + (size_t)bid * ( BUFSIZE + 1 ) );
+    buf->len = BUFSIZE;
+    buf->bid = bid;
+    l->brtail++;
+    __atomic_store_n( &l->br->tail, l->brtail, __ATOMIC_RELEASE );
+}
+
+
+static int loop_init( loop_t *l, const server_cfg_t *cfg, int sfd )
+{
+    struct io_uring_buf_reg reg;
+    struct iovec iov;
+    uint32_t i = 0;
+
+    memset( l, 0, sizeof( loop_t ) );
+    l->cfg = cfg;
+    l->sfd = sfd;
+    if( ring_init( &l->ring, NENTRY ) ){
+        return -1;
+    }
+
+    // provided buffer ring and its buffers with null-terminator
+    l->brsize = NBUF * sizeof( struct io_uring_buf );
+    l->br = mmap( NULL, l->brsize, PROT_READ|PROT_WRITE,
+                  MAP_PRIVATE|MAP_ANONYMOUS, -1, 0 );
+    if( l->br == MAP_FAILED ){
+        l->br = NULL;
+        goto FAILED;
+    }
+    else if( !( l->bufs = malloc( (size_t)NBUF * ( BUFSIZE + 1 ) ) ) ){
+        goto FAILED;
+    }
+    memset( &reg, 0, sizeof( reg ) );
+    reg.ring_addr = (uint64_t)(uintptr_t)l->br;
+    reg.ring_entries = NBUF;
+    reg.bgid = BUFGROUP;
+    if( syscall( __NR_io_uring_register, l->ring.fd,
+                 IORING_REGISTER_PBUF_RING, &reg, 1 ) ){
+        goto FAILED;
+    }
+    for( i = 0; i < NBUF; i++ ){
+        recycle_buf( l, (uint16_t)i );
+    }
+
+    // registered response area
+    if( !( l->outs = malloc( (size_t)MAXCONN * OUTSIZE ) ) ){
+        goto FAILED;
+    }
+    iov.iov_base = l->outs;
+    iov.iov_len = (size_t)MAXCONN * OUTSIZE;
+    if( syscall( __NR_io_uring_register, l->ring.fd,
+                 IORING_REGISTER_BUFFERS, &iov, 1 ) ){
+        goto FAILED;
+    }
+
+    // connection slots
+    if( !( l->conns = calloc( MAXCONN, sizeof( uconn_t ) ) ) ||
+        !( l->freelist = malloc( MAXCONN * sizeof( uint32_t ) ) ) ){
+        goto FAILED;
+    }
+    for( i = 0; i < MAXCONN; i++ ){
+        l->conns[i].fd = -1;
+        l->conns[i].out = l->outs + (size_t)i * OUTSIZE;
+        l->freelist[i] = MAXCONN - 1 - i;
+    }
+    l->nfree = MAXCONN;
+
+    return 0;
+
+FAILED:
+    free( (void*)l->freelist );
+    free( (void*)l->conns );
+    free( (void*)l->outs );
+    free( (void*)l->bufs );
+    if( l->br ){
+        munmap( l->br, l->brsize );
+    }
+    ring_exit( &l->ring );
+    // kernel lacks the features
+    if( errno == EINVAL || errno == EOPNOTSUPP ){
+        errno = ENOSYS;
+    }
+
+    return -1;
+}
+
+
+static void loop_exit( loop_t *l )
+{
+    uint32_t i = 0;
+
+    for(; i < MAXCONN; i++ )
+    {
+        if( l->conns[i].fd != -1 ){
+            close( l->conns[i].fd );
+            http_rbuf_free( l->conns[i].b );
+            http_free( l->conns[i].h );
+        }
+    }
+    ring_exit( &l->ring );
+    munmap( l->br, l->brsize );
+    free( (void*)l->freelist );
+    free( (void*)l->conns );
+    free( (void*)l->outs );
+    free( (void*)l->bufs );
+}
+
+
+static void conn_open( loop_t *l, int fd )
+{
+    int enable = 1;
+    uint32_t idx = 0;
+    uconn_t *c = NULL;
+
+    if( !l->nfree ){
+        close( fd );
+        return;
+    }
+    idx = l->freelist[--l->nfree];
+    c = &l->conns[idx];
+    if( !( c->h = http_alloc( l->cfg->maxheader ) ) ){
+        goto FAILED;
+    }
+    else if( !( c->b = http_rbuf_alloc( l->cfg->bufsize, l->cfg->maxhead ) ) ){
+        http_free( c->h );
+        goto FAILED;
+    }
+    setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof( enable ) );
+    c->fd = fd;
+    c->closing = 0;
+    c->nref = 0;
+    c->skip = 0;
+    c->outlen = 0;
+    c->inflight = 0;
+    if( submit_recv( l, idx ) == 0 ){
+        return;
+    }
+    http_rbuf_free( c->b );
+    http_free( c->h );
+
+FAILED:
+    close( fd );
+    c->fd = -1;
+    l->freelist[l->nfree++] = idx;
+}
+
+
+/**
+ * close the connection after all operations are completed
+ */
+static void conn_close( loop_t *l, uint32_t idx )
+{
+    uconn_t *c = &l->conns[idx];
+
+    c->closing = 1;
+    if( c->nref ){
+        // terminate the multishot recv
+        if( c->recving ){
+            shutdown( c->fd, SHUT_RDWR );
+        }
+        return;
+    }
+    close( c->fd );
+    http_rbuf_free( c->b );
+    http_free( c->h );
+    c->fd = -1;
+    l->freelist[l->nfree++] = idx;
+}
+
+
+/**
+ * parse the requests in msg and return the consumed length
+ */
+static size_t conn_process( loop_t *l, uconn_t *c, char *msg, size_t len )
+{
+    const server_cfg_t *cfg = l->cfg;
+    server_res_t res;
+    size_t cur = 0;
+    size_t n = 0;
+    int rc = 0;
+
+    while( cur < len && !c->closing )
+    {
+        // discard the request-body
+        if( c->skip ){
+            n = len - cur;
+            if( n > c->skip ){
+                n = c->skip;
+            }
+            cur += n;
+            c->skip -= n;
+            continue;
+        }
+        // no space to respond: continue after the write completion
+        else if( OUTSIZE - c->outlen < MAXRES ){
+            break;
+        }
+
+        rc = http_parse_request( c->h, msg + cur, len - cur, cfg->maxurilen,
+                                 cfg->maxhdrlen );
+        if( rc == HTTP_EAGAIN ){
+            break;
+        }
+        else if( rc != HTTP_SUCCESS ){
+            server_error( &res, rc );
+        }
+        else {
+            server_handle( &res, c->h, msg + cur );
+            cur += c->h->cur;
+            c->skip = res.bodylen;
+            http_init( c->h );
+        }
+        c->closing = res.close;
+        memcpy( c->out + c->outlen, res.data, res.len );
+        c->outlen += res.len;
+    }
+
+    return cur;
+}
+
+
+/**
+ * append the bytes to the read buffer of the connection
+ */
+static int conn_save( uconn_t *c, const char *data, size_t len )
+{
+    size_t space = 0;
+    char *tail = NULL;
+
+    while( len )
+    {
+        if( !( tail = http_rbuf_reserve( c->b, &space ) ) ){
+            return -1;
+        }
+        else if( space > len ){
+            space = len;
+        }
+        memcpy( tail, data, space );
+        http_rbuf_commit( c->b, space );
+        data += space;
+        len -= space;
+    }
+
+    return 0;
+}
+
+
+static void on_recv( loop_t *l, uint32_t idx, int res, uint32_t flags )
+{
+    uconn_t *c = &l->conns[idx];
+    server_res_t err;
+
+    if( !( flags & IORING_CQE_F_MORE ) ){
+        c->recving = 0;
+        c->nref--;
+    }
+
+    if( res > 0 && ( flags & IORING_CQE_F_BUFFER ) )
+    {
+        uint16_t bid = (uint16_t)( flags >> IORING_CQE_BUFFER_SHIFT );
+        char *data = l->bufs + (size_t)bid * ( BUFSIZE + 1 );
+        size_t len = (size_t)res;
+        size_t cur = 0;
+
+        if( !c->closing )
+        {
+            int buffered = http_rbuf_msglen( c->b ) != 0;
+
+            // parse directly from the completed buffer
+            if( !buffered ){
+                data[len] = 0;
+                cur = conn_process( l, c, data, len );
+            }
+            // keep the rest of bytes
+            if( cur < len && !c->closing )
+            {
+                if( conn_save( c, data + cur, len - cur ) ){
+                    server_error( &err, HTTP_EAGAIN );
+                    c->closing = 1;
+                    if( OUTSIZE - c->outlen >= err.len ){
+                        memcpy( c->out + c->outlen, err.data, err.len );
+                        c->outlen += err.len;
+                    }
+                }
+                // continue the buffered request
+                else if( buffered ){
+                    http_rbuf_consume( c->b, conn_process( l, c,
+                                               http_rbuf_msg( c->b ),
+                                               http_rbuf_msglen( c->b ) ) );
+                }
+            }
+        }
+        recycle_buf( l, bid );
+    }
+    // peer closed or error
+    else if( res != -ENOBUFS ){
+        c->closing = 1;
+        if( res < 0 ){
+            c->outlen = 0;
+        }
+    }
+
+    if( c->closing ){
+        if( submit_write( l, idx ) || !c->outlen ){
+            conn_close( l, idx );
+        }
+    }
+    // re-arm the terminated multishot recv
+    else if( !c->recving && submit_recv( l, idx ) ){
+        conn_close( l, idx );
+    }
+    else if( submit_write( l, idx ) ){
+        conn_close( l, idx );
+    }
+}
+
+
+static void on_write( loop_t *l, uint32_t idx, int res )
+{
+    uconn_t *c = &l->conns[idx];
+
+    c->nref--;
+    if( res < 0 ){
+        c->outlen = c->inflight = 0;
+        conn_close( l, idx );
+        return;
+    }
+
+    // remove the written bytes
+    c->outlen -= (size_t)res;
+    if( c->outlen ){
+        memmove( c->out, c->out + res, c->outlen );
+    }
+    c->inflight = 0;
+
+    // continue the requests that were stalled by the response area
+    if( !c->closing && http_rbuf_msglen( c->b ) ){
+        http_rbuf_consume( c->b, conn_process( l, c, http_rbuf_msg( c->b ),
+                                               http_rbuf_msglen( c->b ) ) );
+    }
+
+    if( submit_write( l, idx ) ){
+        c->outlen = 0;
+        conn_close( l, idx );
+    }
+    else if( c->closing && !c->outlen ){
+        conn_close( l, idx );
+    }
+}
+
+
+int server_loop_uring( const server_cfg_t *cfg, int sfd )
+{
+    loop_t l;
+    ring_t *r = &l.ring;
+    struct io_uring_cqe *cqe = NULL;
+    unsigned head = 0;
+    uint32_t idx = 0;
+    int rc = 0;
+    int err = 0;
+
+    if( loop_init( &l, cfg, sfd ) ){
+        return -1;
+    }
+    else if( submit_accept( &l ) ){
+        loop_exit( &l );
+        return -1;
+    }
+
+    while( !server_stop )
+    {
+        if( ring_enter( r, 1 ) ){
+            err = errno;
+            rc = -1;
+            break;
+        }
+
+        head = *r->cq_head;
+        while( head != __atomic_load_n( r->cq_tail, __ATOMIC_ACQUIRE ) )
+        {
+            cqe = &r->cqes[head & *r->cq_mask];
+            idx = UDATA_IDX( cqe->user_data );
+
+            switch( UDATA_OP( cqe->user_data ) ){
+                case OP_ACCEPT:
+                    if( cqe->res >= 0 ){
+                        l.naccept++;
+                        conn_open( &l, cqe->res );
+                    }
+                    // multishot accept is not supported
+                    else if( cqe->res == -EINVAL && !l.naccept ){
+                        __atomic_store_n( r->cq_head, head + 1,
+                                          __ATOMIC_RELEASE );
+                        loop_exit( &l );
+                        errno = ENOSYS;
+                        return -1;
+                    }
+                    if( !( cqe->flags & IORING_CQE_F_MORE ) &&
+                        submit_accept( &l ) ){
+                        perror( "submit_accept" );
+                        server_stop = 1;
+                    }
+                break;
+
+                case OP_RECV:
+                    on_recv( &l, idx, cqe->res, cqe->flags );
+                break;
+
+                case OP_WRITE:
+                    on_write( &l, idx, cqe->res );
+                break;
+            }
+            head++;
+        }
+        __atomic_store_n( r->cq_head, head, __ATOMIC_RELEASE );
+    }
+    loop_exit( &l );
+    errno = err;
+
+    return rc;
+}
+
+#endif
+
@@ -0,0 +1,194 @@
+/**
+ *  wheel.h
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  hierarchical timer wheel of the connection deadlines.
+ *
+ *  the wheel has WHEEL_NLEVEL levels of WHEEL_NSLOT slots, and the slots of
+ *  the level L span WHEEL_NSLOT^L ticks. a timer is linked into the slot of
+ *  its expire tick in the level chosen by the distance to the current tick,
+ *  so add and delete are O(1). when the current tick reaches the start of
+ *  the span of a slot, the timers of the slot are moved down to the lower
+ *  levels, and each timer is moved at most WHEEL_NLEVEL - 1 times before it
+ *  expires.
+ *
+ *  timers are embedded in the owner and linked into circular lists whose
+ *  heads are the slots.
+ */
+
+#ifndef WHEEL_H
+#define WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define WHEEL_BITS      6
+#define WHEEL_NSLOT     (1 << WHEEL_BITS)
+#define WHEEL_MASK      (WHEEL_NSLOT - 1)
+#define WHEEL_NLEVEL    4
+/* the farthest expire tick from the current tick */
+#define WHEEL_MAXTICK   ((UINT64_C(1) << (WHEEL_BITS * WHEEL_NLEVEL)) - 1)
+
+typedef struct wheel_timer_st {
+    struct wheel_timer_st *next;
+    struct wheel_timer_st *prev;
+    uint64_t expire;
+} wheel_timer_t;
+
+typedef struct {
+    /* next tick to expire */
+    uint64_t now;
+    /* number of the linked timers */
+    size_t ntimer;
+    wheel_timer_t slots[WHEEL_NLEVEL][WHEEL_NSLOT];
+} wheel_t;
+
+
+static inline void wheel_list_init( wheel_timer_t *head )
+{
+    head->next = head->prev = head;
+}
+
+
+static inline void wheel_list_add( wheel_timer_t *head, wheel_timer_t *t )
+{
+    t->prev = head->prev;
+    t->next = head;
+    head->prev->next = t;
+    head->prev = t;
+}
+
+
+static inline void wheel_list_del( wheel_timer_t *t )
+{
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    t->next = t->prev = NULL;
+}
+
+
+static inline void wheel_init( wheel_t *w, uint64_t now )
+{
+    int level = 0;
+    int slot = 0;
+
+    w->now = now;
+    w->ntimer = 0;
+    for(; level < WHEEL_NLEVEL; level++ ){
+        for( slot = 0; slot < WHEEL_NSLOT; slot++ ){
+            wheel_list_init( &w->slots[level][slot] );
+        }
+    }
+}
+
+
+/**
+ * initialize the timer as not linked
+ */
+static inline void wheel_timer_init( wheel_timer_t *t )
+{
+    t->next = t->prev = NULL;
+    t->expire = 0;
+}
+
+
+static inline int wheel_pending( const wheel_timer_t *t )
+{
+    return t->next != NULL;
+}
+
+
+static inline void wheel_link( wheel_t *w, wheel_timer_t *t )
+{
+    uint64_t delta = t->expire - w->now;
+    int level = 0;
+
+    while( level < WHEEL_NLEVEL - 1 &&
+           delta >> ( ( level + 1 ) * WHEEL_BITS ) ){
+        level++;
+    }
+    wheel_list_add( &w->slots[level][( t->expire >> ( level * WHEEL_BITS ) ) &
+                                     WHEEL_MASK], t );
+}
+
+
+/**
+ * delete the timer if it is linked
+ */
+static inline void wheel_del( wheel_t *w, wheel_timer_t *t )
+{
+    if( wheel_pending( t ) ){
+        wheel_list_del( t );
+        w->ntimer--;
+    }
+}
+
+
+/**
+ * (re)link the timer that expires at the tick. the past ticks expire at the
+ * next wheel_expire.
+ */
+static inline void wheel_add( wheel_t *w, wheel_timer_t *t, uint64_t expire )
+{
+    wheel_del( w, t );
+    if( expire < w->now ){
+        expire = w->now;
+    }
+    else if( expire - w->now > WHEEL_MAXTICK ){
+        expire = w->now + WHEEL_MAXTICK;
+    }
+    t->expire = expire;
+    wheel_link( w, t );
+    w->ntimer++;
+}
+
+
+/**
+ * expire the timers up to the tick now, and move them to the list of the
+ * head. return the number of the expired timers.
+ */
+static inline size_t wheel_expire( wheel_t *w, uint64_t now,
+                                   wheel_timer_t *expired )
+{
+    wheel_timer_t *head = NULL;
+    wheel_timer_t *t = NULL;
+    size_t n = 0;
+    int level = 0;
+
+    wheel_list_init( expired );
+    for(; w->now <= now; w->now++ )
+    {
+        // nothing to move until the next timer
+        if( w->ntimer == n ){
+            w->now = now + 1;
+            break;
+        }
+
+        // cascade the slots whose span starts at the tick
+        for( level = WHEEL_NLEVEL - 1; level > 0; level-- )
+        {
+            if( w->now & ( ( UINT64_C(1) << ( level * WHEEL_BITS ) ) - 1 ) ){
+                continue;
+            }
+            head = &w->slots[level][( w->now >> ( level * WHEEL_BITS ) ) &
+                                    WHEEL_MASK];
+            while( ( t = head->next ) != head ){
+                wheel_list_del( t );
+                wheel_link( w, t );
+            }
+        }
+
+        head = &w->slots[0][w->now & WHEEL_MASK];
+        while( ( t = head->next ) != head ){
+            wheel_list_del( t );
+            wheel_list_add( expired, t );
+            n++;
+        }
+    }
+    w->ntimer -= n;
+
+    return n;
+}
+
+
+#endif
@@ -41,9 +41,12 @@
 */
 #include "http.h"
 #include "strchr_brk.h"
+#include "http_probes.h"
+#include "http_scan.h"
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
 
 
 /**
@@ -297,7 +300,7 @@ static const unsigned char SPHT[256] = {
 // status length
 #define STATUS_LEN  3
 
-#define HEADER_SIZE     (2 * sizeof(uintptr_t) + sizeof(uint32_t))
+#define HEADER_SIZE     (2 * sizeof(uintptr_t) + 2 * sizeof(uint32_t))
 #define HKEY_SIZE       (sizeof(uintptr_t) + sizeof(uint16_t))
 
 #define GET_HKEY_PTR(h,n) \
@@ -306,6 +309,9 @@ static const unsigned char SPHT[256] = {
 #define GET_HVAL_PTR(h,n) \
     (&((uint8_t*)(h))[sizeof( http_t ) + HEADER_SIZE * n + HKEY_SIZE])
 
+#define GET_HHASH_PTR(h,n) \
+    (&((uint8_t*)(h))[sizeof( http_t ) + HEADER_SIZE * n + HKEY_SIZE * 2])
+
 #define ADD_HKEY(h,k,l) do{ \
     uint8_t *mem = GET_HKEY_PTR(h, (h)->nheader); \
     *(uintptr_t*)mem = k; \
@@ -318,11 +324,56 @@ static const unsigned char SPHT[256] = {
     *(uint16_t*)&mem[sizeof( uintptr_t )] = (uint16_t)(l); \
 }while(0)
 
+#define ADD_HHASH(h,v) do{ \
+    *(uint32_t*)GET_HHASH_PTR(h, (h)->nheader) = v; \
+}while(0)
+
+
+/**
+ * invoke the SAX mode callback, true if the callback aborted the parse
+ */
+#define INVOKE_CB(h,name,...) \
+    ( (h)->cb && (h)->cb->name && (h)->cb->name( h, (h)->udata, __VA_ARGS__ ) )
+
+
+/**
+ * header filter
+ */
+#define FILTER_MASK     (HTTP_FILTER_SIZE - 1)
+#define FILTER_HASH(k,l) \
+    ( ( (l) * 7 + TO_LOWER( (unsigned char)(k)[0] ) * 31 + \
+        TO_LOWER( (unsigned char)(k)[(l) - 1] ) ) & FILTER_MASK )
+
+static inline int filter_lookup( const http_filter_t *f, const char *key,
+                                 size_t klen )
+{
+    size_t i = 0;
+
+    if( !klen || klen > UINT16_MAX ){
+        return -1;
+    }
+
+    // the table is at most half full. the key may not be lowercase with
+    // HTTP_OPT_NOMUTATE
+    for( i = FILTER_HASH( key, klen ); f->tbl[i].id;
+         i = ( i + 1 ) & FILTER_MASK )
+    {
+        if( f->tbl[i].len == klen &&
+            strcase_eq( (const unsigned char*)f->tbl[i].name,
+                        (const unsigned char*)key, klen ) ){
+            return f->tbl[i].id - 1;
+        }
+    }
+
+    return -1;
+}
+
 
 /**
  * prototypes
  */
 static int parse_hkey( http_t *h, char *buf, size_t len, uint16_t maxhdrlen );
+static int compact_lines( http_t *h, char *buf );
 
 
 /**
@@ -352,7 +403,7 @@ static int parse_eol( http_t *h, char *buf )
                 h->cur++;
                 // calc and save index
                 h->head = h->cur;
-                h->phase = HTTP_PHASE_DONE;
+                HTTP_SET_PHASE( h, HTTP_PHASE_DONE );
                 return HTTP_SUCCESS;
             }
 
@@ -362,10 +413,197 @@ static int parse_eol( http_t *h, char *buf )
 }
 
 
+/**
+ * check the line of head to end without the trailing OWS that exceeds
+ * maxhdrlen: only the key-length is limited if the hval is empty. the line
+ * must also fit in the uint16_t length of the slot.
+ */
+static int check_hlen( unsigned char *delim, size_t head, size_t end,
+                       uint16_t maxhdrlen )
+{
+    unsigned char *colon = memchr( delim + head, ':', end - head );
+
+    // invalid header format as well as parse_hkey
+    if( !colon ){
+        return HTTP_EHDRFMT;
+    }
+    else if( (size_t)( colon - delim ) + 1 != end ||
+             (size_t)( colon - delim ) - head > maxhdrlen ||
+             end - head > UINT16_MAX ){
+        return HTTP_EHDRLEN;
+    }
+
+    return HTTP_SUCCESS;
+}
+
+
+/**
+ * HTTP_OPT_LAZY: record the header lines into the slots until the end of
+ * headers. the key of the slot is the line without the trailing OWS and the
+ * value is 0 until the line is split by split_line.
+ *
+ * h->head: head of the current line
+ * h->cur: position to resume the LF scan
+ */
+static int parse_lines( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
+{
+    unsigned char *delim = (unsigned char*)buf;
+    size_t head = h->head;
+    size_t cur = h->cur;
+    size_t tail = 0;
+    size_t end = 0;
+    int rc = 0;
+    int err = 0;
+
+    while( ( cur = lf_scan( delim, cur, len ) ) < len )
+    {
+        // remove CR of CRLF
+        tail = ( cur > head && delim[cur - 1] == CR ) ? cur - 1 : cur;
+        // skip LF
+        cur++;
+        // end of headers
+        if( tail == head ){
+            h->head = h->cur = cur;
+            HTTP_SET_PHASE( h, HTTP_PHASE_DONE );
+            return HTTP_SUCCESS;
+        }
+        // too many headers: split the recorded lines to remove the empty
+        // hvals that are not counted in the default mode
+        else if( h->nheader >= h->maxheader &&
+                 ( ( rc = compact_lines( h, buf ) ) ||
+                   h->nheader >= h->maxheader ) ){
+            return rc ? rc : HTTP_ENHDR;
+        }
+        // the line without the trailing OWS as well as parse_hval
+        for( end = tail; end > head && SPHT[delim[end - 1]]; end-- ){}
+        // header-length too large: the empty hval is checked by the
+        // key-length only as well as parse_hkey
+        if( ( end - head ) > maxhdrlen &&
+            ( rc = check_hlen( delim, head, end, maxhdrlen ) ) ){
+            goto INVALID_LINE;
+        }
+        ADD_HKEY( h, head, end - head );
+        ADD_HVAL( h, 0, 0 );
+        ADD_HHASH( h, 0 );
+        h->nheader++;
+        head = cur;
+    }
+
+    // header-length too large
+    if( ( len - head ) > maxhdrlen ){
+        rc = HTTP_EHDRLEN;
+        goto INVALID_LINE;
+    }
+    h->head = head;
+    h->cur = len;
+
+    return HTTP_EAGAIN;
+
+INVALID_LINE:
+    // the invalid lines before are reported first as well as the default mode
+    return ( err = compact_lines( h, buf ) ) ? err : rc;
+}
+
+
+/**
+ * split the line recorded by parse_lines into the key and value, and
+ * validate them as well as parse_hkey and parse_hval
+ */
+static int split_line( http_t *h, char *buf, uint8_t at )
+{
+    unsigned char *delim = (unsigned char*)buf;
+    uint8_t *mem = GET_HKEY_PTR( h, at );
+    size_t head = *(uintptr_t*)mem;
+    size_t tail = head + *(uint16_t*)&mem[sizeof( uintptr_t )];
+    size_t cur = head;
+    size_t klen = 0;
+    unsigned char c = 0;
+    const int mutate = !( h->opts & HTTP_OPT_NOMUTATE );
+
+    for(; cur < tail; cur++ )
+    {
+        c = HKEYC_TBL[delim[cur]];
+        // COLON
+        if( c == 2 ){
+            break;
+        }
+        // illegal byte sequence
+        else if( !c ){
+            return HTTP_EHDRFMT;
+        }
+        // convert to lowercase
+        else if( mutate ){
+            delim[cur] = c;
+        }
+    }
+    // colon not found
+    if( cur == tail ){
+        return HTTP_EHDRFMT;
+    }
+    klen = cur - head;
+
+    // remove OWS
+    for( cur++; cur < tail && SPHT[delim[cur]]; cur++ ){}
+    while( tail > cur && SPHT[delim[tail - 1]] ){
+        tail--;
+    }
+    // CR in the middle of line or control characters
+    if( vchar_scan( delim, cur, tail ) != tail ){
+        return HTTP_EHDRFMT;
+    }
+    // the slot keeps the whole line until the line is valid
+    *(uint16_t*)&mem[sizeof( uintptr_t )] = (uint16_t)klen;
+    *(uint32_t*)GET_HHASH_PTR( h, at ) = mutate ? 0 :
+                                         strcase_hash( delim + head, klen );
+    mem += HKEY_SIZE;
+    *(uintptr_t*)mem = cur;
+    *(uint16_t*)&mem[sizeof( uintptr_t )] = (uint16_t)( tail - cur );
+
+    return HTTP_SUCCESS;
+}
+
+
+/**
+ * split the lines recorded by parse_lines, and remove the empty hvals as
+ * well as parse_hkey
+ */
+static int compact_lines( http_t *h, char *buf )
+{
+    uint8_t i = 0;
+    uint8_t n = 0;
+    int rc = 0;
+
+    for(; i < h->nheader; i++ )
+    {
+        if( !*(uintptr_t*)GET_HVAL_PTR( h, i ) &&
+            ( rc = split_line( h, buf, i ) ) ){
+            return rc;
+        }
+        // remove the empty hval as well as parse_hkey
+        else if( *(uint16_t*)&GET_HVAL_PTR( h, i )[sizeof( uintptr_t )] )
+        {
+            if( n != i ){
+                memcpy( GET_HKEY_PTR( h, n ), GET_HKEY_PTR( h, i ),
+                        HEADER_SIZE );
+            }
+            n++;
+        }
+    }
+    h->nheader = n;
+
+    return HTTP_SUCCESS;
+}
+
+
 static int parse_header( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
 {
     char *str = buf + h->cur;
 
+    // the lazy mode needs the slots to record the lines
+    if( ( h->opts & HTTP_OPT_LAZY ) && !h->cb && !h->filter ){
+        return parse_lines( h, buf, len, maxhdrlen );
+    }
+
     switch( *str )
     {
         // need more bytes
@@ -376,7 +614,7 @@ static int parse_header( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
         case LF:
             // calc and save index
             h->head = h->cur = h->cur + 1;
-            h->phase = HTTP_PHASE_DONE;
+            HTTP_SET_PHASE( h, HTTP_PHASE_DONE );
             return HTTP_SUCCESS;
 
         // check header-tail
@@ -387,16 +625,18 @@ static int parse_header( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
             else if( str[1] == LF ){
                 // calc and save index
                 h->head = h->cur = h->cur + 2;
-                h->phase = HTTP_PHASE_DONE;
+                HTTP_SET_PHASE( h, HTTP_PHASE_DONE );
                 return HTTP_SUCCESS;
             }
             // invalid header format
             return HTTP_EHDRFMT;
 
         default:
-            if( h->nheader < h->maxheader ){
+            // the number of headers is not limited in the SAX mode, and it
+            // is checked after the key lookup if the filter is set
+            if( h->cb || h->filter || h->nheader < h->maxheader ){
                 // set next parser hkey
-                h->phase = HTTP_PHASE_HKEY;
+                HTTP_SET_PHASE( h, HTTP_PHASE_HKEY );
                 return parse_hkey( h, buf, len, maxhdrlen );
             }
             // too many headers
@@ -408,19 +648,17 @@ static int parse_header( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
 static int parse_hval( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
 {
     unsigned char *delim = (unsigned char*)buf;
-    uintptr_t hkey = *(uintptr_t*)GET_HKEY_PTR( h, h->nheader );
+    uintptr_t hkey = h->key;
     size_t cur = h->cur;
     size_t tail = 0;
     unsigned char c = 0;
 
-    for(; cur < len; cur++ )
+    // skip the field-content
+    while( ( cur = vchar_scan( delim, cur, len ) ) < len )
     {
         c = delim[cur];
         switch( VCHAR[c] )
         {
-            case 1:
-                continue;
-
             // LF or CR
             case 2:
                 tail = cur;
@@ -441,21 +679,36 @@ static int parse_hval( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
 
                 // found LF
                 // remove OWS
-                while( SPHT[delim[tail-1]] ){
+                while( tail > h->head && SPHT[delim[tail-1]] ){
                     tail--;
                 }
                 // check length
                 if( ( tail - hkey ) > maxhdrlen ){
                     return HTTP_EHDRLEN;
                 }
-
-                // calc value-length
-                ADD_HVAL( h, h->head, tail - h->head );
-                h->nheader++;
+                // ignore empty hval as well as parse_hkey
+                else if( tail > h->head )
+                {
+                    HTTP_PROBE_HEADER( h, hkey, h->head, tail - h->head );
+                    if( h->cb ){
+                        if( INVOKE_CB( h, on_header, buf + hkey, h->klen,
+                                       buf + h->head, tail - h->head ) ){
+                            return HTTP_ECALLBACK;
+                        }
+                    }
+                    else {
+                        ADD_HKEY( h, hkey, h->klen );
+                        // calc value-length
+                        ADD_HVAL( h, h->head, tail - h->head );
+                        ADD_HHASH( h, ( h->opts & HTTP_OPT_NOMUTATE ) ?
+                                   strcase_hash( delim + hkey, h->klen ) : 0 );
+                        h->nheader++;
+                    }
+                }
                 // skip CRLF
                 h->head = h->cur = cur;
                 // set next parser
-                h->phase = HTTP_PHASE_HEADER;
+                HTTP_SET_PHASE( h, HTTP_PHASE_HEADER );
 
                 return parse_header( h, buf, len, maxhdrlen );
 
@@ -476,12 +729,69 @@ CHECK_AGAIN:
 }
 
 
+/**
+ * validate and skip the header that is not in the filter
+ */
+static int parse_hskip( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
+{
+    unsigned char *delim = (unsigned char*)buf;
+    size_t cur = vchar_scan( delim, h->cur, len );
+    size_t tail = cur;
+
+    if( cur < len )
+    {
+        // found LF
+        if( delim[cur] == LF ){
+            cur++;
+        }
+        else if( delim[cur] != CR ){
+            return HTTP_EHDRFMT;
+        }
+        else if( delim[cur + 1] == LF ){
+            cur += 2;
+        }
+        // null-terminator
+        else if( delim[cur + 1] ){
+            return HTTP_EHDRFMT;
+        }
+
+        if( cur != tail )
+        {
+            // remove OWS as well as parse_hval
+            while( tail > h->head && SPHT[delim[tail - 1]] ){
+                tail--;
+            }
+            // check length: the empty hval is limited by the key-length
+            // that parse_hkey checked
+            if( tail > h->head && ( tail - h->key ) > maxhdrlen ){
+                return HTTP_EHDRLEN;
+            }
+            // skip CRLF
+            h->head = h->cur = cur;
+            // set next parser
+            HTTP_SET_PHASE( h, HTTP_PHASE_HEADER );
+
+            return parse_header( h, buf, len, maxhdrlen );
+        }
+    }
+
+    // header-length too large
+    if( ( len - h->key ) > maxhdrlen ){
+        return HTTP_EHDRLEN;
+    }
+    h->cur = cur;
+
+    return HTTP_EAGAIN;
+}
+
+
 static int parse_hkey( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
 {
     unsigned char *delim = (unsigned char*)buf;
     size_t cur = h->cur;
     uintptr_t klen = h->head;
     unsigned char c = 0;
+    const int mutate = !( h->opts & HTTP_OPT_NOMUTATE );
 
 RECHECK:
     if( cur < len )
@@ -503,6 +813,21 @@ RECHECK:
                 // update parse cursor
                 h->cur = cur;
 
+                if( h->filter )
+                {
+                    // not in the filter
+                    if( filter_lookup( h->filter, buf + h->head, klen ) < 0 ){
+                        h->key = h->head;
+                        h->head = h->cur = cur + 1;
+                        HTTP_SET_PHASE( h, HTTP_PHASE_HSKIP );
+                        return parse_hskip( h, buf, len, maxhdrlen );
+                    }
+                    // too many headers
+                    else if( !h->cb && h->nheader >= h->maxheader ){
+                        return HTTP_ENHDR;
+                    }
+                }
+
                 // remove OWS
                 while( ++cur < len )
                 {
@@ -519,25 +844,26 @@ RECHECK:
                         }
                         else if( delim[cur+1] == LF ){
                             h->head = h->cur = cur + 2;
-                            h->phase = HTTP_PHASE_HEADER;
+                            HTTP_SET_PHASE( h, HTTP_PHASE_HEADER );
                             return parse_header( h, buf, len, maxhdrlen );
                         }
                         return HTTP_EHDRFMT;
                     }
                     else if( delim[cur] == LF ){
                         h->head = h->cur = cur + 1;
-                        h->phase = HTTP_PHASE_HEADER;
+                        HTTP_SET_PHASE( h, HTTP_PHASE_HEADER );
                         return parse_header( h, buf, len, maxhdrlen );
                     }
                     break;
                 }
 
                 // set key-index and hkey-length
-                ADD_HKEY( h, h->head, klen );
+                h->key = h->head;
+                h->klen = (uint16_t)klen;
                 // set cursor
                 h->head = h->cur = cur;
                 // set next parser
-                h->phase = HTTP_PHASE_HVAL;
+                HTTP_SET_PHASE( h, HTTP_PHASE_HVAL );
 
                 if( cur >= len ){
                     return HTTP_EAGAIN;
@@ -545,7 +871,10 @@ RECHECK:
 
                 return parse_hval( h, buf, len, maxhdrlen );
         }
-        delim[cur] = c;
+        // convert to lowercase
+        if( mutate ){
+            delim[cur] = c;
+        }
         cur++;
         goto RECHECK;
     }
@@ -606,7 +935,7 @@ static int parse_ver( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
             // skip CRLF
             h->head = h->cur = (uintptr_t)delim - (uintptr_t)buf + 1;
             // set next phase
-            h->phase = HTTP_PHASE_EOL;
+            HTTP_SET_PHASE( h, HTTP_PHASE_EOL );
 
             return parse_eol( h, buf );
         }
@@ -618,12 +947,16 @@ static int parse_ver( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
         // skip LF
         h->head = h->cur = (uintptr_t)delim - (uintptr_t)buf + 1;
         // set next phase
-        h->phase = HTTP_PHASE_HEADER;
+        HTTP_SET_PHASE( h, HTTP_PHASE_HEADER );
+        // stop after the request-line
+        if( h->opts & HTTP_OPT_REQLINE ){
+            return HTTP_SUCCESS;
+        }
 
         return parse_header( h, buf, len, maxhdrlen );
     }
-    // invalid version format
-    else if( ( len - h->head ) > VER_LEN ){
+    // invalid version format (allow the CR of CRLF)
+    else if( ( len - h->head ) > VER_LEN + 1 ){
         return HTTP_EVERSION;
     }
     // update parse cursor
@@ -655,7 +988,7 @@ static int parse_uri( http_t *h, char *buf, size_t len, uint16_t maxurilen,
             }
 
             // set next phase
-            h->phase = HTTP_PHASE_DONE;
+            HTTP_SET_PHASE( h, HTTP_PHASE_DONE );
             goto CHECK_URI;
         }
 
@@ -666,7 +999,7 @@ static int parse_uri( http_t *h, char *buf, size_t len, uint16_t maxurilen,
     else if( delim )
     {
         // set next phase
-        h->phase = HTTP_PHASE_VERSION;
+        HTTP_SET_PHASE( h, HTTP_PHASE_VERSION );
 
 CHECK_URI:
         // calc uri-length
@@ -676,6 +1009,9 @@ CHECK_URI:
         if( h->msglen > maxurilen ){
             return HTTP_EURILEN;
         }
+        else if( INVOKE_CB( h, on_target, buf + h->head, h->msglen ) ){
+            return HTTP_ECALLBACK;
+        }
         // HTTP/0.9 request
         else if( h->phase == HTTP_PHASE_DONE ){
             return HTTP_SUCCESS;
@@ -698,99 +1034,108 @@ CHECK_URI:
 }
 
 
+/**
+ * return the method code of the token, or 0 if not implemented
+ */
+static inline uint16_t method_code( const char *head, size_t slen )
+{
+    match64bit_u src = { .bit = 0 };
+
+    switch( slen ){
+        case 3:
+            src.str[0] = head[0];
+            src.str[1] = head[1];
+            src.str[2] = head[2];
+            if( src.bit == M_GET.bit ){
+                return HTTP_MGET;
+            }
+            else if( src.bit == M_PUT.bit ){
+                return HTTP_MPUT;
+            }
+            return 0;
+
+        case 4:
+            src.str[0] = head[0];
+            src.str[1] = head[1];
+            src.str[2] = head[2];
+            src.str[3] = head[3];
+            if( src.bit == M_POST.bit ){
+                return HTTP_MPOST;
+            }
+            else if( src.bit == M_HEAD.bit ){
+                return HTTP_MHEAD;
+            }
+            return 0;
+
+        case 5:
+            src.str[0] = head[0];
+            src.str[1] = head[1];
+            src.str[2] = head[2];
+            src.str[3] = head[3];
+            src.str[4] = head[4];
+            if( src.bit == M_TRACE.bit ){
+                return HTTP_MTRACE;
+            }
+            return 0;
+
+        case 6:
+            src.str[0] = head[0];
+            src.str[1] = head[1];
+            src.str[2] = head[2];
+            src.str[3] = head[3];
+            src.str[4] = head[4];
+            src.str[5] = head[5];
+            if( src.bit == M_DELETE.bit ){
+                return HTTP_MDELETE;
+            }
+            return 0;
+
+        case 7:
+            src.str[0] = head[0];
+            src.str[1] = head[1];
+            src.str[2] = head[2];
+            src.str[3] = head[3];
+            src.str[4] = head[4];
+            src.str[5] = head[5];
+            src.str[6] = head[6];
+            if( src.bit == M_OPTIONS.bit ){
+                return HTTP_MOPTIONS;
+            }
+            else if( src.bit == M_CONNECT.bit ){
+                return HTTP_MCONNECT;
+            }
+            return 0;
+
+        // method not implemented
+        default:
+            return 0;
+    }
+}
+
+
 static int parse_method( http_t *h, char *buf, size_t len, uint16_t maxurilen,
                          uint16_t maxhdrlen )
 {
-    char *delim = memchr( buf + h->cur, SP, len );
+    char *delim = memchr( buf + h->cur, SP, len - h->cur );
 
     if( delim )
     {
         char *head = buf + h->head;
         size_t slen = (uintptr_t)delim - (uintptr_t)head;
-        match64bit_u src = { .bit = 0 };
-
-        switch( slen ){
-            case 3:
-                src.str[0] = head[0];
-                src.str[1] = head[1];
-                src.str[2] = head[2];
-                if( src.bit == M_GET.bit ){
-                    h->protocol = HTTP_MGET;
-                    break;
-                }
-                else if( src.bit == M_PUT.bit ){
-                    h->protocol = HTTP_MPUT;
-                    break;
-                }
-                return HTTP_EMETHOD;
-
-            case 4:
-                src.str[0] = head[0];
-                src.str[1] = head[1];
-                src.str[2] = head[2];
-                src.str[3] = head[3];
-                if( src.bit == M_POST.bit ){
-                    h->protocol = HTTP_MPOST;
-                    break;
-                }
-                else if( src.bit == M_HEAD.bit ){
-                    h->protocol = HTTP_MHEAD;
-                    break;
-                }
-                return HTTP_EMETHOD;
-
-            case 5:
-                src.str[0] = head[0];
-                src.str[1] = head[1];
-                src.str[2] = head[2];
-                src.str[3] = head[3];
-                src.str[4] = head[4];
-                if( src.bit == M_TRACE.bit ){
-                    h->protocol = HTTP_MTRACE;
-                    break;
-                }
-                return HTTP_EMETHOD;
-
-            case 6:
-                src.str[0] = head[0];
-                src.str[1] = head[1];
-                src.str[2] = head[2];
-                src.str[3] = head[3];
-                src.str[4] = head[4];
-                src.str[5] = head[5];
-                if( src.bit == M_DELETE.bit ){
-                    h->protocol = HTTP_MDELETE;
-                    break;
-                }
-                return HTTP_EMETHOD;
 
-            case 7:
-                src.str[0] = head[0];
-                src.str[1] = head[1];
-                src.str[2] = head[2];
-                src.str[3] = head[3];
-                src.str[4] = head[4];
-                src.str[5] = head[5];
-                src.str[6] = head[6];
-                if( src.bit == M_OPTIONS.bit ){
-                    h->protocol = HTTP_MOPTIONS;
-                    break;
-                }
-                else if( src.bit == M_CONNECT.bit ){
-                    h->protocol = HTTP_MCONNECT;
-                    break;
-                }
-                return HTTP_EMETHOD;
+        // method not implemented
+        if( !( h->protocol = method_code( head, slen ) ) ){
+            return HTTP_EMETHOD;
+        }
 
-            // method not implemented
-            default:
-                return HTTP_EMETHOD;
+        if( INVOKE_CB( h, on_method, head, slen ) ){
+            return HTTP_ECALLBACK;
         }
 
         // update parse cursor, token-head and url head
-        h->head = h->cur = h->cur + slen + 1;
+        h->head = h->cur = h->head + slen + 1;
         // set next phase
-        h->phase = HTTP_PHASE_URI;
+        HTTP_SET_PHASE( h, HTTP_PHASE_URI );
 
         return parse_uri( h, buf, len, maxurilen, maxhdrlen );
     }
@@ -806,8 +1151,8 @@ static int parse_method( http_t *h, char *buf, size_t len, uint16_t maxurilen,
 }
 
 
-int http_parse_request( http_t *h, char *buf, size_t len, uint16_t maxurilen,
-                        uint16_t maxhdrlen )
+static int parse_request( http_t *h, char *buf, size_t len,
+                          uint16_t maxurilen, uint16_t maxhdrlen )
 {
     switch( h->phase )
     {
@@ -832,6 +1177,9 @@ int http_parse_request( http_t *h, char *buf, size_t len, uint16_t maxurilen,
         case HTTP_PHASE_HVAL:
             return parse_hval( h, buf, len, maxhdrlen );
 
+        case HTTP_PHASE_HSKIP:
+            return parse_hskip( h, buf, len, maxhdrlen );
+
         case HTTP_PHASE_DONE:
             return HTTP_SUCCESS;
     }
@@ -844,6 +1192,7 @@ static int parse_reason( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
 {
     unsigned char *delim = (unsigned char*)buf;
     size_t cur = h->cur;
+    size_t tail = 0;
     unsigned char c = 0;
 
     for(; cur < len; cur++ )
@@ -856,6 +1205,7 @@ static int parse_reason( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
 
             // LF or CR
             case 2:
+                tail = cur;
                 // found LF
                 if( c == LF ){
                     cur++;
@@ -875,6 +1225,10 @@ static int parse_reason( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
                 if( ( cur - h->head ) > UINT16_MAX ){
                     return HTTP_EREASON;
                 }
+                else if( INVOKE_CB( h, on_target, buf + h->head,
+                                    tail - h->head ) ){
+                    return HTTP_ECALLBACK;
+                }
 
                 // calc phrase-length
                 h->msg = (uint8_t)h->head;
@@ -882,7 +1236,11 @@ static int parse_reason( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
                 // skip CRLF
                 h->head = h->cur = cur;
                 // set next parser
-                h->phase = HTTP_PHASE_HEADER;
+                HTTP_SET_PHASE( h, HTTP_PHASE_HEADER );
+                // stop after the status-line
+                if( h->opts & HTTP_OPT_REQLINE ){
+                    return HTTP_SUCCESS;
+                }
 
                 return parse_header( h, buf, len, maxhdrlen );
 
@@ -927,7 +1285,7 @@ static int parse_status( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
         // update parse cursor, token-head and url head
         h->head = h->cur = h->head + slen + 1;
         // set next phase
-        h->phase = HTTP_PHASE_REASON;
+        HTTP_SET_PHASE( h, HTTP_PHASE_REASON );
 
         return parse_reason( h, buf, len, maxhdrlen );
     }
@@ -979,7 +1337,7 @@ static int parse_ver_res( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
             // skip SP
             h->head = h->cur = VER_LEN + 1;
             // set next phase
-            h->phase = HTTP_PHASE_STATUS;
+            HTTP_SET_PHASE( h, HTTP_PHASE_STATUS );
 
             return parse_status( h, buf, len, maxhdrlen );
         }
@@ -1004,7 +1362,8 @@ static int parse_ver_res( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
 }
 
 
-int http_parse_response( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
+static int parse_response( http_t *h, char *buf, size_t len,
+                           uint16_t maxhdrlen )
 {
     switch( h->phase )
     {
@@ -1029,6 +1388,9 @@ int http_parse_response( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
         case HTTP_PHASE_HVAL:
             return parse_hval( h, buf, len, maxhdrlen );
 
+        case HTTP_PHASE_HSKIP:
+            return parse_hskip( h, buf, len, maxhdrlen );
+
         case HTTP_PHASE_DONE:
             return HTTP_SUCCESS;
     }
@@ -1037,41 +1399,1532 @@ int http_parse_response( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
 }
 
 
-http_t *http_alloc( uint8_t maxheader )
+
+/**
+ * parse the headers of the complete head without the end-of-buffer checks.
+ * every loop also stops at the null-terminator buf[len] that is not a valid
+ * byte, so the incomplete head is just an error.
+ * return HTTP_ERROR on any error, the state machine reports the error.
+ */
+static int parse_headers_fast( http_t *h, char *buf, size_t len,
+                               uint16_t maxhdrlen )
 {
-    http_t *h = (http_t*)calloc( 1, http_alloc_size( maxheader ) );
+    unsigned char *delim = (unsigned char*)buf;
+    size_t cur = h->cur;
+    size_t head = 0;
+    size_t klen = 0;
+    size_t val = 0;
+    size_t tail = 0;
+    uintptr_t key = h->key;
+    uint16_t lastklen = h->klen;
+    unsigned char c = 0;
+    const int mutate = !( h->opts & HTTP_OPT_NOMUTATE );
 
-    if( h ){
-        h->maxheader = maxheader;
+    for(;;)
+    {
+        head = cur;
+        // end of headers
+        if( delim[cur] == LF ){
+            cur++;
+            break;
+        }
+        else if( delim[cur] == CR ){
+            if( delim[cur + 1] != LF ){
+                return HTTP_ERROR;
+            }
+            cur += 2;
+            break;
+        }
+        // too many headers
+        else if( h->nheader >= h->maxheader ){
+            return HTTP_ERROR;
+        }
+
+        // tchar are greater than 2 and COLON is 2
+        while( ( c = HKEYC_TBL[delim[cur]] ) > 2 )
+        {
+            // convert to lowercase
+            if( mutate ){
+                delim[cur] = c;
+            }
+            cur++;
+        }
+        klen = cur - head;
+        if( c != 2 || klen > maxhdrlen ){
+            return HTTP_ERROR;
+        }
+
+        // remove OWS
+        for( cur++; SPHT[delim[cur]]; cur++ ){}
+        val = cur;
+        // LF or CR of CRLF
+        tail = cur = vchar_scan( delim, cur, len );
+        if( delim[cur] == CR ){
+            cur++;
+        }
+        if( delim[cur] != LF ){
+            return HTTP_ERROR;
+        }
+        cur++;
+
+        // remove OWS
+        while( tail > val && SPHT[delim[tail - 1]] ){
+            tail--;
+        }
+        // ignore empty hval as well as parse_hkey
+        if( tail > val )
+        {
+            // check length
+            if( ( tail - head ) > maxhdrlen ){
+                return HTTP_ERROR;
+            }
+            HTTP_PROBE_HEADER( h, head, val, tail - val );
+            ADD_HKEY( h, head, klen );
+            ADD_HVAL( h, val, tail - val );
+            ADD_HHASH( h, mutate ? 0 : strcase_hash( delim + head, klen ) );
+            h->nheader++;
+            key = head;
+            lastklen = (uint16_t)klen;
+        }
     }
 
-    return h;
+    h->key = key;
+    h->klen = lastklen;
+    h->head = h->cur = cur;
+    HTTP_SET_PHASE( h, HTTP_PHASE_DONE );
+
+    return HTTP_SUCCESS;
 }
 
 
-void http_free( http_t *h )
+static inline int parse_state( http_t *h, char *buf, size_t len,
+                               uint16_t maxurilen, uint16_t maxhdrlen,
+                               int isreq )
 {
-    free( (void*)h );
+    return isreq ? parse_request( h, buf, len, maxurilen, maxhdrlen ) :
+                   parse_response( h, buf, len, maxhdrlen );
 }
 
 
-int http_getheader_at( http_t *h, uintptr_t *key, uint16_t *klen,
-                       uintptr_t *val, uint16_t *vlen, uint8_t at )
+/**
+ * the alternate parsers support the first call without the SAX mode, filter,
+ * HTTP_OPT_LAZY and HTTP_OPT_REQLINE
+ */
+#define ALT_SUPPORTED(h) \
+    ( (h)->phase == HTTP_PHASE_METHOD && !(h)->cb && !(h)->filter && \
+      !( (h)->opts & ( HTTP_OPT_LAZY|HTTP_OPT_REQLINE ) ) )
+
+
+/**
+ * parse the start-line by the state machine for the alternate parsers
+ */
+static inline int parse_startline( http_t *h, char *buf, size_t len,
+                                   uint16_t maxurilen, uint16_t maxhdrlen,
+                                   int isreq )
 {
-    if( at < h->nheader ){
-        uint8_t *mem = GET_HKEY_PTR( h, at );
+    uint8_t opts = h->opts;
+    int rc = 0;
 
-        *key = *(uintptr_t*)mem;
-        *klen = *(uint16_t*)&mem[sizeof( uintptr_t )];
+    h->opts |= HTTP_OPT_REQLINE;
+    rc = parse_state( h, buf, len, maxurilen, maxhdrlen, isreq );
+    h->opts = opts;
 
-        mem += HKEY_SIZE;
-        *val = *(uintptr_t*)mem;
-        *vlen = *(uint16_t*)&mem[sizeof( uintptr_t )];
+    return rc;
+}
 
-        return 0;
-    }
 
+static int parse_head_fast( http_t *h, char *buf, size_t len,
+                            uint16_t maxurilen, uint16_t maxhdrlen, int isreq )
+{
+    int rc = 0;
+
+    // the head is not complete or the mode is not supported
+    if( !ALT_SUPPORTED( h ) || !eoh_scan( (unsigned char*)buf, len ) ){
+        return parse_state( h, buf, len, maxurilen, maxhdrlen, isreq );
+    }
+
+    rc = parse_startline( h, buf, len, maxurilen, maxhdrlen, isreq );
+    if( rc != HTTP_SUCCESS || h->phase != HTTP_PHASE_HEADER ){
+        return rc;
+    }
+    else if( parse_headers_fast( h, buf, len, maxhdrlen ) == HTTP_SUCCESS ){
+        return HTTP_SUCCESS;
+    }
+    // parse again to report the error
+    http_init( h );
+
+    return parse_state( h, buf, len, maxurilen, maxhdrlen, isreq );
+}
+
+
+/**
+ * HTTP_ENGINE_INDEX
+ *
+ * stage 1 classifies the bytes of the headers 64 bytes at a time into the
+ * bitmaps of the structural bytes (COLON, CR and LF) and the invalid bytes
+ * (control characters except HT, CR and LF, DEL and obs-text) until the
+ * block that contains the end of the head.
+ * stage 2 walks the structural bits line by line to fill the slots.
+ */
+#define INDEX_NWORD     256
+
+typedef struct {
+    // structural bytes
+    uint64_t st[INDEX_NWORD];
+    // invalid bytes
+    uint64_t bad[INDEX_NWORD];
+} index_t;
+
+
+static inline void index_block( const unsigned char *s, uint64_t *st,
+                                uint64_t *bad, uint64_t *lf, uint64_t *cr )
+{
+#if defined(__SSE2__)
+    const __m128i vcolon = _mm_set1_epi8( COLON );
+    const __m128i vcr = _mm_set1_epi8( CR );
+    const __m128i vlf = _mm_set1_epi8( LF );
+    const __m128i vht = _mm_set1_epi8( HT );
+    const __m128i vsp = _mm_set1_epi8( SP );
+    const __m128i vdel = _mm_set1_epi8( 0x7F );
+    __m128i v, l, c, ctl;
+    uint64_t mcolon = 0, mlf = 0, mcr = 0, mbad = 0;
+    int i = 0;
+
+    for(; i < 64; i += 16 )
+    {
+        v = _mm_loadu_si128( (const __m128i*)( s + i ) );
+        l = _mm_cmpeq_epi8( v, vlf );
+        c = _mm_cmpeq_epi8( v, vcr );
+        // 0x00-0x1F and 0x80-0xFF are less than SP in the signed compare
+        ctl = _mm_andnot_si128(
+            _mm_or_si128( _mm_or_si128( l, c ), _mm_cmpeq_epi8( v, vht ) ),
+            _mm_cmplt_epi8( v, vsp )
+        );
+        mlf |= (uint64_t)(unsigned)_mm_movemask_epi8( l ) << i;
+        mcr |= (uint64_t)(unsigned)_mm_movemask_epi8( c ) << i;
+        mcolon |= (uint64_t)(unsigned)_mm_movemask_epi8(
+            _mm_cmpeq_epi8( v, vcolon )
+        ) << i;
+        mbad |= (uint64_t)(unsigned)_mm_movemask_epi8(
+            _mm_or_si128( ctl, _mm_cmpeq_epi8( v, vdel ) )
+        ) << i;
+    }
+    *lf = mlf;
+    *cr = mcr;
+    *st = mcolon | mlf | mcr;
+    *bad = mbad;
+#else
+    uint64_t bit = 0;
+    int i = 0;
+
+    *st = *bad = *lf = *cr = 0;
+    for(; i < 64; i++ )
+    {
+        bit = 1ULL << i;
+        if( s[i] == LF ){
+            *lf |= bit;
+            *st |= bit;
+        }
+        else if( s[i] == CR ){
+            *cr |= bit;
+            *st |= bit;
+        }
+        else if( s[i] == COLON ){
+            *st |= bit;
+        }
+        else if( ( s[i] < SP && s[i] != HT ) || s[i] >= 0x7F ){
+            *bad |= bit;
+        }
+    }
+#endif
+}
+
+
+/**
+ * stage 1: return the number of the indexed bytes that contain the end of the
+ * head, or 0 if not found
+ */
+static size_t index_build( index_t *ix, const unsigned char *s, size_t len )
+{
+    unsigned char tail[64];
+    // the start-line ends with LF
+    uint64_t plf = 1ULL << 63;
+    uint64_t pcr = 0;
+    uint64_t lf = 0;
+    uint64_t cr = 0;
+    size_t cur = 0;
+    size_t w = 0;
+
+    for(; cur < len && w < INDEX_NWORD; cur += 64, w++ )
+    {
+        if( cur + 64 <= len ){
+            index_block( s + cur, &ix->st[w], &ix->bad[w], &lf, &cr );
+        }
+        // the last partial block
+        else {
+            memcpy( tail, s + cur, len - cur );
+            memset( tail + len - cur, 0, 64 - ( len - cur ) );
+            index_block( tail, &ix->st[w], &ix->bad[w], &lf, &cr );
+        }
+        // LF LF or LF CR LF
+        if( ( lf & ( ( lf << 1 ) | ( plf >> 63 ) ) ) ||
+            ( lf & ( ( cr << 1 ) | ( pcr >> 63 ) ) &
+                   ( ( lf << 2 ) | ( plf >> 62 ) ) ) ){
+            return cur + 64 < len ? cur + 64 : len;
+        }
+        plf = lf;
+        pcr = cr;
+    }
+
+    return 0;
+}
+
+
+/**
+ * position of the first structural byte from pos. the caller ensures that
+ * the indexed bytes contain it.
+ */
+static inline size_t index_next( const uint64_t *st, size_t pos )
+{
+    size_t w = pos >> 6;
+    uint64_t m = st[w] & ( ~0ULL << ( pos & 63 ) );
+
+    while( !m ){
+        m = st[++w];
+    }
+
+    return ( w << 6 ) + (size_t)__builtin_ctzll( m );
+}
+
+
+/**
+ * true if the range [from, to) contains the invalid bytes
+ */
+static inline int index_bad( const uint64_t *bad, size_t from, size_t to )
+{
+    size_t w = from >> 6;
+    size_t last = to >> 6;
+    uint64_t m = bad[w] & ( ~0ULL << ( from & 63 ) );
+
+    for(; w < last; m = bad[++w] )
+    {
+        if( m ){
+            return 1;
+        }
+    }
+
+    return ( to & 63 ) && ( m & ( ~0ULL >> ( 64 - ( to & 63 ) ) ) );
+}
+
+
+/**
+ * stage 2: return HTTP_ERROR on any error, the state machine reports the
+ * error.
+ */
+static int index_walk( http_t *h, char *buf, const index_t *ix,
+                       uint16_t maxhdrlen )
+{
+    unsigned char *delim = (unsigned char*)buf + h->cur;
+    size_t cur = 0;
+    size_t head = 0;
+    size_t klen = 0;
+    size_t val = 0;
+    size_t tail = 0;
+    uintptr_t key = h->key;
+    uint16_t lastklen = h->klen;
+    unsigned char c = 0;
+    const int mutate = !( h->opts & HTTP_OPT_NOMUTATE );
+
+    for(;;)
+    {
+        head = cur;
+        // end of headers
+        if( delim[cur] == LF ){
+            cur++;
+            break;
+        }
+        else if( delim[cur] == CR ){
+            if( delim[cur + 1] != LF ){
+                return HTTP_ERROR;
+            }
+            cur += 2;
+            break;
+        }
+        // too many headers
+        else if( h->nheader >= h->maxheader ){
+            return HTTP_ERROR;
+        }
+
+        // the first structural byte must be the COLON
+        cur = index_next( ix->st, cur );
+        if( delim[cur] != COLON ){
+            return HTTP_ERROR;
+        }
+        klen = cur - head;
+        if( klen > maxhdrlen ){
+            return HTTP_ERROR;
+        }
+        for( val = head; val < cur; val++ )
+        {
+            // tchar are greater than 2
+            if( ( c = HKEYC_TBL[delim[val]] ) < 3 ){
+                return HTTP_ERROR;
+            }
+            // convert to lowercase
+            else if( mutate ){
+                delim[val] = c;
+            }
+        }
+
+        // skip the COLON in the value
+        val = cur + 1;
+        do {
+            tail = index_next( ix->st, ++cur );
+            cur = tail;
+        } while( delim[cur] == COLON );
+        if( index_bad( ix->bad, val, tail ) ){
+            return HTTP_ERROR;
+        }
+        else if( delim[cur] == CR && delim[++cur] != LF ){
+            return HTTP_ERROR;
+        }
+        cur++;
+
+        // remove OWS
+        while( val < tail && SPHT[delim[val]] ){
+            val++;
+        }
+        while( tail > val && SPHT[delim[tail - 1]] ){
+            tail--;
+        }
+        // ignore empty hval as well as parse_hkey
+        if( tail > val )
+        {
+            // check length
+            if( ( tail - head ) > maxhdrlen ){
+                return HTTP_ERROR;
+            }
+            HTTP_PROBE_HEADER( h, h->cur + head, h->cur + val, tail - val );
+            ADD_HKEY( h, h->cur + head, klen );
+            ADD_HVAL( h, h->cur + val, tail - val );
+            ADD_HHASH( h, mutate ? 0 : strcase_hash( delim + head, klen ) );
+            h->nheader++;
+            key = h->cur + head;
+            lastklen = (uint16_t)klen;
+        }
+    }
+
+    h->key = key;
+    h->klen = lastklen;
+    h->head = h->cur = h->cur + cur;
+    HTTP_SET_PHASE( h, HTTP_PHASE_DONE );
+
+    return HTTP_SUCCESS;
+}
+
+
+static int parse_index( http_t *h, char *buf, size_t len, uint16_t maxurilen,
+                        uint16_t maxhdrlen, int isreq )
+{
+    index_t ix;
+    int rc = 0;
+
+    if( !ALT_SUPPORTED( h ) ){
+        return parse_state( h, buf, len, maxurilen, maxhdrlen, isreq );
+    }
+
+    rc = parse_startline( h, buf, len, maxurilen, maxhdrlen, isreq );
+    if( rc != HTTP_SUCCESS || h->phase != HTTP_PHASE_HEADER ){
+        return rc;
+    }
+    // the head is not complete or too large to index, resume the header
+    // parse by the state machine
+    else if( !index_build( &ix, (unsigned char*)buf + h->cur, len - h->cur ) ){
+        return parse_state( h, buf, len, maxurilen, maxhdrlen, isreq );
+    }
+    else if( index_walk( h, buf, &ix, maxhdrlen ) == HTTP_SUCCESS ){
+        return HTTP_SUCCESS;
+    }
+    // parse again to report the error
+    http_init( h );
+
+    return parse_state( h, buf, len, maxurilen, maxhdrlen, isreq );
+}
+
+
+/**
+ * HTTP_ENGINE_DFA
+ *
+ * the bytes are mapped to the classes by CLASS_TBL and the head is parsed by
+ * the transitions of DFA_TBL. the tokens are handled on the transitions to
+ * the action states. both tables are generated from the character tables
+ * above at load time, so the engine accepts the same bytes.
+ * the self-loop of each state is skipped by the STAY_TBL bitmap of the
+ * classes without the dependency on the state, and the states that loop on
+ * the field-content (D_HVAL and D_REASON) skip by vchar_scan that accepts the
+ * same bytes.
+ */
+
+// class bits: field-vchar, uri character and tchar
+#define C_VCHAR     0x1
+#define C_URI       0x2
+#define C_TCHAR     0x4
+// delimiters are not the combination of the class bits
+#define C_SP        0x8
+#define C_HT        0x9
+#define C_CR        0xA
+#define C_LF        0xB
+#define C_COLON     0xC
+#define C_NCLASS    16
+
+enum {
+    // request-line
+    D_METHOD = 0,
+    D_URI,
+    D_VERSION,
+    // status-line
+    D_VERSION_RES,
+    D_STATUS,
+    D_REASON,
+    D_REASON_CR,
+    // headers
+    D_HEADER,
+    D_HEADER_CR,
+    D_HKEY,
+    D_HVAL,
+    D_HVAL_CR,
+    D_NSTATE,
+
+    // actions
+    D_ERROR = D_NSTATE,
+    D_METHOD_END,
+    D_URI_END,
+    D_VERSION_END,
+    D_VERSION_RES_END,
+    D_STATUS_END,
+    D_REASON_END,
+    D_HKEY_END,
+    D_HVAL_END,
+    D_DONE
+};
+
+static uint8_t CLASS_TBL[256];
+static uint8_t DFA_TBL[D_NSTATE][C_NCLASS];
+static uint16_t STAY_TBL[D_NSTATE];
+
+
+static void dfa_set( uint8_t state, unsigned mask, uint8_t next )
+{
+    int c = 0;
+
+    for(; c < C_NCLASS; c++ )
+    {
+        if( c < C_SP && ( c & mask ) == mask && c ){
+            DFA_TBL[state][c] = next;
+        }
+    }
+}
+
+
+// built before the engine selection at the load
+__attribute__((constructor(101)))
+static void dfa_build( void )
+{
+    int c = 0;
+
+    for(; c < 256; c++ )
+    {
+        switch( c ){
+            case SP:
+                CLASS_TBL[c] = C_SP;
+            break;
+            case HT:
+                CLASS_TBL[c] = C_HT;
+            break;
+            case CR:
+                CLASS_TBL[c] = C_CR;
+            break;
+            case LF:
+                CLASS_TBL[c] = C_LF;
+            break;
+            case COLON:
+                CLASS_TBL[c] = C_COLON;
+            break;
+            default:
+                CLASS_TBL[c] = ( VCHAR[c] == 1 ? C_VCHAR : 0 ) |
+                               ( URIC_TBL[c] ? C_URI : 0 ) |
+                               ( HKEYC_TBL[c] > 2 ? C_TCHAR : 0 );
+        }
+    }
+
+    memset( (void*)DFA_TBL, D_ERROR, sizeof( DFA_TBL ) );
+
+    // the tokens of the start-line are checked by the actions
+    dfa_set( D_METHOD, C_VCHAR, D_METHOD );
+    DFA_TBL[D_METHOD][C_COLON] = D_METHOD;
+    DFA_TBL[D_METHOD][C_SP] = D_METHOD_END;
+
+    dfa_set( D_URI, C_URI, D_URI );
+    DFA_TBL[D_URI][C_COLON] = D_URI;
+    DFA_TBL[D_URI][C_SP] = D_URI_END;
+
+    dfa_set( D_VERSION, C_VCHAR, D_VERSION );
+    DFA_TBL[D_VERSION][C_COLON] = D_VERSION;
+    DFA_TBL[D_VERSION][C_CR] = D_VERSION;
+    DFA_TBL[D_VERSION][C_LF] = D_VERSION_END;
+
+    dfa_set( D_VERSION_RES, C_VCHAR, D_VERSION_RES );
+    DFA_TBL[D_VERSION_RES][C_COLON] = D_VERSION_RES;
+    DFA_TBL[D_VERSION_RES][C_SP] = D_VERSION_RES_END;
+
+    dfa_set( D_STATUS, C_VCHAR, D_STATUS );
+    DFA_TBL[D_STATUS][C_COLON] = D_STATUS;
+    DFA_TBL[D_STATUS][C_SP] = D_STATUS_END;
+
+    dfa_set( D_REASON, C_VCHAR, D_REASON );
+    DFA_TBL[D_REASON][C_COLON] = D_REASON;
+    DFA_TBL[D_REASON][C_SP] = D_REASON;
+    DFA_TBL[D_REASON][C_HT] = D_REASON;
+    DFA_TBL[D_REASON][C_CR] = D_REASON_CR;
+    DFA_TBL[D_REASON][C_LF] = D_REASON_END;
+    DFA_TBL[D_REASON_CR][C_LF] = D_REASON_END;
+
+    // header-field = field-name ":" OWS field-value OWS
+    dfa_set( D_HEADER, C_TCHAR, D_HKEY );
+    DFA_TBL[D_HEADER][C_COLON] = D_HKEY_END;
+    DFA_TBL[D_HEADER][C_CR] = D_HEADER_CR;
+    DFA_TBL[D_HEADER][C_LF] = D_DONE;
+    DFA_TBL[D_HEADER_CR][C_LF] = D_DONE;
+
+    dfa_set( D_HKEY, C_TCHAR, D_HKEY );
+    DFA_TBL[D_HKEY][C_COLON] = D_HKEY_END;
+
+    dfa_set( D_HVAL, C_VCHAR, D_HVAL );
+    DFA_TBL[D_HVAL][C_COLON] = D_HVAL;
+    DFA_TBL[D_HVAL][C_SP] = D_HVAL;
+    DFA_TBL[D_HVAL][C_HT] = D_HVAL;
+    DFA_TBL[D_HVAL][C_CR] = D_HVAL_CR;
+    DFA_TBL[D_HVAL][C_LF] = D_HVAL_END;
+    DFA_TBL[D_HVAL_CR][C_LF] = D_HVAL_END;
+
+    // classes of the self-loop
+    for( c = 0; c < D_NSTATE * C_NCLASS; c++ )
+    {
+        if( DFA_TBL[c / C_NCLASS][c % C_NCLASS] == c / C_NCLASS ){
+            STAY_TBL[c / C_NCLASS] |= (uint16_t)( 1 << ( c % C_NCLASS ) );
+        }
+    }
+}
+
+
+/**
+ * parse the complete head from the start. the null-terminator is an error in
+ * every state, so the end of buffer is not checked.
+ * return HTTP_ERROR on any error, the state machine reports the error.
+ */
+static int dfa_run( http_t *h, char *buf, size_t len, uint16_t maxurilen,
+                    uint16_t maxhdrlen, int isreq )
+{
+    unsigned char *delim = (unsigned char*)buf;
+    size_t cur = 0;
+    size_t head = 0;
+    size_t colon = 0;
+    size_t val = 0;
+    size_t tail = 0;
+    uint8_t s = isreq ? D_METHOD : D_VERSION_RES;
+    match64bit_u src = { .bit = 0 };
+    const int mutate = !( h->opts & HTTP_OPT_NOMUTATE );
+
+    for(;; cur++ )
+    {
+        s = DFA_TBL[s][CLASS_TBL[delim[cur]]];
+        if( s < D_NSTATE )
+        {
+            if( s == D_HVAL || s == D_REASON ){
+                cur = vchar_scan( delim, cur + 1, len ) - 1;
+            }
+            else {
+                while( ( STAY_TBL[s] >> CLASS_TBL[delim[cur + 1]] ) & 1 ){
+                    cur++;
+                }
+            }
+            continue;
+        }
+
+        switch( s )
+        {
+            case D_METHOD_END:
+                if( !( h->protocol = method_code( buf, cur ) ) ){
+                    return HTTP_ERROR;
+                }
+                head = cur + 1;
+                s = D_URI;
+            break;
+
+            case D_URI_END:
+                h->msg = (uint8_t)head;
+                h->msglen = (uint16_t)( cur - head );
+                if( h->msglen > maxurilen ){
+                    return HTTP_ERROR;
+                }
+                head = cur + 1;
+                s = D_VERSION;
+            break;
+
+            case D_VERSION_END:
+                tail = delim[cur - 1] == CR ? cur - 1 : cur;
+                if( tail - head != VER_LEN ){
+                    return HTTP_ERROR;
+                }
+                src.bit = *((uint64_t*)( buf + head ));
+                if( src.bit == V_11.bit ){
+                    h->protocol |= HTTP_V11;
+                }
+                else if( src.bit == V_10.bit && h->protocol <= HTTP_MPOST ){
+                    h->protocol |= HTTP_V10;
+                }
+                // HTTP/0.9 and the others
+                else {
+                    return HTTP_ERROR;
+                }
+                head = cur + 1;
+                s = D_HEADER;
+            break;
+
+            case D_VERSION_RES_END:
+                // HTTP/0.9 simple-response
+                if( cur != VER_LEN ){
+                    return HTTP_ERROR;
+                }
+                src.bit = *((uint64_t*)buf);
+                if( src.bit == V_11.bit ){
+                    h->protocol = HTTP_V11;
+                }
+                else if( src.bit == V_10.bit ){
+                    h->protocol = HTTP_V10;
+                }
+                else if( src.bit == V_09.bit ){
+                    h->protocol = HTTP_V09;
+                }
+                else {
+                    return HTTP_ERROR;
+                }
+                head = cur + 1;
+                s = D_STATUS;
+            break;
+
+            case D_STATUS_END:
+                if( cur - head != STATUS_LEN ||
+                    delim[head] < '1' || delim[head] > '5' ||
+                    delim[head + 1] < '0' || delim[head + 1] > '9' ||
+                    delim[head + 2] < '0' || delim[head + 2] > '9' ){
+                    return HTTP_ERROR;
+                }
+                h->protocol |= ( delim[head] - 0x30 ) * 100 +
+                               ( delim[head + 1] - 0x30 ) * 10 +
+                               ( delim[head + 2] - 0x30 );
+                head = cur + 1;
+                s = D_REASON;
+            break;
+
+            case D_REASON_END:
+                // phrase-length includes CRLF
+                if( ( cur + 1 - head ) > UINT16_MAX ){
+                    return HTTP_ERROR;
+                }
+                h->msg = (uint8_t)head;
+                h->msglen = (uint16_t)( cur + 1 - head );
+                head = cur + 1;
+                s = D_HEADER;
+            break;
+
+            case D_HKEY_END:
+                // too many headers or header-length too large
+                if( h->nheader >= h->maxheader || cur - head > maxhdrlen ){
+                    return HTTP_ERROR;
+                }
+                // convert to lowercase
+                if( mutate ){
+                    for( val = head; val < cur; val++ ){
+                        delim[val] = TO_LOWER( delim[val] );
+                    }
+                }
+                colon = cur;
+                s = D_HVAL;
+            break;
+
+            case D_HVAL_END:
+                tail = delim[cur - 1] == CR ? cur - 1 : cur;
+                // remove OWS
+                for( val = colon + 1; val < tail && SPHT[delim[val]]; val++ ){}
+                while( tail > val && SPHT[delim[tail - 1]] ){
+                    tail--;
+                }
+                // ignore empty hval as well as parse_hkey
+                if( tail > val )
+                {
+                    // check length
+                    if( ( tail - head ) > maxhdrlen ){
+                        return HTTP_ERROR;
+                    }
+                    HTTP_PROBE_HEADER( h, head, val, tail - val );
+                    ADD_HKEY( h, head, colon - head );
+                    ADD_HVAL( h, val, tail - val );
+                    ADD_HHASH( h, mutate ? 0 :
+                               strcase_hash( delim + head, colon - head ) );
+                    h->nheader++;
+                    h->key = head;
+                    h->klen = (uint16_t)( colon - head );
+                }
+                head = cur + 1;
+                s = D_HEADER;
+            break;
+
+            case D_DONE:
+                h->head = h->cur = cur + 1;
+                HTTP_SET_PHASE( h, HTTP_PHASE_DONE );
+                return HTTP_SUCCESS;
+
+            // D_ERROR
+            default:
+                return HTTP_ERROR;
+        }
+    }
+}
+
+
+static int parse_dfa( http_t *h, char *buf, size_t len, uint16_t maxurilen,
+                      uint16_t maxhdrlen, int isreq )
+{
+    // the head is not complete or the mode is not supported
+    if( !ALT_SUPPORTED( h ) || !eoh_scan( (unsigned char*)buf, len ) ){
+        return parse_state( h, buf, len, maxurilen, maxhdrlen, isreq );
+    }
+    else if( dfa_run( h, buf, len, maxurilen, maxhdrlen,
+                      isreq ) == HTTP_SUCCESS ){
+        return HTTP_SUCCESS;
+    }
+    // parse again to report the error
+    http_init( h );
+
+    return parse_state( h, buf, len, maxurilen, maxhdrlen, isreq );
+}
+
+static inline int parse_engine( http_t *h, char *buf, size_t len,
+                                uint16_t maxurilen, uint16_t maxhdrlen,
+                                int isreq )
+{
+    switch( h->engine ){
+        case HTTP_ENGINE_INDEX:
+            return parse_index( h, buf, len, maxurilen, maxhdrlen, isreq );
+
+        case HTTP_ENGINE_DFA:
+            return parse_dfa( h, buf, len, maxurilen, maxhdrlen, isreq );
+
+        default:
+            return parse_state( h, buf, len, maxurilen, maxhdrlen, isreq );
+    }
+}
+
+
+/**
+ * engine selection
+ *
+ * http_alloc sets DEFAULT_ENGINE to the allocated http_t. http_autotune
+ * parses the built-in corpus by each engine and selects the fastest one, or
+ * the engine named by the environment variable HTTP_ENGINE.
+ */
+static const char *ENGINE_NAMES[HTTP_NENGINE] = {
+    "state", "index", "dfa"
+};
+
+static uint8_t DEFAULT_ENGINE = HTTP_ENGINE_STATE;
+static http_tune_t TUNE = {
+    .engine = HTTP_ENGINE_STATE,
+    .source = HTTP_TUNE_NONE
+};
+
+// short heads of the typical sizes
+static const char *TUNE_REQS[] = {
+    "GET / HTTP/1.1\r\n"
+    "Host: example.com\r\n"
+    "\r\n",
+    "GET /search?q=libhttp&ie=UTF-8 HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:42.0) Gecko/20100101 "
+    "Firefox/42.0\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Cookie: sid=31d4d96e407aad42; lang=en-US; theme=dark\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n",
+    NULL
+};
+
+static const char *TUNE_RESS[] = {
+    "HTTP/1.1 200 OK\r\n"
+    "Server: nginx\r\n"
+    "Date: Wed, 21 Oct 2015 07:28:00 GMT\r\n"
+    "Content-Type: text/html; charset=utf-8\r\n"
+    "Content-Length: 1024\r\n"
+    "Cache-Control: max-age=3600\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n",
+    NULL
+};
+
+// best of the rounds of the iterations
+#define TUNE_NROUND 5
+#define TUNE_NITER  64
+// the alternate engines must be faster than the state machine by 1/16
+#define TUNE_MARGIN 4
+
+static inline uint64_t tune_clock( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+
+/**
+ * return the best ns per iteration of the head, or UINT64_MAX on failure
+ */
+static uint64_t tune_head( http_t *h, const char *head, int isreq )
+{
+    char buf[512];
+    size_t len = strlen( head );
+    uint64_t best = UINT64_MAX;
+    uint64_t t = 0;
+    int round = 0;
+    int i = 0;
+
+    memcpy( buf, head, len + 1 );
+    for(; round < TUNE_NROUND; round++ )
+    {
+        t = tune_clock();
+        for( i = 0; i < TUNE_NITER; i++ )
+        {
+            http_init( h );
+            if( parse_engine( h, buf, len, UINT16_MAX, UINT16_MAX,
+                              isreq ) != HTTP_SUCCESS ){
+                return UINT64_MAX;
+            }
+        }
+        t = tune_clock() - t;
+        if( t < best ){
+            best = t;
+        }
+    }
+
+    return best / TUNE_NITER;
+}
+
+
+static uint64_t tune_engine( http_t *h, int engine )
+{
+    const char **heads[2] = { TUNE_REQS, TUNE_RESS };
+    uint64_t ns = 0;
+    uint64_t t = 0;
+    int i = 0;
+    int j = 0;
+
+    http_setengine( h, engine );
+    for(; i < 2; i++ )
+    {
+        for( j = 0; heads[i][j]; j++ )
+        {
+            if( ( t = tune_head( h, heads[i][j], !i ) ) == UINT64_MAX ){
+                return UINT64_MAX;
+            }
+            ns += t;
+        }
+    }
+
+    // 0 means not measured
+    return ns ? ns : 1;
+}
+
+
+const char *http_engine_name( int engine )
+{
+    if( engine >= 0 && engine < HTTP_NENGINE ){
+        return ENGINE_NAMES[engine];
+    }
+
+    return NULL;
+}
+
+
+int http_engine_lookup( const char *name )
+{
+    int engine = 0;
+
+    for(; engine < HTTP_NENGINE; engine++ )
+    {
+        if( strcmp( ENGINE_NAMES[engine], name ) == 0 ){
+            return engine;
+        }
+    }
+
+    return -1;
+}
+
+
+int http_autotune( http_tune_t *t )
+{
+    http_tune_t tune = {
+        .engine = HTTP_ENGINE_STATE,
+        .source = HTTP_TUNE_BENCH
+    };
+    const char *env = getenv( "HTTP_ENGINE" );
+    int engine = env ? http_engine_lookup( env ) : -1;
+    uint64_t ns = 0;
+    http_t *h = NULL;
+
+    if( engine != -1 ){
+        tune.engine = (uint8_t)engine;
+        tune.source = HTTP_TUNE_ENV;
+    }
+    else if( !( h = http_alloc( 32 ) ) ){
+        return -1;
+    }
+    else
+    {
+        for( engine = 0; engine < HTTP_NENGINE; engine++ ){
+            tune.ns[engine] = tune_engine( h, engine );
+        }
+        http_free( h );
+
+        ns = tune.ns[HTTP_ENGINE_STATE];
+        for( engine = HTTP_ENGINE_STATE + 1; engine < HTTP_NENGINE; engine++ )
+        {
+            if( tune.ns[engine] < ns &&
+                tune.ns[engine] < tune.ns[HTTP_ENGINE_STATE] -
+                                  ( tune.ns[HTTP_ENGINE_STATE] >> TUNE_MARGIN ) ){
+                tune.engine = (uint8_t)engine;
+                ns = tune.ns[engine];
+            }
+        }
+    }
+
+    TUNE = tune;
+    __atomic_store_n( &DEFAULT_ENGINE, tune.engine, __ATOMIC_RELAXED );
+    if( t ){
+        *t = tune;
+    }
+
+    return tune.engine;
+}
+
+
+int http_gettune( http_tune_t *t )
+{
+    if( t ){
+        *t = TUNE;
+    }
+
+    return __atomic_load_n( &DEFAULT_ENGINE, __ATOMIC_RELAXED );
+}
+
+
+// HTTP_ENGINE selects the engine, or runs http_autotune at the load if auto
+__attribute__((constructor(102)))
+static void tune_init( void )
+{
+    const char *env = getenv( "HTTP_ENGINE" );
+
+    if( env && ( strcmp( env, "auto" ) == 0 ||
+                 http_engine_lookup( env ) != -1 ) ){
+        http_autotune( NULL );
+    }
+}
+
+
+#ifdef HTTP_STATS
+
+// counter block owned by the calling thread
+static __thread http_stats_t *BLOCK = NULL;
+// counter block of the calling thread while it is attached
+static __thread http_stats_t *STATS = NULL;
+// all attached counter blocks
+static http_stats_t *STATS_LIST = NULL;
+
+// the block is written only by the owner thread, so a relaxed load and store
+// are enough and do not need a locked instruction
+#define STATS_ADD(f,n) \
+    __atomic_store_n( &(f), __atomic_load_n( &(f), __ATOMIC_RELAXED ) + (n), \
+                      __ATOMIC_RELAXED )
+
+
+static void stats_update( http_stats_t *s, http_t *h, uint8_t phase,
+                          uintptr_t cur, size_t len, int rc )
+{
+    STATS_ADD( s->calls, 1 );
+    if( phase != HTTP_PHASE_METHOD ){
+        STATS_ADD( s->resumes, 1 );
+    }
+    if( len > cur ){
+        STATS_ADD( s->bytes, len - cur );
+    }
+    if( h->cur > cur ){
+        STATS_ADD( s->consumed, h->cur - cur );
+    }
+    // bytes that will be presented again by the next call
+    if( rc == HTTP_EAGAIN && len > h->cur ){
+        STATS_ADD( s->rescanned, len - h->cur );
+    }
+    if( h->phase <= HTTP_PHASE_DONE ){
+        STATS_ADD( s->exits[h->phase], 1 );
+    }
+    if( rc <= 0 && -rc < HTTP_NRESULT ){
+        STATS_ADD( s->results[-rc], 1 );
+    }
+}
+
+#endif
+
+
+http_stats_t *http_stats_attach( void )
+{
+#ifdef HTTP_STATS
+    if( !BLOCK )
+    {
+        void *mem = NULL;
+        http_stats_t *s = NULL;
+
+        if( ( errno = posix_memalign( &mem, HTTP_STATS_ALIGN,
+                                      sizeof( http_stats_t ) ) ) ){
+            return NULL;
+        }
+        s = (http_stats_t*)memset( mem, 0, sizeof( http_stats_t ) );
+        // push to the list
+        s->next = __atomic_load_n( &STATS_LIST, __ATOMIC_RELAXED );
+        while( !__atomic_compare_exchange_n( &STATS_LIST, &s->next, s, 1,
+                                             __ATOMIC_RELEASE,
+                                             __ATOMIC_RELAXED ) ){}
+        BLOCK = s;
+    }
+    STATS = BLOCK;
+
+    return STATS;
+#else
+    errno = ENOTSUP;
+    return NULL;
+#endif
+}
+
+
+void http_stats_detach( void )
+{
+#ifdef HTTP_STATS
+    STATS = NULL;
+#endif
+}
+
+
+int http_stats_aggregate( http_stats_t *out )
+{
+    memset( (void*)out, 0, sizeof( http_stats_t ) );
+#ifdef HTTP_STATS
+    {
+        http_stats_t *s = __atomic_load_n( &STATS_LIST, __ATOMIC_ACQUIRE );
+        int nblock = 0;
+        int i = 0;
+
+#define STATS_SUM(f) \
+    out->f += __atomic_load_n( &s->f, __ATOMIC_RELAXED )
+
+        for(; s; s = s->next, nblock++ )
+        {
+            STATS_SUM( calls );
+            STATS_SUM( resumes );
+            STATS_SUM( bytes );
+            STATS_SUM( consumed );
+            STATS_SUM( rescanned );
+            for( i = 0; i <= HTTP_PHASE_DONE; i++ ){
+                STATS_SUM( exits[i] );
+            }
+            for( i = 0; i < HTTP_NRESULT; i++ ){
+                STATS_SUM( results[i] );
+            }
+        }
+
+#undef STATS_SUM
+
+        return nblock;
+    }
+#else
+    errno = ENOTSUP;
     return -1;
+#endif
+}
+
+
+static inline int headers_complete( http_t *h )
+{
+    if( h->cb->on_headers_complete &&
+        h->cb->on_headers_complete( h, h->udata ) ){
+        return HTTP_ECALLBACK;
+    }
+
+    return HTTP_SUCCESS;
+}
+
+
+int http_parse_request( http_t *h, char *buf, size_t len, uint16_t maxurilen,
+                        uint16_t maxhdrlen )
+{
+    uint8_t phase = h->phase;
+    int rc = 0;
+#ifdef HTTP_STATS
+    http_stats_t *s = STATS;
+    uintptr_t cur = h->cur;
+#endif
+
+    HTTP_PROBE_START( h, len );
+    rc = parse_engine( h, buf, len, maxurilen, maxhdrlen, 1 );
+    if( rc == HTTP_SUCCESS && h->cb && phase != HTTP_PHASE_DONE &&
+        h->phase == HTTP_PHASE_DONE ){
+        rc = headers_complete( h );
+    }
+    HTTP_PROBE_EXIT( h, rc, len );
+#ifdef HTTP_STATS
+    if( s ){
+        stats_update( s, h, phase, cur, len, rc );
+    }
+#endif
+
+    return rc;
+}
+
+
+int http_parse_response( http_t *h, char *buf, size_t len, uint16_t maxhdrlen )
+{
+    uint8_t phase = h->phase;
+    int rc = 0;
+#ifdef HTTP_STATS
+    http_stats_t *s = STATS;
+    uintptr_t cur = h->cur;
+#endif
+
+    HTTP_PROBE_START( h, len );
+    rc = parse_engine( h, buf, len, 0, maxhdrlen, 0 );
+    if( rc == HTTP_SUCCESS && h->cb && phase != HTTP_PHASE_DONE &&
+        h->phase == HTTP_PHASE_DONE ){
+        rc = headers_complete( h );
+    }
+    HTTP_PROBE_EXIT( h, rc, len );
+#ifdef HTTP_STATS
+    if( s ){
+        stats_update( s, h, phase, cur, len, rc );
+    }
+#endif
+
+    return rc;
+}
+
+
+int http_parse_request_fast( http_t *h, char *buf, size_t len,
+                             uint16_t maxurilen, uint16_t maxhdrlen )
+{
+    uint8_t phase = h->phase;
+    int rc = 0;
+#ifdef HTTP_STATS
+    http_stats_t *s = STATS;
+    uintptr_t cur = h->cur;
+#endif
+
+    HTTP_PROBE_START( h, len );
+    rc = parse_head_fast( h, buf, len, maxurilen, maxhdrlen, 1 );
+    if( rc == HTTP_SUCCESS && h->cb && phase != HTTP_PHASE_DONE &&
+        h->phase == HTTP_PHASE_DONE ){
+        rc = headers_complete( h );
+    }
+    HTTP_PROBE_EXIT( h, rc, len );
+#ifdef HTTP_STATS
+    if( s ){
+        stats_update( s, h, phase, cur, len, rc );
+    }
+#endif
+
+    return rc;
+}
+
+
+int http_parse_response_fast( http_t *h, char *buf, size_t len,
+                              uint16_t maxhdrlen )
+{
+    uint8_t phase = h->phase;
+    int rc = 0;
+#ifdef HTTP_STATS
+    http_stats_t *s = STATS;
+    uintptr_t cur = h->cur;
+#endif
+
+    HTTP_PROBE_START( h, len );
+    rc = parse_head_fast( h, buf, len, 0, maxhdrlen, 0 );
+    if( rc == HTTP_SUCCESS && h->cb && phase != HTTP_PHASE_DONE &&
+        h->phase == HTTP_PHASE_DONE ){
+        rc = headers_complete( h );
+    }
+    HTTP_PROBE_EXIT( h, rc, len );
+#ifdef HTTP_STATS
+    if( s ){
+        stats_update( s, h, phase, cur, len, rc );
+    }
+#endif
+
+    return rc;
+}
+
+
+int http_filter_init( http_filter_t *f, const char *names[], size_t nname )
+{
+    size_t i = 0;
+    size_t j = 0;
+    size_t len = 0;
+    unsigned char c = 0;
+
+    if( nname > HTTP_FILTER_SIZE / 2 ){
+        errno = ENOSPC;
+        return -1;
+    }
+
+    memset( (void*)f, 0, sizeof( http_filter_t ) );
+    for(; i < nname; i++ )
+    {
+        len = strlen( names[i] );
+        if( !len || len > UINT16_MAX ){
+            errno = EINVAL;
+            return -1;
+        }
+        // lowercase token
+        for( j = 0; j < len; j++ )
+        {
+            c = (unsigned char)names[i][j];
+            if( HKEYC_TBL[c] != c ){
+                errno = EINVAL;
+                return -1;
+            }
+        }
+        // ignore duplicates
+        if( filter_lookup( f, names[i], len ) != -1 ){
+            continue;
+        }
+
+        for( j = FILTER_HASH( names[i], len ); f->tbl[j].id;
+             j = ( j + 1 ) & FILTER_MASK ){}
+        f->tbl[j].name = names[i];
+        f->tbl[j].len = (uint16_t)len;
+        f->tbl[j].id = (uint8_t)( i + 1 );
+        f->nname++;
+    }
+
+    return 0;
+}
+
+
+int http_filter_lookup( const http_filter_t *f, const char *key, size_t klen )
+{
+    return filter_lookup( f, key, klen );
+}
+
+
+http_t *http_alloc( uint8_t maxheader )
+{
+    http_t *h = (http_t*)calloc( 1, http_alloc_size( maxheader ) );
+
+    if( h ){
+        h->maxheader = maxheader;
+        h->engine = __atomic_load_n( &DEFAULT_ENGINE, __ATOMIC_RELAXED );
+    }
+
+    return h;
+}
+
+
+void http_free( http_t *h )
+{
+    free( (void*)h );
+}
+
+
+int http_snapshot( const http_t *h, const char *buf, void *dst, size_t size )
+{
+    http_t *s = (http_t*)dst;
+
+    if( h->phase != HTTP_PHASE_DONE ){
+        errno = EAGAIN;
+        return -1;
+    }
+    else if( size < http_snapshot_size( h ) ){
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    // http_t and the used slots, then the head bytes
+    memcpy( dst, (const void*)h, http_alloc_size( h->nheader ) );
+    s->maxheader = h->nheader;
+    s->cb = NULL;
+    s->udata = NULL;
+    s->filter = NULL;
+    memcpy( http_snapshot_buf( s ), buf, http_snapshot_headlen( h ) );
+    http_snapshot_buf( s )[http_snapshot_headlen( h )] = 0;
+
+    return 0;
+}
+
+
+http_t *http_snapshot_dup( const http_t *h, const char *buf )
+{
+    http_t *s = NULL;
+
+    if( h->phase != HTTP_PHASE_DONE ){
+        errno = EAGAIN;
+    }
+    else if( ( s = (http_t*)malloc( http_snapshot_size( h ) ) ) ){
+        http_snapshot( h, buf, (void*)s, http_snapshot_size( h ) );
+    }
+
+    return s;
+}
+
+
+int http_gethash_at( http_t *h, uint32_t *hash, uint8_t at )
+{
+    if( at < h->nheader ){
+        *hash = *(uint32_t*)GET_HHASH_PTR( h, at );
+        return 0;
+    }
+
+    return -1;
+}
+
+
+int http_findheader( http_t *h, const char *buf, const char *name,
+                     size_t len )
+{
+    const unsigned char *str = (const unsigned char*)name;
+    uint32_t hash = 0;
+    uint8_t *mem = NULL;
+    uint8_t i = 0;
+
+    if( h->opts & HTTP_OPT_LAZY )
+    {
+        uint16_t klen = 0;
+
+        for(; i < h->nheader; i++ )
+        {
+            mem = GET_HKEY_PTR( h, i );
+            klen = *(uint16_t*)&mem[sizeof( uintptr_t )];
+            // the line has not been split: "<name>:"
+            if( !*(uintptr_t*)&mem[HKEY_SIZE] ){
+                if( klen > len &&
+                    buf[*(uintptr_t*)mem + len] == COLON &&
+                    strcase_eq( (const unsigned char*)buf + *(uintptr_t*)mem,
+                                str, len ) ){
+                    return i;
+                }
+            }
+            else if( klen == len &&
+                     strcase_eq( (const unsigned char*)buf +
+                                 *(uintptr_t*)mem, str, len ) ){
+                return i;
+            }
+        }
+        return -1;
+    }
+    else if( h->opts & HTTP_OPT_NOMUTATE )
+    {
+        hash = strcase_hash( str, len );
+        for(; i < h->nheader; i++ )
+        {
+            mem = GET_HKEY_PTR( h, i );
+            if( *(uint32_t*)GET_HHASH_PTR( h, i ) == hash &&
+                *(uint16_t*)&mem[sizeof( uintptr_t )] == len &&
+                strcase_eq( (const unsigned char*)buf + *(uintptr_t*)mem, str,
+                            len ) ){
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    for(; i < h->nheader; i++ )
+    {
+        mem = GET_HKEY_PTR( h, i );
+        if( *(uint16_t*)&mem[sizeof( uintptr_t )] == len &&
+            strcase_eq( (const unsigned char*)buf + *(uintptr_t*)mem, str,
+                        len ) ){
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+uint32_t http_hash( const char *str, size_t len )
+{
+    return strcase_hash( (const unsigned char*)str, len );
+}
+
+
+int http_strcaseeq( const char *a, const char *b, size_t len )
+{
+    return strcase_eq( (const unsigned char*)a, (const unsigned char*)b, len );
+}
+
+
+int http_getheader_at( http_t *h, uintptr_t *key, uint16_t *klen,
+                       uintptr_t *val, uint16_t *vlen, uint8_t at )
+{
+    if( at < h->nheader ){
+        uint8_t *mem = GET_HKEY_PTR( h, at );
+
+        *key = *(uintptr_t*)mem;
+        *klen = *(uint16_t*)&mem[sizeof( uintptr_t )];
+
+        mem += HKEY_SIZE;
+        *val = *(uintptr_t*)mem;
+        *vlen = *(uint16_t*)&mem[sizeof( uintptr_t )];
+
+        return 0;
+    }
+
+    return -1;
+}
+
+
+int http_getheader_lazy( http_t *h, char *buf, uintptr_t *key, uint16_t *klen,
+                         uintptr_t *val, uint16_t *vlen, uint8_t at )
+{
+    if( at < h->nheader )
+    {
+        int rc = 0;
+
+        // split the line on first access
+        if( !*(uintptr_t*)GET_HVAL_PTR( h, at ) &&
+            ( rc = split_line( h, buf, at ) ) ){
+            return rc;
+        }
+        return http_getheader_at( h, key, klen, val, vlen, at );
+    }
+
+    return -1;
+}
+
+
+int http_finalize( http_t *h, char *buf )
+{
+    if( h->phase != HTTP_PHASE_DONE ){
+        return HTTP_EAGAIN;
+    }
+
+    return compact_lines( h, buf );
 }
 
 
@@ -29,6 +29,10 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 
 enum {
     HTTP_PHASE_METHOD = 0,
@@ -41,10 +45,14 @@ enum {
     HTTP_PHASE_HEADER,
     HTTP_PHASE_HKEY,
     HTTP_PHASE_HVAL,
+    HTTP_PHASE_HSKIP,
     HTTP_PHASE_DONE
 };
 
 
+struct http_cb_st;
+struct http_filter_st;
+
 typedef struct {
     /* read cursor */
     uintptr_t cur;
@@ -61,9 +69,195 @@ typedef struct {
     /* header */
     uint8_t nheader;
     uint8_t maxheader;
+    /* key of the header being parsed */
+    uint16_t klen;
+    /* HTTP_OPT_* flags */
+    uint8_t opts;
+    /* HTTP_ENGINE_* */
+    uint8_t engine;
+    uintptr_t key;
+    /* callbacks of the SAX mode */
+    const struct http_cb_st *cb;
+    void *udata;
+    /* allow-list of the header names */
+    const struct http_filter_st *filter;
 } http_t;
 
 
+/**
+ * parse options
+ */
+enum {
+    /* do not convert the header keys to lowercase in place, and record the
+     * case-insensitive hash of the keys (http_hash) into the slots instead.
+     * the buffer can be read-only. */
+    HTTP_OPT_NOMUTATE = 0x1,
+    /* record the header lines only, and split and validate each line on the
+     * first access by http_getheader_lazy. http_finalize validates all the
+     * lines and makes the slots the same as the default mode. the lines
+     * are split early only when the slots run out, so that the headers with
+     * an empty value are not counted in maxheader as well as the default
+     * mode. ignored in the SAX mode or if the filter is set. */
+    HTTP_OPT_LAZY = 0x2,
+    /* return HTTP_SUCCESS after the request-line or status-line with the
+     * phase HTTP_PHASE_HEADER. the next call resumes the header parse from
+     * h->cur regardless of this option. */
+    HTTP_OPT_REQLINE = 0x4
+};
+
+#define http_setopt(h,o) do{    \
+    (h)->opts = (uint8_t)(o);   \
+}while(0)
+
+
+/**
+ * parse engines
+ *
+ * every engine returns the same results as the state machine. the alternate
+ * engines parse the complete head of the first call, and hand the others
+ * (resume, incomplete head, errors, SAX mode, filter, HTTP_OPT_LAZY and
+ * HTTP_OPT_REQLINE) to the state machine.
+ */
+enum {
+    /* resumable state machine */
+    HTTP_ENGINE_STATE = 0,
+    /* two-stage parser: a bitmap of the structural and invalid bytes of the
+     * headers is built by SIMD, and the set bits are walked to fill the
+     * slots */
+    HTTP_ENGINE_INDEX,
+    /* table-driven DFA over a single byte-class table */
+    HTTP_ENGINE_DFA
+};
+
+#define http_setengine(h,e) do{     \
+    (h)->engine = (uint8_t)(e);     \
+}while(0)
+
+#define HTTP_NENGINE    3
+
+/**
+ * return the name of the engine, or NULL if unknown
+ */
+const char *http_engine_name( int engine );
+
+/**
+ * return the engine of the name, or -1 if unknown
+ */
+int http_engine_lookup( const char *name );
+
+
+/**
+ * engine selection of the process
+ *
+ * http_alloc sets the default engine of the process to the allocated http_t,
+ * and http_setengine overrides it (http_t allocated by the caller starts with
+ * HTTP_ENGINE_STATE). http_autotune selects the default engine: the engine
+ * named by the environment variable HTTP_ENGINE, otherwise the fastest engine
+ * on a short built-in corpus. call it at the startup before the threads are
+ * created. if HTTP_ENGINE is set to a name or "auto", it runs at the load of
+ * the library.
+ */
+enum {
+    /* not selected: HTTP_ENGINE_STATE */
+    HTTP_TUNE_NONE = 0,
+    /* named by HTTP_ENGINE */
+    HTTP_TUNE_ENV,
+    /* measured */
+    HTTP_TUNE_BENCH
+};
+
+typedef struct {
+    /* selected engine */
+    uint8_t engine;
+    /* HTTP_TUNE_* */
+    uint8_t source;
+    /* ns per pass of the built-in corpus by each engine (HTTP_TUNE_BENCH
+     * only), 0 if not measured and UINT64_MAX if failed */
+    uint64_t ns[HTTP_NENGINE];
+} http_tune_t;
+
+/**
+ * select the default engine and return it, or -1 on failure.
+ * the result is copied to t if not NULL.
+ */
+int http_autotune( http_tune_t *t );
+
+/**
+ * return the default engine and copy the last result of http_autotune to t
+ * if not NULL.
+ */
+int http_gettune( http_tune_t *t );
+
+
+/**
+ * SAX mode callbacks
+ *
+ * if the callbacks are set by http_setcb, the parser passes the tokens to
+ * the callbacks instead of storing the headers into the slots, so the number
+ * of headers is not limited by maxheader (nheader is not counted) and the
+ * http_t can be allocated by http_alloc(0).
+ * every callback is invoked once per message and may be NULL. a non-zero
+ * return value aborts the parse with HTTP_ECALLBACK.
+ */
+typedef struct http_cb_st {
+    /* method token of the request */
+    int (*on_method)( http_t *h, void *udata, const char *str, size_t len );
+    /* request-target of the request or reason-phrase of the response */
+    int (*on_target)( http_t *h, void *udata, const char *str, size_t len );
+    /* non-empty header. the key is converted to lowercase */
+    int (*on_header)( http_t *h, void *udata, const char *key, size_t klen,
+                      const char *val, size_t vlen );
+    /* end of the head */
+    int (*on_headers_complete)( http_t *h, void *udata );
+} http_cb_t;
+
+#define http_setcb(h,c,u) do{   \
+    (h)->cb = (c);              \
+    (h)->udata = (u);           \
+}while(0)
+
+
+/**
+ * allow-list of the header names
+ *
+ * if the filter is set by http_setfilter, the headers that are not in the
+ * filter are validated and skipped without taking a slot (or invoking
+ * on_header in the SAX mode), so maxheader only has to cover the filtered
+ * headers. the filter can be shared by any number of http_t.
+ */
+#define HTTP_FILTER_SIZE    64
+
+typedef struct http_filter_st {
+    /* open addressing table, id is the index of the name + 1 */
+    struct {
+        const char *name;
+        uint16_t len;
+        uint8_t id;
+    } tbl[HTTP_FILTER_SIZE];
+    uint8_t nname;
+} http_filter_t;
+
+#define http_setfilter(h,f) do{ \
+    (h)->filter = (f);          \
+}while(0)
+
+
+/**
+ * initialize the filter with the lowercase header names. the names are not
+ * copied, so they must outlive the filter. return -1 and set errno to
+ * EINVAL if a name is not a lowercase token, or to ENOSPC if there are more
+ * than HTTP_FILTER_SIZE / 2 names.
+ */
+int http_filter_init( http_filter_t *f, const char *names[], size_t nname );
+
+
+/**
+ * return the index of the name that matches the key, or -1 if not found
+ */
+int http_filter_lookup( const http_filter_t *f, const char *key,
+                        size_t klen );
+
+
 /**
  * current cursor
  */
@@ -187,13 +381,15 @@ enum {
 /**
  * per HTTP header
  *
- * (uintptr_t + uint16_t) * 2
+ * (uintptr_t + uint16_t) * 2 + uint32_t
  * uintptr_t key
  * uint16_t klen
  * uintptr_t val
  * uint16_t vlen
+ * uint32_t hash (HTTP_OPT_NOMUTATE only, 0 otherwise)
  */
-#define HTTP_HEADER_SIZE    ((sizeof(uintptr_t)+sizeof(uint16_t))<<1)
+#define HTTP_HEADER_SIZE \
+    (((sizeof(uintptr_t)+sizeof(uint16_t))<<1)+sizeof(uint32_t))
 
 /**
  * get the header key-value pair at specified index
@@ -201,10 +397,50 @@ enum {
 int http_getheader_at( http_t *r, uintptr_t *key, uint16_t *klen,
                        uintptr_t *val, uint16_t *vlen, uint8_t at );
 
+/**
+ * get the header key-value pair at specified index with HTTP_OPT_LAZY.
+ * the line is split and validated on the first access and the key is
+ * converted to lowercase unless HTTP_OPT_NOMUTATE is set.
+ * return 0 on success, -1 if not found or HTTP_EHDRFMT.
+ */
+int http_getheader_lazy( http_t *h, char *buf, uintptr_t *key, uint16_t *klen,
+                         uintptr_t *val, uint16_t *vlen, uint8_t at );
+
+/**
+ * split and validate all the lines recorded by HTTP_OPT_LAZY, and remove the
+ * headers that have an empty value. the indexes of the headers may change.
+ * return HTTP_SUCCESS, HTTP_EAGAIN if the parse is not done, or HTTP_EHDRFMT.
+ */
+int http_finalize( http_t *h, char *buf );
+
+/**
+ * get the hash of the header key at specified index
+ */
+int http_gethash_at( http_t *h, uint32_t *hash, uint8_t at );
+
+/**
+ * return the index of the first header that matches the name
+ * case-insensitively, or -1 if not found.
+ * the lines of HTTP_OPT_LAZY are matched without being split.
+ */
+int http_findheader( http_t *h, const char *buf, const char *name,
+                     size_t len );
+
+
+/**
+ * case-insensitive 32 bit FNV-1a hash of the header key
+ */
+uint32_t http_hash( const char *str, size_t len );
+
+/**
+ * return 1 if the ASCII strings are equal case-insensitively
+ */
+int http_strcaseeq( const char *a, const char *b, size_t len );
+
 
 
 /**
- * allocate http_t*
+ * allocate http_t* with the default engine
  */
 #define http_alloc_size( maxheader ) \
     (sizeof(http_t)+(HTTP_HEADER_SIZE*maxheader))
@@ -220,11 +456,18 @@ http_t *http_alloc( uint8_t maxheader );
         .cur = 0,                   \
         .head = 0,                  \
         .phase = 0,                 \
-        .protocol = 0,              \
         .msg = 0,                   \
         .msglen = 0,                \
+        .protocol = 0,              \
         .nheader = 0,               \
-        .maxheader = (h)->maxheader \
+        .maxheader = (h)->maxheader,\
+        .klen = 0,                  \
+        .opts = (h)->opts,          \
+        .engine = (h)->engine,      \
+        .key = 0,                   \
+        .cb = (h)->cb,              \
+        .udata = (h)->udata,        \
+        .filter = (h)->filter       \
     };                              \
 }while(0)
 
@@ -235,6 +478,43 @@ http_t *http_alloc( uint8_t maxheader );
 void http_free( http_t *h );
 
 
+/**
+ * relocatable snapshot of the parsed head
+ *
+ * a snapshot is a http_t with nheader slots (maxheader is set to nheader)
+ * followed by the head bytes and a null-terminator in one block. the head
+ * bytes are buf[0, h->cur), or up to the end of the request-target of the
+ * HTTP/0.9 request that does not advance h->cur over it. the slots hold
+ * the offsets from the head bytes, so the block can be copied or moved
+ * anywhere and passed to another thread, and it is read by the usual
+ * accessors with http_snapshot_buf(s) as buf. the callbacks, user data and
+ * filter are cleared.
+ */
+#define http_snapshot_headlen(h) \
+    ((h)->cur > (uintptr_t)(h)->msg+(h)->msglen ? \
+     (h)->cur : (uintptr_t)(h)->msg+(h)->msglen)
+
+#define http_snapshot_size(h) \
+    (http_alloc_size((h)->nheader)+http_snapshot_headlen(h)+1)
+
+#define http_snapshot_buf(s) \
+    ((char*)(s)+http_alloc_size((s)->maxheader))
+
+/**
+ * pack the head of h parsed from buf into dst of size bytes.
+ * dst must be aligned for http_t.
+ * return 0 on success, or -1 and set errno to EAGAIN if the parse is not
+ * done, or ENOBUFS if size is less than http_snapshot_size(h).
+ */
+int http_snapshot( const http_t *h, const char *buf, void *dst, size_t size );
+
+/**
+ * allocate and pack the snapshot, deallocate it by http_free.
+ * return NULL and set errno on failure.
+ */
+http_t *http_snapshot_dup( const http_t *h, const char *buf );
+
+
 /**
  * return code
  */
@@ -264,6 +544,11 @@ void http_free( http_t *h );
 #define HTTP_ESTATUS    -11
 /* invalid reason-phrase */
 #define HTTP_EREASON    -12
+/* aborted by the callback */
+#define HTTP_ECALLBACK  -13
+
+/* number of the return codes */
+#define HTTP_NRESULT    14
 
 
 /**
@@ -278,6 +563,70 @@ int http_parse_request( http_t *h, char *buf, size_t len, uint16_t maxurilen,
  */
 int http_parse_response( http_t *h, char *buf, size_t len, uint16_t maxhdrlen );
 
+
+/**
+ * same as http_parse_request and http_parse_response, but if the buffer
+ * contains the whole head, the headers are parsed without the end-of-buffer
+ * checks. otherwise, or on resume, it falls back to the resumable parser.
+ * the results are the same as http_parse_request and http_parse_response.
+ */
+int http_parse_request_fast( http_t *h, char *buf, size_t len,
+                             uint16_t maxurilen, uint16_t maxhdrlen );
+
+int http_parse_response_fast( http_t *h, char *buf, size_t len,
+                              uint16_t maxhdrlen );
+
+
+/**
+ * parser statistics
+ *
+ * the counters are updated by http_parse_request and http_parse_response
+ * of the threads that attached the counter block. it is available only when
+ * the library is built with --enable-stats (HTTP_STATS), otherwise the
+ * counting code is not compiled at all and the functions fail with ENOTSUP.
+ */
+#define HTTP_STATS_ALIGN    64
+
+typedef struct http_stats_st {
+    /* number of parse calls */
+    uint64_t calls;
+    /* calls that resumed the partially parsed head */
+    uint64_t resumes;
+    /* bytes presented to the parser after the cursor */
+    uint64_t bytes;
+    /* bytes that the cursor advanced */
+    uint64_t consumed;
+    /* bytes that will be scanned again after HTTP_EAGAIN */
+    uint64_t rescanned;
+    /* phase at the return of the calls */
+    uint64_t exits[HTTP_PHASE_DONE + 1];
+    /* return codes indexed by -rc */
+    uint64_t results[HTTP_NRESULT];
+    struct http_stats_st *next;
+} __attribute__((aligned(HTTP_STATS_ALIGN))) http_stats_t;
+
+
+/**
+ * attach the counter block to the calling thread and return it.
+ * the block is kept after the thread exit to be aggregated.
+ */
+http_stats_t *http_stats_attach( void );
+
+/**
+ * stop counting on the calling thread
+ */
+void http_stats_detach( void );
+
+/**
+ * sum up the counter blocks of all threads into out and return the number of
+ * the blocks
+ */
+int http_stats_aggregate( http_stats_t *out );
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
 
 
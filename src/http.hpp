@@ -0,0 +1,851 @@
+/*
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ *  IN THE SOFTWARE.
+ *
+ *  http.hpp
+ */
+
+#ifndef HTTP_HPP
+#define HTTP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include "http.h"
+
+/**
+ * header-only C++17 version of the parser in http.c.
+ *
+ * the state machine is the same as the C implementation, but the request or
+ * response mode, the character tables, the number of header slots and the
+ * length limits are resolved at compile-time by the policy, so the whole
+ * parse can be inlined into the caller. return codes and phases are the
+ * HTTP_* constants of http.h.
+ *
+ * the buffer contract is the same as http_parse_request: buf[len] must be a
+ * NUL-terminator and the header keys are converted to lowercase in place.
+ */
+namespace http {
+
+
+/**
+ * parse policy
+ *
+ *  Request:    parse the request-line if true, the status-line if false
+ *  Strict:     same character classes as http.c if true. lenient accepts
+ *              the characters that browsers leave unescaped in the
+ *              request-target (" < > \ ^ ` { | }) and obs-text (%x80-FF)
+ *              in the request-target, field-value and reason-phrase.
+ *  MaxHeader:  number of the header slots
+ *  Offset:     unsigned integer type of the offsets in the header slots.
+ *              the buffer length must be in its range.
+ *  MaxURILen:  maximum length of the request-target
+ *  MaxHdrLen:  maximum length of a header line
+ */
+template<bool Request, bool Strict = true, uint8_t MaxHeader = UINT8_MAX,
+         typename Offset = uint32_t, uint16_t MaxURILen = UINT16_MAX,
+         uint16_t MaxHdrLen = UINT16_MAX>
+struct policy {
+    static_assert( std::is_unsigned<Offset>::value && sizeof( Offset ) >= 2,
+                   "Offset must be an unsigned integer of 16 bits or more" );
+
+    using offset_type = Offset;
+    static constexpr bool request = Request;
+    static constexpr bool strict = Strict;
+    static constexpr uint8_t maxheader = MaxHeader;
+    static constexpr uint16_t maxurilen = MaxURILen;
+    static constexpr uint16_t maxhdrlen = MaxHdrLen;
+};
+
+template<bool Strict = true, uint8_t MaxHeader = UINT8_MAX,
+         typename Offset = uint32_t, uint16_t MaxURILen = UINT16_MAX,
+         uint16_t MaxHdrLen = UINT16_MAX>
+using request_policy = policy<true, Strict, MaxHeader, Offset, MaxURILen,
+                              MaxHdrLen>;
+
+template<bool Strict = true, uint8_t MaxHeader = UINT8_MAX,
+         typename Offset = uint32_t, uint16_t MaxHdrLen = UINT16_MAX>
+using response_policy = policy<false, Strict, MaxHeader, Offset, UINT16_MAX,
+                               MaxHdrLen>;
+
+
+namespace detail {
+
+struct table_t {
+    unsigned char v[256];
+
+    constexpr unsigned char operator[]( unsigned char c ) const {
+        return v[c];
+    }
+};
+
+
+constexpr bool in( const char *set, int c )
+{
+    for(; *set; set++ ){
+        if( (unsigned char)*set == c ){
+            return true;
+        }
+    }
+    return false;
+}
+
+
+constexpr bool isalnum( int c )
+{
+    return ( c >= '0' && c <= '9' ) || ( c >= 'A' && c <= 'Z' ) ||
+           ( c >= 'a' && c <= 'z' );
+}
+
+
+/**
+ * RFC 3986: unreserved, sub-delims and gen-delims except "#".
+ * a non-zero value is the character itself. see URIC_TBL of http.c
+ */
+constexpr table_t uric_table( bool strict )
+{
+    table_t t{};
+
+    for( int c = 0; c < 256; c++ )
+    {
+        if( isalnum( c ) || in( "!$%&'()*+,-./:;=?@[]_~", c ) ||
+            ( !strict && ( in( "\"<>\\^`{|}", c ) || c > 0x7F ) ) ){
+            t.v[c] = (unsigned char)c;
+        }
+    }
+    return t;
+}
+
+
+/**
+ * RFC 7230: tchar converted to lowercase, 2 = COLON.
+ * see HKEYC_TBL of http.c
+ */
+constexpr table_t hkeyc_table()
+{
+    table_t t{};
+
+    for( int c = 0; c < 256; c++ )
+    {
+        if( c >= 'A' && c <= 'Z' ){
+            t.v[c] = (unsigned char)( c + 0x20 );
+        }
+        else if( isalnum( c ) || in( "!#$%&'*+-.^_`|~", c ) ){
+            t.v[c] = (unsigned char)c;
+        }
+    }
+    t.v[(unsigned char)':'] = 2;
+    return t;
+}
+
+
+/**
+ * RFC 7230: 1 = field-content, 2 = LF or CR, 0 = invalid.
+ * see VCHAR of http.c
+ */
+constexpr table_t vchar_table( bool strict )
+{
+    table_t t{};
+
+    for( int c = 0; c < 256; c++ )
+    {
+        if( c == '\t' || ( c >= 0x20 && c <= 0x7E ) ||
+            ( !strict && c > 0x7F ) ){
+            t.v[c] = 1;
+        }
+    }
+    t.v[(unsigned char)'\r'] = 2;
+    t.v[(unsigned char)'\n'] = 2;
+    return t;
+}
+
+
+constexpr table_t spht_table()
+{
+    table_t t{};
+
+    t.v[(unsigned char)' '] = 1;
+    t.v[(unsigned char)'\t'] = 1;
+    return t;
+}
+
+
+template<bool Strict>
+struct tables {
+    static constexpr table_t uric = uric_table( Strict );
+    static constexpr table_t hkeyc = hkeyc_table();
+    static constexpr table_t vchar = vchar_table( Strict );
+    static constexpr table_t spht = spht_table();
+};
+
+
+constexpr char CR = '\r';
+constexpr char LF = '\n';
+constexpr char SP = ' ';
+// method length
+constexpr size_t METHOD_LEN = 7;
+// version length: HTTP/x.x
+constexpr size_t VER_LEN = 8;
+// status length
+constexpr size_t STATUS_LEN = 3;
+
+} // namespace detail
+
+
+template<class Policy>
+struct parser {
+    using policy_type = Policy;
+    using offset_type = typename Policy::offset_type;
+
+    struct field {
+        offset_type key;
+        offset_type klen;
+        offset_type val;
+        offset_type vlen;
+    };
+
+    /* read cursor */
+    offset_type cur = 0;
+    /* token head position */
+    offset_type head = 0;
+    /* uri or message */
+    offset_type msg = 0;
+    uint16_t msglen = 0;
+    /* http version | method or status */
+    uint16_t protocol = 0;
+    /* parse phase */
+    uint8_t phase = 0;
+    uint8_t nheader = 0;
+    field headers[Policy::maxheader > 0 ? Policy::maxheader : 1];
+
+
+    /**
+     * initialize data members to parse the next message
+     */
+    void init() noexcept
+    {
+        cur = head = msg = 0;
+        msglen = protocol = 0;
+        phase = nheader = 0;
+    }
+
+    uint16_t version() const noexcept {
+        return protocol & 0xF000;
+    }
+
+    uint16_t method() const noexcept {
+        return protocol & 0xFFF;
+    }
+
+    uint16_t status() const noexcept {
+        return protocol & 0xFFF;
+    }
+
+
+    /**
+     * parse the http 0.9/1.0/1.1 request or response
+     */
+    int parse( char *buf, size_t len ) noexcept
+    {
+        if constexpr( sizeof( offset_type ) < sizeof( size_t ) ){
+            if( len > std::numeric_limits<offset_type>::max() ){
+                return HTTP_EHDRLEN;
+            }
+        }
+
+        if constexpr( Policy::request )
+        {
+            switch( phase )
+            {
+                case HTTP_PHASE_METHOD:
+                    return parse_method( buf, len );
+                case HTTP_PHASE_URI:
+                    return parse_uri( buf, len );
+                case HTTP_PHASE_VERSION:
+                    return parse_ver( buf, len );
+                case HTTP_PHASE_EOL:
+                    return parse_eol( buf );
+                case HTTP_PHASE_HEADER:
+                    return parse_header( buf, len );
+                case HTTP_PHASE_HKEY:
+                    return parse_hkey( buf, len );
+                case HTTP_PHASE_HVAL:
+                    return parse_hval( buf, len );
+                case HTTP_PHASE_DONE:
+                    return HTTP_SUCCESS;
+            }
+        }
+        else
+        {
+            switch( phase )
+            {
+                case HTTP_PHASE_VERSION_RES:
+                    return parse_ver_res( buf, len );
+                case HTTP_PHASE_STATUS:
+                    return parse_status( buf, len );
+                case HTTP_PHASE_REASON:
+                    return parse_reason( buf, len );
+                case HTTP_PHASE_EOL:
+                    return parse_eol( buf );
+                case HTTP_PHASE_HEADER:
+                    return parse_header( buf, len );
+                case HTTP_PHASE_HKEY:
+                    return parse_hkey( buf, len );
+                case HTTP_PHASE_HVAL:
+                    return parse_hval( buf, len );
+                case HTTP_PHASE_DONE:
+                    return HTTP_SUCCESS;
+            }
+        }
+
+        return HTTP_ERROR;
+    }
+
+
+private:
+    using tbl = detail::tables<Policy::strict>;
+
+
+    static bool match( const char *s, const char (&lit)[9] ) noexcept {
+        return std::memcmp( s, lit, detail::VER_LEN ) == 0;
+    }
+
+
+    int parse_eol( char *buf ) noexcept
+    {
+        const char *str = buf + cur;
+
+        switch( *str )
+        {
+            // need more bytes
+            case 0:
+                return HTTP_EAGAIN;
+
+            case detail::CR:
+                if( !str[1] ){
+                    return HTTP_EAGAIN;
+                }
+                else if( str[1] != detail::LF ){
+                    return HTTP_ELINEFMT;
+                }
+                // skip CR
+                cur++;
+                // fall through
+            case detail::LF:
+                // skip LF
+                cur++;
+                head = cur;
+                phase = HTTP_PHASE_DONE;
+                return HTTP_SUCCESS;
+
+            default:
+                return HTTP_ELINEFMT;
+        }
+    }
+
+
+    int parse_header( char *buf, size_t len ) noexcept
+    {
+        const char *str = buf + cur;
+
+        switch( *str )
+        {
+            // need more bytes
+            case 0:
+                return HTTP_EAGAIN;
+
+            // end of header
+            case detail::LF:
+                head = cur = cur + 1;
+                phase = HTTP_PHASE_DONE;
+                return HTTP_SUCCESS;
+
+            case detail::CR:
+                if( !str[1] ){
+                    return HTTP_EAGAIN;
+                }
+                else if( str[1] == detail::LF ){
+                    head = cur = cur + 2;
+                    phase = HTTP_PHASE_DONE;
+                    return HTTP_SUCCESS;
+                }
+                return HTTP_EHDRFMT;
+
+            default:
+                if( nheader < Policy::maxheader ){
+                    phase = HTTP_PHASE_HKEY;
+                    return parse_hkey( buf, len );
+                }
+                // too many headers
+                return HTTP_ENHDR;
+        }
+    }
+
+
+    int parse_hval( char *buf, size_t len ) noexcept
+    {
+        const unsigned char *delim = (const unsigned char*)buf;
+        size_t hkey = headers[nheader].key;
+        size_t pos = cur;
+        size_t tail = 0;
+        unsigned char c = 0;
+
+        for(; pos < len; pos++ )
+        {
+            c = delim[pos];
+            switch( tbl::vchar[c] )
+            {
+                case 1:
+                    continue;
+
+                // LF or CR
+                case 2:
+                    tail = pos;
+                    if( c == detail::LF ){
+                        pos++;
+                    }
+                    else if( delim[pos + 1] == detail::LF ){
+                        pos += 2;
+                    }
+                    // null-terminator
+                    else if( !delim[pos + 1] ){
+                        goto CHECK_AGAIN;
+                    }
+                    else {
+                        return HTTP_EHDRFMT;
+                    }
+
+                    // remove OWS
+                    while( tail > head && tbl::spht[delim[tail - 1]] ){
+                        tail--;
+                    }
+                    if( ( tail - hkey ) > Policy::maxhdrlen ){
+                        return HTTP_EHDRLEN;
+                    }
+                    // ignore empty hval
+                    else if( tail > head ){
+                        headers[nheader].val = head;
+                        headers[nheader].vlen = (offset_type)(uint16_t)(
+                            tail - head
+                        );
+                        nheader++;
+                    }
+                    head = cur = (offset_type)pos;
+                    phase = HTTP_PHASE_HEADER;
+                    return parse_header( buf, len );
+
+                default:
+                    return HTTP_EHDRFMT;
+            }
+        }
+
+CHECK_AGAIN:
+        if( ( len - hkey ) > Policy::maxhdrlen ){
+            return HTTP_EHDRLEN;
+        }
+        cur = (offset_type)pos;
+
+        return HTTP_EAGAIN;
+    }
+
+
+    int parse_hkey( char *buf, size_t len ) noexcept
+    {
+        unsigned char *delim = (unsigned char*)buf;
+        size_t pos = cur;
+        size_t klen = 0;
+        unsigned char c = 0;
+
+        for(; pos < len; pos++ )
+        {
+            c = tbl::hkeyc[delim[pos]];
+            if( c == 0 ){
+                return HTTP_EHDRFMT;
+            }
+            else if( c != 2 ){
+                // lowercase
+                delim[pos] = c;
+                continue;
+            }
+
+            // COLON
+            klen = pos - head;
+            if( klen > Policy::maxhdrlen ){
+                return HTTP_EHDRLEN;
+            }
+            cur = (offset_type)pos;
+
+            // remove OWS
+            while( ++pos < len )
+            {
+                if( tbl::spht[delim[pos]] ){
+                    continue;
+                }
+                // empty hval
+                else if( delim[pos] == detail::CR )
+                {
+                    if( !delim[pos + 1] ){
+                        return HTTP_EAGAIN;
+                    }
+                    else if( delim[pos + 1] == detail::LF ){
+                        head = cur = (offset_type)( pos + 2 );
+                        phase = HTTP_PHASE_HEADER;
+                        return parse_header( buf, len );
+                    }
+                    return HTTP_EHDRFMT;
+                }
+                else if( delim[pos] == detail::LF ){
+                    head = cur = (offset_type)( pos + 1 );
+                    phase = HTTP_PHASE_HEADER;
+                    return parse_header( buf, len );
+                }
+                break;
+            }
+
+            headers[nheader].key = head;
+            headers[nheader].klen = (offset_type)(uint16_t)klen;
+            head = cur = (offset_type)pos;
+            phase = HTTP_PHASE_HVAL;
+            if( pos >= len ){
+                return HTTP_EAGAIN;
+            }
+            return parse_hval( buf, len );
+        }
+
+        // header-length too large
+        if( ( len - head ) > Policy::maxhdrlen ){
+            return HTTP_EHDRLEN;
+        }
+        cur = (offset_type)len;
+
+        return HTTP_EAGAIN;
+    }
+
+
+    int parse_ver( char *buf, size_t len ) noexcept
+    {
+        const char *delim = (const char*)std::memchr( buf + cur, detail::LF,
+                                                      len - cur );
+
+        if( delim )
+        {
+            size_t eol = (size_t)( delim - buf );
+            size_t slen = eol - head;
+
+            if( *( delim - 1 ) == detail::CR ){
+                slen--;
+            }
+            if( slen != detail::VER_LEN ){
+                return HTTP_EVERSION;
+            }
+
+            if( match( buf + head, "HTTP/1.1" ) ){
+                protocol |= HTTP_V11;
+            }
+            else if( match( buf + head, "HTTP/1.0" ) )
+            {
+                // GET, HEAD or POST only
+                if( protocol > HTTP_MPOST ){
+                    return HTTP_EMETHOD;
+                }
+                protocol |= HTTP_V10;
+            }
+            else if( match( buf + head, "HTTP/0.9" ) )
+            {
+                // GET only
+                if( protocol != HTTP_MGET ){
+                    return HTTP_EMETHOD;
+                }
+                head = cur = (offset_type)( eol + 1 );
+                phase = HTTP_PHASE_EOL;
+                return parse_eol( buf );
+            }
+            else {
+                return HTTP_EVERSION;
+            }
+
+            head = cur = (offset_type)( eol + 1 );
+            phase = HTTP_PHASE_HEADER;
+            return parse_header( buf, len );
+        }
+        // invalid version format (allow the CR of CRLF)
+        else if( ( len - head ) > detail::VER_LEN + 1 ){
+            return HTTP_EVERSION;
+        }
+        cur = (offset_type)len;
+
+        return HTTP_EAGAIN;
+    }
+
+
+    int parse_uri( char *buf, size_t len ) noexcept
+    {
+        const unsigned char *p = (const unsigned char*)buf;
+        size_t pos = cur;
+
+        for(; pos < len; pos++ )
+        {
+            if( p[pos] == detail::SP ){
+                phase = HTTP_PHASE_VERSION;
+                break;
+            }
+            // illegal byte sequence
+            else if( !tbl::uric[p[pos]] )
+            {
+                // probably, HTTP/0.9 request
+                if( ( p[pos] == detail::LF && !p[pos + 1] ) ||
+                    ( p[pos] == detail::CR && p[pos + 1] == detail::LF &&
+                      !p[pos + 2] ) )
+                {
+                    // HTTP/0.9 supports a GET method only
+                    if( protocol != HTTP_MGET ){
+                        return HTTP_EMETHOD;
+                    }
+                    phase = HTTP_PHASE_DONE;
+                    break;
+                }
+                return HTTP_EBADURI;
+            }
+        }
+
+        if( pos < len )
+        {
+            msg = head;
+            msglen = (uint16_t)( pos - head );
+            if( msglen > Policy::maxurilen ){
+                return HTTP_EURILEN;
+            }
+            // HTTP/0.9 request
+            else if( phase == HTTP_PHASE_DONE ){
+                return HTTP_SUCCESS;
+            }
+            head = cur = (offset_type)( head + msglen + 1 );
+            return parse_ver( buf, len );
+        }
+        // request-uri too long
+        else if( len - head > Policy::maxurilen ){
+            return HTTP_EURILEN;
+        }
+        cur = (offset_type)len;
+
+        return HTTP_EAGAIN;
+    }
+
+
+    int parse_method( char *buf, size_t len ) noexcept
+    {
+        const char *delim = (const char*)std::memchr( buf + cur, detail::SP,
+                                                      len - cur );
+
+        if( delim )
+        {
+            const char *str = buf + head;
+            size_t slen = (size_t)( delim - str );
+
+#define HTTP_METHOD_CASE(m,code) \
+    if( std::memcmp( str, m, sizeof( m ) - 1 ) == 0 ){ \
+        protocol = code; \
+        break; \
+    }
+
+            switch( slen ){
+                case 3:
+                    HTTP_METHOD_CASE( "GET", HTTP_MGET );
+                    HTTP_METHOD_CASE( "PUT", HTTP_MPUT );
+                    return HTTP_EMETHOD;
+                case 4:
+                    HTTP_METHOD_CASE( "POST", HTTP_MPOST );
+                    HTTP_METHOD_CASE( "HEAD", HTTP_MHEAD );
+                    return HTTP_EMETHOD;
+                case 5:
+                    HTTP_METHOD_CASE( "TRACE", HTTP_MTRACE );
+                    return HTTP_EMETHOD;
+                case 6:
+                    HTTP_METHOD_CASE( "DELETE", HTTP_MDELETE );
+                    return HTTP_EMETHOD;
+                case 7:
+                    HTTP_METHOD_CASE( "OPTIONS", HTTP_MOPTIONS );
+                    HTTP_METHOD_CASE( "CONNECT", HTTP_MCONNECT );
+                    return HTTP_EMETHOD;
+                // method not implemented
+                default:
+                    return HTTP_EMETHOD;
+            }
+
+#undef HTTP_METHOD_CASE
+
+            head = cur = (offset_type)( head + slen + 1 );
+            phase = HTTP_PHASE_URI;
+            return parse_uri( buf, len );
+        }
+        // method not implemented
+        else if( len > detail::METHOD_LEN ){
+            return HTTP_EMETHOD;
+        }
+        cur = (offset_type)len;
+
+        return HTTP_EAGAIN;
+    }
+
+
+    int parse_reason( char *buf, size_t len ) noexcept
+    {
+        const unsigned char *delim = (const unsigned char*)buf;
+        size_t pos = cur;
+        unsigned char c = 0;
+
+        for(; pos < len; pos++ )
+        {
+            c = delim[pos];
+            switch( tbl::vchar[c] )
+            {
+                case 1:
+                    continue;
+
+                // LF or CR
+                case 2:
+                    if( c == detail::LF ){
+                        pos++;
+                    }
+                    else if( delim[pos + 1] == detail::LF ){
+                        pos += 2;
+                    }
+                    // null-terminator
+                    else if( !delim[pos + 1] ){
+                        goto CHECK_AGAIN;
+                    }
+                    else {
+                        return HTTP_EREASON;
+                    }
+
+                    // phrase-length too large
+                    if( ( pos - head ) > UINT16_MAX ){
+                        return HTTP_EREASON;
+                    }
+                    msg = head;
+                    msglen = (uint16_t)( pos - head );
+                    head = cur = (offset_type)pos;
+                    phase = HTTP_PHASE_HEADER;
+                    return parse_header( buf, len );
+
+                default:
+                    return HTTP_EREASON;
+            }
+        }
+
+CHECK_AGAIN:
+        if( ( len - head ) > UINT16_MAX ){
+            return HTTP_EREASON;
+        }
+        cur = (offset_type)pos;
+
+        return HTTP_EAGAIN;
+    }
+
+
+    int parse_status( char *buf, size_t len ) noexcept
+    {
+        const char *delim = (const char*)std::memchr( buf + cur, detail::SP,
+                                                      len - cur );
+
+        if( delim )
+        {
+            const unsigned char *str = (const unsigned char*)( buf + head );
+            size_t slen = (size_t)( (const unsigned char*)delim - str );
+
+            if( slen != detail::STATUS_LEN ||
+                str[0] < '1' || str[0] > '5' ||
+                str[1] < '0' || str[1] > '9' ||
+                str[2] < '0' || str[2] > '9' ){
+                return HTTP_ESTATUS;
+            }
+            protocol |= ( str[0] - 0x30 ) * 100 + ( str[1] - 0x30 ) * 10 +
+                        ( str[2] - 0x30 );
+            head = cur = (offset_type)( head + slen + 1 );
+            phase = HTTP_PHASE_REASON;
+            return parse_reason( buf, len );
+        }
+        else if( ( len - cur ) > detail::STATUS_LEN ){
+            return HTTP_ESTATUS;
+        }
+        cur = (offset_type)len;
+
+        return HTTP_EAGAIN;
+    }
+
+
+    int parse_ver_res( char *buf, size_t len ) noexcept
+    {
+        const char *delim = (const char*)std::memchr( buf + cur, detail::SP,
+                                                      len - cur );
+
+        if( delim )
+        {
+            if( (size_t)( delim - buf ) == detail::VER_LEN )
+            {
+                if( match( buf + head, "HTTP/1.1" ) ){
+                    protocol = HTTP_V11;
+                }
+                else if( match( buf + head, "HTTP/1.0" ) ){
+                    protocol = HTTP_V10;
+                }
+                else if( match( buf + head, "HTTP/0.9" ) ){
+                    protocol = HTTP_V09;
+                }
+                else {
+                    return HTTP_EVERSION;
+                }
+                head = cur = detail::VER_LEN + 1;
+                phase = HTTP_PHASE_STATUS;
+                return parse_status( buf, len );
+            }
+        }
+        // need more bytes
+        else if( len <= detail::VER_LEN ){
+            cur = (offset_type)len;
+            return HTTP_EAGAIN;
+        }
+
+        // HTTP/0.9 simple-response
+        protocol = HTTP_V09;
+        cur = 0;
+
+        return HTTP_SUCCESS;
+    }
+};
+
+
+template<bool Strict = true, uint8_t MaxHeader = UINT8_MAX,
+         typename Offset = uint32_t, uint16_t MaxURILen = UINT16_MAX,
+         uint16_t MaxHdrLen = UINT16_MAX>
+using request_parser = parser<request_policy<Strict, MaxHeader, Offset,
+                                             MaxURILen, MaxHdrLen>>;
+
+template<bool Strict = true, uint8_t MaxHeader = UINT8_MAX,
+         typename Offset = uint32_t, uint16_t MaxHdrLen = UINT16_MAX>
+using response_parser = parser<response_policy<Strict, MaxHeader, Offset,
+                                               MaxHdrLen>>;
+
+
+} // namespace http
+
+#endif
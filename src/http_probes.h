@@ -0,0 +1,88 @@
+/*
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ *  IN THE SOFTWARE.
+ *
+ *  http_probes.h
+ */
+
+#ifndef HTTP_PROBES_H
+#define HTTP_PROBES_H
+
+/**
+ * USDT probes of the provider "libhttp"
+ *
+ *  parse__start( http_t*, phase, cur, len )
+ *  parse__done( http_t*, cur, nheader )
+ *  parse__again( http_t*, phase, cur, len )
+ *  parse__error( http_t*, rc, phase, cur )
+ *  phase( http_t*, from, to, cur )
+ *  header( http_t*, index, key, val, vlen )
+ *
+ * a probe site is a single nop until a tracer attaches to it. the probes are
+ * compiled only with --enable-usdt (HTTP_USDT).
+ */
+#ifdef HTTP_USDT
+#include <sys/sdt.h>
+
+#define HTTP_PROBE4(n,a,b,c,d)      DTRACE_PROBE4(libhttp,n,a,b,c,d)
+#define HTTP_PROBE5(n,a,b,c,d,e)    DTRACE_PROBE5(libhttp,n,a,b,c,d,e)
+
+#define HTTP_PROBE_START(h,len) \
+    HTTP_PROBE4( parse__start, h, (h)->phase, (h)->cur, len )
+
+#define HTTP_PROBE_EXIT(h,rc,len) do{ \
+    if( rc == HTTP_SUCCESS ){ \
+        DTRACE_PROBE3( libhttp, parse__done, h, (h)->cur, (h)->nheader ); \
+    } \
+    else if( rc == HTTP_EAGAIN ){ \
+        HTTP_PROBE4( parse__again, h, (h)->phase, (h)->cur, len ); \
+    } \
+    else { \
+        HTTP_PROBE4( parse__error, h, rc, (h)->phase, (h)->cur ); \
+    } \
+}while(0)
+
+#else
+
+#define HTTP_PROBE4(n,a,b,c,d)      do{}while(0)
+#define HTTP_PROBE5(n,a,b,c,d,e)    do{}while(0)
+#define HTTP_PROBE_START(h,len)     do{}while(0)
+#define HTTP_PROBE_EXIT(h,rc,len)   do{}while(0)
+
+#endif
+
+
+/**
+ * change the parse phase
+ */
+#define HTTP_SET_PHASE(h,p) do{ \
+    HTTP_PROBE4( phase, h, (h)->phase, p, (h)->cur ); \
+    (h)->phase = p; \
+}while(0)
+
+
+/**
+ * the header value has been committed at the index
+ */
+#define HTTP_PROBE_HEADER(h,k,v,l) \
+    HTTP_PROBE5( header, h, (h)->nheader, k, v, l )
+
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ *  IN THE SOFTWARE.
+ *
+ *  http_rbuf.c
+ */
+
+#include "http_rbuf.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+
+http_rbuf_t *http_rbuf_alloc( size_t size, size_t maxsize )
+{
+    http_rbuf_t *b = NULL;
+
+    // invalid arguments
+    if( !size || size > maxsize ){
+        errno = EINVAL;
+        return NULL;
+    }
+    else if( ( b = (http_rbuf_t*)malloc( sizeof( http_rbuf_t ) ) ) )
+    {
+        // allocate with null-terminator
+        if( ( b->buf = (char*)malloc( size + 1 ) ) ){
+            b->buf[0] = 0;
+            b->size = size;
+            b->maxsize = maxsize;
+            b->head = 0;
+            b->len = 0;
+            return b;
+        }
+        free( (void*)b );
+    }
+
+    return NULL;
+}
+
+
+void http_rbuf_free( http_rbuf_t *b )
+{
+    free( (void*)b->buf );
+    free( (void*)b );
+}
+
+
+char *http_rbuf_reserve( http_rbuf_t *b, size_t *space )
+{
+    // no tail space
+    if( b->len == b->size )
+    {
+        size_t msglen = b->len - b->head;
+
+        // grow the buffer if the current message occupies more than half
+        if( msglen > ( b->size >> 1 ) && b->size < b->maxsize )
+        {
+            size_t size = b->size << 1;
+            char *buf = NULL;
+
+            if( size > b->maxsize ){
+                size = b->maxsize;
+            }
+            if( !( buf = (char*)realloc( b->buf, size + 1 ) ) ){
+                return NULL;
+            }
+            b->buf = buf;
+            b->size = size;
+        }
+        // move the current message to the front
+        else if( b->head ){
+            memmove( b->buf, b->buf + b->head, msglen );
+            b->buf[msglen] = 0;
+            b->head = 0;
+            b->len = msglen;
+        }
+        // the current message fills the head budget
+        else {
+            errno = ENOBUFS;
+            return NULL;
+        }
+    }
+
+    *space = b->size - b->len;
+
+    return b->buf + b->len;
+}
+
+
+void http_rbuf_commit( http_rbuf_t *b, size_t n )
+{
+    b->len += n;
+    b->buf[b->len] = 0;
+}
+
+
+void http_rbuf_consume( http_rbuf_t *b, size_t n )
+{
+    b->head += n;
+    // no pipelined bytes: rewind without moving anything
+    if( b->head >= b->len ){
+        b->head = b->len = 0;
+        b->buf[0] = 0;
+    }
+}
+
+
+int http_rbuf_parse_request( http_rbuf_t *b, http_t *h, uint16_t maxurilen,
+                             uint16_t maxhdrlen )
+{
+    return http_parse_request( h, http_rbuf_msg( b ), http_rbuf_msglen( b ),
+                               maxurilen, maxhdrlen );
+}
+
+
+int http_rbuf_parse_response( http_rbuf_t *b, http_t *h, uint16_t maxhdrlen )
+{
+    return http_parse_response( h, http_rbuf_msg( b ), http_rbuf_msglen( b ),
+                                maxhdrlen );
+}
+
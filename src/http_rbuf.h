@@ -0,0 +1,106 @@
+/*
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ *  IN THE SOFTWARE.
+ *
+ *  http_rbuf.h
+ */
+
+#ifndef HTTP_RBUF_H
+#define HTTP_RBUF_H
+
+#include "http.h"
+
+
+/**
+ * connection read buffer
+ *
+ * the buffer keeps the bytes of the current message at buf + head, so the
+ * offsets stored in http_t are always relative to http_rbuf_msg(). bytes of
+ * pipelined messages that follow the current message stay in place until
+ * the tail space runs out, and they are moved to the front only then.
+ */
+typedef struct {
+    /* read buffer (always null-terminated at len) */
+    char *buf;
+    /* allocated size (excluding null-terminator) */
+    size_t size;
+    /* head budget: buffer never grows beyond this size */
+    size_t maxsize;
+    /* head position of the current message */
+    size_t head;
+    /* length of the buffered bytes */
+    size_t len;
+} http_rbuf_t;
+
+
+/**
+ * head position and length of the current message
+ */
+#define http_rbuf_msg(b)    ((b)->buf + (b)->head)
+#define http_rbuf_msglen(b) ((b)->len - (b)->head)
+
+
+/**
+ * allocate http_rbuf_t*
+ * size is the initial buffer size and maxsize is the head budget
+ */
+http_rbuf_t *http_rbuf_alloc( size_t size, size_t maxsize );
+
+
+/**
+ * deallocate http_rbuf_t*
+ */
+void http_rbuf_free( http_rbuf_t *b );
+
+
+/**
+ * return the writable tail space and store its length into space.
+ * the buffered bytes are compacted to the front if needed, and then the
+ * buffer grows geometrically up to maxsize.
+ * return NULL and set errno to ENOBUFS if the current message already fills
+ * the head budget, or ENOMEM if allocation failed.
+ */
+char *http_rbuf_reserve( http_rbuf_t *b, size_t *space );
+
+
+/**
+ * append n bytes that have been written into the reserved tail space
+ */
+void http_rbuf_commit( http_rbuf_t *b, size_t n );
+
+
+/**
+ * discard n bytes of the current message, the rest of the buffered bytes
+ * become the next message.
+ */
+void http_rbuf_consume( http_rbuf_t *b, size_t n );
+
+
+/**
+ * parsing the buffered request/response by http_parse_request and
+ * http_parse_response
+ */
+int http_rbuf_parse_request( http_rbuf_t *b, http_t *h, uint16_t maxurilen,
+                             uint16_t maxhdrlen );
+
+int http_rbuf_parse_response( http_rbuf_t *b, http_t *h, uint16_t maxhdrlen );
+
+
+#endif
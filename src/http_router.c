@@ -0,0 +1,406 @@
+/*
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ *  IN THE SOFTWARE.
+ *
+ *  http_router.c
+ */
+
+#include "http_router.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+
+typedef struct http_rnode_st http_rnode_t;
+
+struct http_rnode_st {
+    /* static bytes of the node */
+    char *label;
+    size_t len;
+    /* first bytes of the labels of the static children */
+    char *indices;
+    http_rnode_t **children;
+    size_t nchild;
+    /* capture of the segment and of the rest */
+    http_rnode_t *param;
+    http_rnode_t *wild;
+    /* handlers indexed by the method, NULL if no pattern ends here */
+    void **handlers;
+    uint16_t allow;
+};
+
+struct http_router_st {
+    http_rnode_t root;
+};
+
+
+static http_rnode_t *node_alloc( const char *label, size_t len )
+{
+    http_rnode_t *n = (http_rnode_t*)calloc( 1, sizeof( http_rnode_t ) );
+
+    if( n && len )
+    {
+        if( !( n->label = (char*)malloc( len ) ) ){
+            free( (void*)n );
+            return NULL;
+        }
+        memcpy( n->label, label, len );
+        n->len = len;
+    }
+
+    return n;
+}
+
+
+static void node_clear( http_rnode_t *n )
+{
+    size_t i = 0;
+
+    for(; i < n->nchild; i++ ){
+        node_clear( n->children[i] );
+        free( (void*)n->children[i] );
+    }
+    if( n->param ){
+        node_clear( n->param );
+        free( (void*)n->param );
+    }
+    if( n->wild ){
+        node_clear( n->wild );
+        free( (void*)n->wild );
+    }
+    free( (void*)n->label );
+    free( (void*)n->indices );
+    free( (void*)n->children );
+    free( (void*)n->handlers );
+}
+
+
+static int node_addchild( http_rnode_t *n, http_rnode_t *c )
+{
+    char *indices = (char*)realloc( n->indices, n->nchild + 1 );
+    http_rnode_t **children = NULL;
+
+    if( !indices ){
+        return -1;
+    }
+    n->indices = indices;
+    children = (http_rnode_t**)realloc( n->children, sizeof( http_rnode_t* ) *
+                                        ( n->nchild + 1 ) );
+    if( !children ){
+        return -1;
+    }
+    n->children = children;
+    n->indices[n->nchild] = c->label[0];
+    n->children[n->nchild++] = c;
+
+    return 0;
+}
+
+
+/**
+ * split the label of the node at k, and move the rest and the descendants
+ * of the node to the new child
+ */
+static int node_split( http_rnode_t *n, size_t k )
+{
+    http_rnode_t *c = node_alloc( n->label + k, n->len - k );
+
+    if( !c ){
+        return -1;
+    }
+    c->indices = n->indices;
+    c->children = n->children;
+    c->nchild = n->nchild;
+    c->param = n->param;
+    c->wild = n->wild;
+    c->handlers = n->handlers;
+    c->allow = n->allow;
+
+    n->len = k;
+    n->indices = NULL;
+    n->children = NULL;
+    n->nchild = 0;
+    n->param = NULL;
+    n->wild = NULL;
+    n->handlers = NULL;
+    n->allow = 0;
+    if( node_addchild( n, c ) ){
+        // restore
+        n->len += c->len;
+        n->indices = c->indices;
+        n->children = c->children;
+        n->nchild = c->nchild;
+        n->param = c->param;
+        n->wild = c->wild;
+        n->handlers = c->handlers;
+        n->allow = c->allow;
+        free( (void*)c->label );
+        free( (void*)c );
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static inline http_rnode_t *node_child( const http_rnode_t *n, char c )
+{
+    const char *idx = NULL;
+
+    if( n->nchild && ( idx = memchr( n->indices, c, n->nchild ) ) ){
+        return n->children[idx - n->indices];
+    }
+
+    return NULL;
+}
+
+
+/**
+ * ':' and '*' at the head of a segment
+ */
+static inline int is_capture( const char *pattern, size_t i )
+{
+    return ( pattern[i] == ':' || pattern[i] == '*' ) && pattern[i - 1] == '/';
+}
+
+
+http_router_t *http_router_alloc( void )
+{
+    return (http_router_t*)calloc( 1, sizeof( http_router_t ) );
+}
+
+
+void http_router_free( http_router_t *r )
+{
+    node_clear( &r->root );
+    free( (void*)r );
+}
+
+
+int http_router_add( http_router_t *r, int method, const char *pattern,
+                     void *handler )
+{
+    size_t len = strlen( pattern );
+    http_rnode_t *n = &r->root;
+    http_rnode_t **capture = NULL;
+    http_rnode_t *c = NULL;
+    size_t nparam = 0;
+    size_t i = 0;
+    size_t k = 0;
+    size_t e = 0;
+
+    if( method < 0 || method >= HTTP_ROUTER_NMETHOD || !len ||
+        *pattern != '/' || !handler ){
+        errno = EINVAL;
+        return -1;
+    }
+
+    while( i < len )
+    {
+        if( is_capture( pattern, i ) )
+        {
+            // name of the capture
+            for( e = i + 1; e < len && pattern[e] != '/'; e++ ){}
+            if( ( e == i + 1 && pattern[i] == ':' ) ||
+                ++nparam > HTTP_ROUTER_MAXPARAM ||
+                ( pattern[i] == '*' && e != len ) ){
+                errno = EINVAL;
+                return -1;
+            }
+            capture = pattern[i] == ':' ? &n->param : &n->wild;
+            if( !*capture && !( *capture = node_alloc( NULL, 0 ) ) ){
+                return -1;
+            }
+            n = *capture;
+            i = e;
+            continue;
+        }
+
+        // static bytes up to the next capture
+        for( e = i + 1; e < len && !is_capture( pattern, e ); e++ ){}
+        if( !( c = node_child( n, pattern[i] ) ) )
+        {
+            if( !( c = node_alloc( pattern + i, e - i ) ) ){
+                return -1;
+            }
+            else if( node_addchild( n, c ) ){
+                free( (void*)c->label );
+                free( (void*)c );
+                return -1;
+            }
+            n = c;
+            i = e;
+            continue;
+        }
+
+        // common prefix with the child
+        for( k = 1; k < c->len && i + k < e && c->label[k] == pattern[i + k];
+             k++ ){}
+        if( k < c->len && node_split( c, k ) ){
+            return -1;
+        }
+        n = c;
+        i += k;
+    }
+
+    if( !n->handlers &&
+        !( n->handlers = (void**)calloc( HTTP_ROUTER_NMETHOD,
+                                         sizeof( void* ) ) ) ){
+        return -1;
+    }
+    else if( n->handlers[method] ){
+        errno = EEXIST;
+        return -1;
+    }
+    n->handlers[method] = handler;
+    n->allow |= (uint16_t)( 1 << method );
+
+    return 0;
+}
+
+
+static inline void push( http_route_t *route, size_t val, size_t vlen )
+{
+    route->params[route->nparam].val = (uintptr_t)val;
+    route->params[route->nparam++].vlen = (uint16_t)vlen;
+}
+
+
+/**
+ * match the rest of the path from pos after the label of the node.
+ * return the node that has the handlers, or NULL.
+ */
+static const http_rnode_t *match( const http_rnode_t *n, const char *path,
+                                  size_t len, size_t pos, http_route_t *route )
+{
+    const http_rnode_t *found = NULL;
+    const http_rnode_t *c = NULL;
+    const char *end = NULL;
+    uint8_t nparam = route->nparam;
+
+    if( pos == len )
+    {
+        if( n->handlers ){
+            return n;
+        }
+        else if( n->wild && n->wild->handlers ){
+            push( route, pos, 0 );
+            return n->wild;
+        }
+        return NULL;
+    }
+
+    // static child
+    if( ( c = node_child( n, path[pos] ) ) && len - pos >= c->len &&
+        !memcmp( path + pos, c->label, c->len ) &&
+        ( found = match( c, path, len, pos + c->len, route ) ) ){
+        return found;
+    }
+
+    // capture of the segment
+    if( n->param && path[pos] != '/' )
+    {
+        if( !( end = memchr( path + pos, '/', len - pos ) ) ){
+            end = path + len;
+        }
+        push( route, pos, (size_t)( end - path ) - pos );
+        if( ( found = match( n->param, path, len, (size_t)( end - path ),
+                             route ) ) ){
+            return found;
+        }
+        route->nparam = nparam;
+    }
+
+    // capture of the rest
+    if( n->wild && n->wild->handlers ){
+        push( route, pos, len - pos );
+        return n->wild;
+    }
+
+    return NULL;
+}
+
+
+int http_router_match( const http_router_t *r, int method, const char *path,
+                       size_t len, http_route_t *route )
+{
+    const http_rnode_t *n = NULL;
+
+    route->handler = NULL;
+    route->allow = 0;
+    route->nparam = 0;
+    if( !( n = match( &r->root, path, len, 0, route ) ) ){
+        route->nparam = 0;
+        return HTTP_ROUTER_ENOTFOUND;
+    }
+
+    route->allow = n->allow;
+    if( method > 0 && method < HTTP_ROUTER_NMETHOD && n->handlers[method] ){
+        route->handler = n->handlers[method];
+    }
+    else if( n->handlers[0] ){
+        route->handler = n->handlers[0];
+    }
+    else {
+        return HTTP_ROUTER_EMETHOD;
+    }
+
+    return HTTP_ROUTER_FOUND;
+}
+
+
+int http_router_lookup( const http_router_t *r, const http_t *h,
+                        const char *msg, http_route_t *route )
+{
+    const char *path = msg + h->msg;
+    const char *tail = path + h->msglen;
+    const char *end = NULL;
+    uintptr_t base = 0;
+    uint8_t i = 0;
+    int rc = 0;
+
+    // absolute-form: skip the scheme and the authority
+    if( path < tail && *path != '/' &&
+        ( end = memchr( path, ':', (size_t)( tail - path ) ) ) &&
+        tail - end > 2 && end[1] == '/' && end[2] == '/' )
+    {
+        for( path = end + 3; path < tail && *path != '/' && *path != '?';
+             path++ ){}
+        if( path == tail || *path != '/' ){
+            // empty path is "/"
+            rc = http_router_match( r, http_method( h ), "/", 1, route );
+            for(; i < route->nparam; i++ ){
+                route->params[i].val = (uintptr_t)( tail - msg );
+            }
+            return rc;
+        }
+    }
+    // query
+    for( end = path; end < tail && *end != '?'; end++ ){}
+
+    base = (uintptr_t)( path - msg );
+    rc = http_router_match( r, http_method( h ), path, (size_t)( end - path ),
+                            route );
+    for(; i < route->nparam; i++ ){
+        route->params[i].val += base;
+    }
+
+    return rc;
+}
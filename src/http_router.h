@@ -0,0 +1,143 @@
+/*
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ *  IN THE SOFTWARE.
+ *
+ *  http_router.h
+ */
+
+#ifndef HTTP_ROUTER_H
+#define HTTP_ROUTER_H
+
+#include "http.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * compressed radix tree of the request paths
+ *
+ * a pattern is a path that starts with '/'. a segment of the pattern that
+ * starts with ':' captures a non-empty segment of the path, and a segment
+ * that starts with '*' must be the last one and captures the rest of the
+ * path including the empty one. the name of '*' may be omitted. the names
+ * of the captures are only for the readers of the patterns, and the
+ * captures are returned in the order of the pattern. ':' and '*' that are
+ * not at the head of a segment are the literal bytes, and the path is
+ * compared byte by byte without decoding.
+ *
+ * at each node the static children are tried first, then the capture of
+ * the segment, and then the capture of the rest, so "/users/me" is chosen
+ * over "/users/:id" that is chosen over the capture of the rest at
+ * "/users/".
+ *
+ * each path has a handler table indexed by the method code of http_method(),
+ * and the index 0 is the handler of any method. the lookup never allocates.
+ */
+typedef struct http_router_st http_router_t;
+
+/* maximum number of the captures of a pattern */
+#define HTTP_ROUTER_MAXPARAM    16
+/* size of the handler table: any method and HTTP_MGET ... HTTP_MCONNECT */
+#define HTTP_ROUTER_NMETHOD     (HTTP_MCONNECT + 1)
+
+
+/**
+ * capture of the path
+ */
+typedef struct {
+    /* offset from the head of the path, or from the msg of http_t */
+    uintptr_t val;
+    uint16_t vlen;
+} http_param_t;
+
+
+/**
+ * result of the lookup
+ */
+typedef struct {
+    /* handler of the method */
+    void *handler;
+    /* methods of the matched path (1 << method), 1 for any method */
+    uint16_t allow;
+    uint8_t nparam;
+    http_param_t params[HTTP_ROUTER_MAXPARAM];
+} http_route_t;
+
+
+/**
+ * return code of the lookup
+ */
+/* the path and the method matched */
+#define HTTP_ROUTER_FOUND       0
+/* no path matched */
+#define HTTP_ROUTER_ENOTFOUND   -1
+/* the path matched, but it has no handler of the method */
+#define HTTP_ROUTER_EMETHOD     -2
+
+
+/**
+ * allocate http_router_t*
+ */
+http_router_t *http_router_alloc( void );
+
+
+/**
+ * deallocate http_router_t*
+ */
+void http_router_free( http_router_t *r );
+
+
+/**
+ * add the handler of the method (0 for any method) to the pattern.
+ * return -1 and set errno to EINVAL if the pattern, the method or the
+ * handler is invalid, EEXIST if the pattern already has the handler of the
+ * method, or ENOMEM.
+ */
+int http_router_add( http_router_t *r, int method, const char *pattern,
+                     void *handler );
+
+
+/**
+ * match the path of len bytes, and store the handler and the offsets of
+ * the captures from the head of the path into route.
+ * return HTTP_ROUTER_FOUND, HTTP_ROUTER_ENOTFOUND, or HTTP_ROUTER_EMETHOD
+ * with the allowed methods in route->allow.
+ */
+int http_router_match( const http_router_t *r, int method, const char *path,
+                       size_t len, http_route_t *route );
+
+
+/**
+ * match the path of the request-target of the parsed request by the method
+ * of http_method(). the query is ignored, and the absolute-form is matched
+ * by its path. the offsets of the captures are relative to msg like the
+ * offsets of the headers.
+ */
+int http_router_lookup( const http_router_t *r, const http_t *h,
+                        const char *msg, http_route_t *route );
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,254 @@
+/*
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ *  IN THE SOFTWARE.
+ *
+ *  http_scan.h
+ */
+
+#ifndef HTTP_SCAN_H
+#define HTTP_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+/**
+ * return the position of the first byte from cur that is not field-content
+ * (VCHAR, SP or HT), or len if not found.
+ */
+static inline size_t vchar_scan( const unsigned char *s, size_t cur,
+                                 size_t len )
+{
+#if defined(__SSE2__)
+    const __m128i sp = _mm_set1_epi8( 0x1F );
+    const __m128i del = _mm_set1_epi8( 0x7F );
+    const __m128i ht = _mm_set1_epi8( '\t' );
+
+    for(; cur + 16 <= len; cur += 16 )
+    {
+        __m128i v = _mm_loadu_si128( (const __m128i*)( s + cur ) );
+        // 0x20-0x7E (signed compare excludes 0x80-0xFF) or HT
+        __m128i ok = _mm_or_si128(
+            _mm_andnot_si128( _mm_cmpeq_epi8( v, del ),
+                              _mm_cmpgt_epi8( v, sp ) ),
+            _mm_cmpeq_epi8( v, ht )
+        );
+        unsigned mask = (unsigned)_mm_movemask_epi8( ok ) ^ 0xFFFF;
+
+        if( mask ){
+            return cur + (size_t)__builtin_ctz( mask );
+        }
+    }
+#endif
+
+    for(; cur < len; cur++ )
+    {
+        if( ( s[cur] < 0x20 && s[cur] != '\t' ) || s[cur] > 0x7E ){
+            break;
+        }
+    }
+
+    return cur;
+}
+
+
+/**
+ * return the position of the first LF from cur, or len if not found.
+ */
+static inline size_t lf_scan( const unsigned char *s, size_t cur, size_t len )
+{
+#if defined(__SSE2__)
+    const __m128i lf = _mm_set1_epi8( '\n' );
+
+    for(; cur + 16 <= len; cur += 16 )
+    {
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i*)( s + cur ) ), lf )
+        );
+
+        if( mask ){
+            return cur + (size_t)__builtin_ctz( mask );
+        }
+    }
+#endif
+
+    for(; cur < len && s[cur] != '\n'; cur++ ){}
+
+    return cur;
+}
+
+
+/**
+ * return 1 if the head (LF followed by LF or CRLF) is complete.
+ * s[len] must be readable.
+ */
+static inline int eoh_scan( const unsigned char *s, size_t len )
+{
+    size_t cur = 0;
+    size_t i = 0;
+
+    // most requests end with the head
+    if( len > 1 && s[len - 1] == '\n' &&
+        ( s[len - 2] == '\n' ||
+          ( len > 2 && s[len - 2] == '\r' && s[len - 3] == '\n' ) ) ){
+        return 1;
+    }
+
+#if defined(__SSE2__)
+    {
+        const __m128i lf = _mm_set1_epi8( '\n' );
+
+        for(; cur + 16 <= len; cur += 16 )
+        {
+            unsigned mask = (unsigned)_mm_movemask_epi8(
+                _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i*)( s + cur ) ),
+                                lf )
+            );
+
+            for(; mask; mask &= mask - 1 )
+            {
+                i = cur + (size_t)__builtin_ctz( mask );
+                if( s[i + 1] == '\n' ||
+                    ( s[i + 1] == '\r' && s[i + 2] == '\n' ) ){
+                    return 1;
+                }
+            }
+        }
+    }
+#endif
+
+    for(; cur < len; cur++ )
+    {
+        if( s[cur] == '\n' &&
+            ( s[cur + 1] == '\n' ||
+              ( s[cur + 1] == '\r' && s[cur + 2] == '\n' ) ) ){
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * ASCII lowercase
+ */
+#define TO_LOWER(c) \
+    ( ( (c) >= 'A' && (c) <= 'Z' ) ? (unsigned char)( (c) | 0x20 ) : (c) )
+
+#if defined(__SSE2__)
+static inline __m128i lower16( __m128i v )
+{
+    const __m128i a = _mm_set1_epi8( 'A' - 1 );
+    const __m128i z = _mm_set1_epi8( 'Z' + 1 );
+    // 0x80-0xFF are negative and not in the range
+    __m128i upper = _mm_and_si128( _mm_cmpgt_epi8( v, a ),
+                                   _mm_cmplt_epi8( v, z ) );
+
+    return _mm_or_si128( v, _mm_and_si128( upper, _mm_set1_epi8( 0x20 ) ) );
+}
+#endif
+
+
+/**
+ * return 1 if the ASCII strings are equal case-insensitively
+ */
+static inline int strcase_eq( const unsigned char *a, const unsigned char *b,
+                              size_t len )
+{
+#if defined(__SSE2__)
+    if( len >= 16 )
+    {
+        size_t i = 0;
+        __m128i va, vb;
+
+        for(; i + 16 <= len; i += 16 )
+        {
+            va = lower16( _mm_loadu_si128( (const __m128i*)( a + i ) ) );
+            vb = lower16( _mm_loadu_si128( (const __m128i*)( b + i ) ) );
+            if( _mm_movemask_epi8( _mm_cmpeq_epi8( va, vb ) ) != 0xFFFF ){
+                return 0;
+            }
+        }
+        // the last 16 bytes overlap the compared bytes
+        if( i < len ){
+            va = lower16( _mm_loadu_si128( (const __m128i*)( a + len - 16 ) ) );
+            vb = lower16( _mm_loadu_si128( (const __m128i*)( b + len - 16 ) ) );
+            return _mm_movemask_epi8( _mm_cmpeq_epi8( va, vb ) ) == 0xFFFF;
+        }
+        return 1;
+    }
+#endif
+
+    for(; len; len--, a++, b++ )
+    {
+        if( TO_LOWER( *a ) != TO_LOWER( *b ) ){
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/**
+ * case-insensitive 32 bit FNV-1a: the hash starts with STRCASE_HASH_INIT
+ * and is updated by each byte
+ */
+#define STRCASE_HASH_INIT   2166136261U
+
+static inline uint32_t strcase_hash_update( uint32_t hash, unsigned char c )
+{
+    return ( hash ^ TO_LOWER( c ) ) * 16777619U;
+}
+
+
+static inline uint32_t strcase_hash( const unsigned char *s, size_t len )
+{
+    uint32_t hash = STRCASE_HASH_INIT;
+
+    for(; len; len--, s++ ){
+        hash = strcase_hash_update( hash, *s );
+    }
+
+    return hash;
+}
+
+
+/**
+ * strcase_hash of the bytes from the end to the head
+ */
+static inline uint32_t strcase_rhash( const unsigned char *s, size_t len )
+{
+    uint32_t hash = STRCASE_HASH_INIT;
+
+    while( len-- ){
+        hash = strcase_hash_update( hash, s[len] );
+    }
+
+    return hash;
+}
+
+
+#endif
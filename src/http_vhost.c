@@ -0,0 +1,294 @@
+/*
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ *  IN THE SOFTWARE.
+ *
+ *  http_vhost.c
+ */
+
+#include "http_vhost.h"
+#include "http_scan.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+
+typedef struct {
+    /* lowercase name, or the suffix ".example.com" of the wildcard */
+    char *name;
+    uint32_t hash;
+    uint16_t len;
+    uint8_t wildcard;
+    void *udata;
+} vhost_entry_t;
+
+struct http_vhost_st {
+    vhost_entry_t *slots;
+    size_t mask;
+    size_t nentry;
+    size_t nwild;
+    /* udata of "*" */
+    void *any;
+};
+
+
+static inline size_t slot_index( const http_vhost_t *v, uint32_t hash )
+{
+    return ( hash ^ ( hash >> 15 ) ) & v->mask;
+}
+
+
+static const vhost_entry_t *find( const http_vhost_t *v, uint32_t hash,
+                                  const char *name, size_t len, int wildcard )
+{
+    const vhost_entry_t *e = NULL;
+    size_t i = slot_index( v, hash );
+
+    for(; ( e = &v->slots[i] )->name; i = ( i + 1 ) & v->mask )
+    {
+        if( e->hash == hash && e->len == len && e->wildcard == wildcard &&
+            strcase_eq( (const unsigned char*)name,
+                        (const unsigned char*)e->name, len ) ){
+            return e;
+        }
+    }
+
+    return NULL;
+}
+
+
+static int grow( http_vhost_t *v )
+{
+    size_t size = v->slots ? ( v->mask + 1 ) << 1 : 16;
+    vhost_entry_t *slots = (vhost_entry_t*)calloc( size,
+                                                   sizeof( vhost_entry_t ) );
+    vhost_entry_t *old = v->slots;
+    size_t n = old ? v->mask + 1 : 0;
+    size_t i = 0;
+    size_t k = 0;
+
+    if( !slots ){
+        return -1;
+    }
+    v->slots = slots;
+    v->mask = size - 1;
+    for(; i < n; i++ )
+    {
+        if( old[i].name ){
+            for( k = slot_index( v, old[i].hash ); slots[k].name;
+                 k = ( k + 1 ) & v->mask ){}
+            slots[k] = old[i];
+        }
+    }
+    free( (void*)old );
+
+    return 0;
+}
+
+
+http_vhost_t *http_vhost_alloc( void )
+{
+    http_vhost_t *v = (http_vhost_t*)calloc( 1, sizeof( http_vhost_t ) );
+
+    if( v && grow( v ) ){
+        free( (void*)v );
+        return NULL;
+    }
+
+    return v;
+}
+
+
+void http_vhost_free( http_vhost_t *v )
+{
+    size_t i = 0;
+
+    for(; i <= v->mask; i++ ){
+        free( (void*)v->slots[i].name );
+    }
+    free( (void*)v->slots );
+    free( (void*)v );
+}
+
+
+int http_vhost_add( http_vhost_t *v, const char *name, void *udata )
+{
+    size_t len = strlen( name );
+    int wildcard = 0;
+    vhost_entry_t *e = NULL;
+    uint32_t hash = 0;
+    size_t i = 0;
+
+    if( !udata ){
+        errno = EINVAL;
+        return -1;
+    }
+    else if( len == 1 && *name == '*' )
+    {
+        if( v->any ){
+            errno = EEXIST;
+            return -1;
+        }
+        v->any = udata;
+        return 0;
+    }
+    // "*.example.com" is kept as ".example.com"
+    else if( len > 2 && name[0] == '*' && name[1] == '.' ){
+        wildcard = 1;
+        name++;
+        len--;
+    }
+    if( len && name[len - 1] == '.' ){
+        len--;
+    }
+    if( !len || len > HTTP_VHOST_MAXNAME ){
+        errno = EINVAL;
+        return -1;
+    }
+    for(; i < len; i++ )
+    {
+        if( name[i] <= 0x20 || name[i] == 0x7F || name[i] == '*' ||
+            name[i] == '/' ){
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    hash = strcase_rhash( (const unsigned char*)name, len );
+    if( find( v, hash, name, len, wildcard ) ){
+        errno = EEXIST;
+        return -1;
+    }
+    // keep the load factor under 1/2
+    else if( ( v->nentry + 1 ) * 2 > v->mask + 1 && grow( v ) ){
+        return -1;
+    }
+
+    for( i = slot_index( v, hash ); v->slots[i].name;
+         i = ( i + 1 ) & v->mask ){}
+    e = &v->slots[i];
+    if( !( e->name = (char*)malloc( len + 1 ) ) ){
+        return -1;
+    }
+    for( i = 0; i < len; i++ ){
+        e->name[i] = (char)TO_LOWER( (unsigned char)name[i] );
+    }
+    e->name[len] = 0;
+    e->hash = hash;
+    e->len = (uint16_t)len;
+    e->wildcard = (uint8_t)wildcard;
+    e->udata = udata;
+    v->nentry++;
+    v->nwild += (size_t)wildcard;
+
+    return 0;
+}
+
+
+void *http_vhost_lookup( const http_vhost_t *v, const char *host,
+                         size_t len )
+{
+    uint32_t hashes[HTTP_VHOST_MAXNAME];
+    uint16_t dots[HTTP_VHOST_MAXNAME];
+    const vhost_entry_t *e = NULL;
+    uint32_t hash = STRCASE_HASH_INIT;
+    size_t ndot = 0;
+    size_t end = len;
+    size_t i = len;
+    unsigned char c = 0;
+
+    // port and trailing dot
+    while( i && host[i - 1] >= '0' && host[i - 1] <= '9' ){
+        i--;
+    }
+    if( i && host[i - 1] == ':' ){
+        end = i - 1;
+    }
+    if( end && host[end - 1] == '.' ){
+        end--;
+    }
+    if( !end || end > HTTP_VHOST_MAXNAME ){
+        return v->any;
+    }
+
+    // hash of the name and of the suffixes at the dots
+    for( i = end; i--; )
+    {
+        c = (unsigned char)host[i];
+        hash = strcase_hash_update( hash, c );
+        if( c == '.' && i ){
+            hashes[ndot] = hash;
+            dots[ndot++] = (uint16_t)i;
+        }
+    }
+
+    if( ( e = find( v, hash, host, end, 0 ) ) ){
+        return e->udata;
+    }
+    // the longest wildcard
+    else if( v->nwild )
+    {
+        while( ndot-- )
+        {
+            if( ( e = find( v, hashes[ndot], host + dots[ndot],
+                            end - dots[ndot], 1 ) ) ){
+                return e->udata;
+            }
+        }
+    }
+
+    return v->any;
+}
+
+
+void *http_vhost_request( const http_vhost_t *v, http_t *h, char *msg )
+{
+    const char *target = msg + h->msg;
+    const char *tail = target + h->msglen;
+    const char *p = NULL;
+    const char *end = NULL;
+    uintptr_t key, val;
+    uint16_t klen, vlen;
+    int at = 0;
+
+    // authority-form of CONNECT
+    if( http_method( h ) == HTTP_MCONNECT ){
+        return http_vhost_lookup( v, target, h->msglen );
+    }
+    // absolute-form: the authority without the userinfo
+    else if( target < tail && *target != '/' &&
+             ( p = memchr( target, ':', (size_t)( tail - target ) ) ) &&
+             tail - p > 2 && p[1] == '/' && p[2] == '/' )
+    {
+        for( p += 3, end = p; end < tail && *end != '/' && *end != '?';
+             end++ ){}
+        for( target = end; target > p && target[-1] != '@'; target-- ){}
+        return http_vhost_lookup( v, target, (size_t)( end - target ) );
+    }
+
+    if( ( at = http_findheader( h, msg, "host", 4 ) ) == -1 ||
+        ( ( h->opts & HTTP_OPT_LAZY ) ?
+          http_getheader_lazy( h, msg, &key, &klen, &val, &vlen,
+                               (uint8_t)at ) :
+          http_getheader_at( h, &key, &klen, &val, &vlen, (uint8_t)at ) ) ){
+        return v->any;
+    }
+
+    return http_vhost_lookup( v, msg + val, vlen );
+}
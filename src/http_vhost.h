@@ -0,0 +1,95 @@
+/*
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ *  IN THE SOFTWARE.
+ *
+ *  http_vhost.h
+ */
+
+#ifndef HTTP_VHOST_H
+#define HTTP_VHOST_H
+
+#include "http.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * virtual host table
+ *
+ * a name is an exact host name "www.example.com", a wildcard
+ * "*.example.com" that matches the names that end with ".example.com", or
+ * "*" that matches any name. the names are case-insensitive, and the
+ * longest wildcard is chosen if the exact name is not found.
+ *
+ * the names are kept in an open addressing hash table with the hash that
+ * is computed from the end of the name, so the single backward pass over
+ * the host lowercases it, strips the port and the trailing dot, and yields
+ * the hashes of all its wildcard suffixes at once. the lookup never
+ * allocates.
+ */
+typedef struct http_vhost_st http_vhost_t;
+
+/* maximum length of a host name */
+#define HTTP_VHOST_MAXNAME  255
+
+
+/**
+ * allocate http_vhost_t*
+ */
+http_vhost_t *http_vhost_alloc( void );
+
+
+/**
+ * deallocate http_vhost_t*
+ */
+void http_vhost_free( http_vhost_t *v );
+
+
+/**
+ * add the name with the non-NULL udata.
+ * return -1 and set errno to EINVAL if the name or the udata is invalid,
+ * EEXIST if the name already exists, or ENOMEM.
+ */
+int http_vhost_add( http_vhost_t *v, const char *name, void *udata );
+
+
+/**
+ * return the udata of the host of len bytes that may have the port, or
+ * NULL if no name matches.
+ */
+void *http_vhost_lookup( const http_vhost_t *v, const char *host,
+                         size_t len );
+
+
+/**
+ * return the udata of the host of the parsed request: the authority of the
+ * absolute-form request-target, or the value of the Host header.
+ * msg is modified only to split the Host header of HTTP_OPT_LAZY.
+ */
+void *http_vhost_request( const http_vhost_t *v, http_t *h, char *msg );
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
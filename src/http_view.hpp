@@ -0,0 +1,232 @@
+/*
+ *  Copyright 2015 Masatoshi Teruya All rights reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to
+ *  deal in the Software without restriction, including without limitation the
+ *  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ *  sell copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ *  IN THE SOFTWARE.
+ *
+ *  http_view.hpp
+ */
+
+#ifndef HTTP_VIEW_HPP
+#define HTTP_VIEW_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+#include <utility>
+#include "http.h"
+
+/**
+ * inline C++17 accessors of the parsed http_t and its buffer.
+ *
+ * the view does not own anything and does not allocate, the string views
+ * point into the buffer that was passed to http_parse_request or
+ * http_parse_response, so they are valid while the buffer is.
+ */
+namespace http {
+
+
+using field_view = std::pair<std::string_view, std::string_view>;
+
+
+class view {
+public:
+    view( const http_t *h, const char *buf ) noexcept : h_( h ), buf_( buf ) {}
+
+
+    /**
+     * HTTP_V09, HTTP_V10 or HTTP_V11
+     */
+    uint16_t version() const noexcept {
+        return http_version( h_ );
+    }
+
+    /**
+     * method code of the request or status code of the response
+     */
+    uint16_t code() const noexcept {
+        return h_->protocol & 0xFFF;
+    }
+
+    /**
+     * method token of the request
+     */
+    std::string_view method() const noexcept {
+        return h_->msg ? std::string_view( buf_, h_->msg - 1 ) :
+                         std::string_view();
+    }
+
+    /**
+     * request-target of the request
+     */
+    std::string_view target() const noexcept {
+        return std::string_view( buf_ + h_->msg, h_->msglen );
+    }
+
+    /**
+     * reason-phrase of the response without the line terminator
+     */
+    std::string_view reason() const noexcept
+    {
+        size_t len = h_->msglen;
+
+        while( len && ( buf_[h_->msg + len - 1] == '\n' ||
+                        buf_[h_->msg + len - 1] == '\r' ) ){
+            len--;
+        }
+        return std::string_view( buf_ + h_->msg, len );
+    }
+
+
+    /**
+     * number of the headers
+     */
+    uint8_t size() const noexcept {
+        return h_->nheader;
+    }
+
+    /**
+     * header at the index. the index must be less than size()
+     */
+    field_view operator[]( uint8_t at ) const noexcept
+    {
+        // same layout as the header slots of http.c
+        const unsigned char *mem = (const unsigned char*)( h_ + 1 ) +
+                                   HTTP_HEADER_SIZE * at;
+        uintptr_t key, val;
+        uint16_t klen, vlen;
+
+        std::memcpy( &key, mem, sizeof( key ) );
+        mem += sizeof( key );
+        std::memcpy( &klen, mem, sizeof( klen ) );
+        mem += sizeof( klen );
+        std::memcpy( &val, mem, sizeof( val ) );
+        mem += sizeof( val );
+        std::memcpy( &vlen, mem, sizeof( vlen ) );
+
+        return field_view( std::string_view( buf_ + key, klen ),
+                           std::string_view( buf_ + val, vlen ) );
+    }
+
+
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = field_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = field_view;
+
+        iterator( const view *v, uint8_t at ) noexcept : v_( v ), at_( at ) {}
+
+        field_view operator*() const noexcept {
+            return ( *v_ )[at_];
+        }
+        iterator &operator++() noexcept {
+            at_++;
+            return *this;
+        }
+        iterator operator++( int ) noexcept {
+            iterator it = *this;
+            at_++;
+            return it;
+        }
+        bool operator==( const iterator &it ) const noexcept {
+            return at_ == it.at_;
+        }
+        bool operator!=( const iterator &it ) const noexcept {
+            return at_ != it.at_;
+        }
+
+    private:
+        const view *v_;
+        uint8_t at_;
+    };
+
+
+    class range {
+    public:
+        explicit range( const view *v ) noexcept : v_( v ) {}
+
+        iterator begin() const noexcept {
+            return iterator( v_, 0 );
+        }
+        iterator end() const noexcept {
+            return iterator( v_, v_->size() );
+        }
+
+    private:
+        const view *v_;
+    };
+
+
+    /**
+     * range of the headers in the order of appearance
+     */
+    range headers() const noexcept {
+        return range( this );
+    }
+
+
+    /**
+     * value of the first header that matches the name case-insensitively.
+     * the keys are not lowercase if the buffer was parsed with
+     * HTTP_OPT_NOMUTATE.
+     * the empty values are not stored by the parser, so an empty view means
+     * that the header was not found.
+     */
+    std::string_view find( std::string_view name ) const noexcept
+    {
+        for( uint8_t i = 0; i < h_->nheader; i++ )
+        {
+            field_view f = ( *this )[i];
+
+            if( f.first.size() == name.size() && iequal( f.first, name ) ){
+                return f.second;
+            }
+        }
+        return std::string_view();
+    }
+
+
+private:
+    static unsigned char lower( unsigned char c ) noexcept {
+        return ( c >= 'A' && c <= 'Z' ) ? c | 0x20 : c;
+    }
+
+    static bool iequal( std::string_view a, std::string_view b ) noexcept
+    {
+        for( size_t i = 0; i < b.size(); i++ )
+        {
+            if( lower( (unsigned char)a[i] ) != lower( (unsigned char)b[i] ) ){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const http_t *h_;
+    const char *buf_;
+};
+
+
+} // namespace http
+
+#endif
@@ -0,0 +1,177 @@
+#include "test_http.h"
+
+
+typedef struct {
+    char method[16];
+    char target[64];
+    size_t nheader;
+    size_t ncomplete;
+    // abort at the header of this index
+    size_t abort_at;
+    char last[64];
+} sax_t;
+
+
+static void copy( char *dst, size_t size, const char *str, size_t len )
+{
+    assert( len < size );
+    memcpy( dst, str, len );
+    dst[len] = 0;
+}
+
+
+static int on_method( http_t *h, void *udata, const char *str, size_t len )
+{
+    sax_t *s = (sax_t*)udata;
+
+    (void)h;
+    copy( s->method, sizeof( s->method ), str, len );
+    return 0;
+}
+
+
+static int on_target( http_t *h, void *udata, const char *str, size_t len )
+{
+    sax_t *s = (sax_t*)udata;
+
+    (void)h;
+    copy( s->target, sizeof( s->target ), str, len );
+    return 0;
+}
+
+
+static int on_header( http_t *h, void *udata, const char *key, size_t klen,
+                      const char *val, size_t vlen )
+{
+    sax_t *s = (sax_t*)udata;
+
+    (void)h;
+    assert( klen == 5 && memcmp( key, "x-hdr", 5 ) == 0 );
+    copy( s->last, sizeof( s->last ), val, vlen );
+    return s->nheader++ == s->abort_at;
+}
+
+
+static int on_headers_complete( http_t *h, void *udata )
+{
+    (void)h;
+    ((sax_t*)udata)->ncomplete++;
+    return 0;
+}
+
+
+static const http_cb_t CB = {
+    .on_method = on_method,
+    .on_target = on_target,
+    .on_header = on_header,
+    .on_headers_complete = on_headers_complete
+};
+
+
+// 1000 headers that exceed UINT8_MAX slots
+#define NHEADER 1000
+
+static char *make_request( size_t *len )
+{
+    char *buf = malloc( 64 + NHEADER * 32 );
+    size_t i = 0;
+    int n = 0;
+
+    n = sprintf( buf, "POST /foo/bar?baz=qux HTTP/1.1\r\n" );
+    for( i = 0; i < NHEADER; i++ ){
+        n += sprintf( buf + n, "X-Hdr: value-%zu\r\n", i );
+    }
+    n += sprintf( buf + n, "X-Hdr:\r\n\r\n" );
+    *len = (size_t)n;
+
+    return buf;
+}
+
+
+static void test_unbounded( void )
+{
+    size_t len = 0;
+    char *buf = make_request( &len );
+    http_t *r = http_alloc(0);
+    sax_t s = { .abort_at = SIZE_MAX };
+    size_t i = 0;
+    char c = 0;
+    int rc = HTTP_EAGAIN;
+
+    http_setcb( r, &CB, &s );
+    assert( http_parse_request( r, buf, len, UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( strcmp( s.method, "POST" ) == 0 );
+    assert( strcmp( s.target, "/foo/bar?baz=qux" ) == 0 );
+    // the empty value is ignored
+    assert( s.nheader == NHEADER );
+    assert( strcmp( s.last, "value-999" ) == 0 );
+    assert( s.ncomplete == 1 );
+    assert( r->nheader == 0 && r->cur == len );
+    // not invoked again after done
+    assert( http_parse_request( r, buf, len, UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( s.ncomplete == 1 );
+
+    // http_init keeps the callbacks. feed 7 bytes at a time
+    http_init( r );
+    memset( &s, 0, sizeof( s ) );
+    s.abort_at = SIZE_MAX;
+    for( i = 7; rc == HTTP_EAGAIN; i += 7 )
+    {
+        if( i > len ){
+            i = len;
+        }
+        c = buf[i];
+        buf[i] = 0;
+        rc = http_parse_request( r, buf, i, UINT16_MAX, UINT16_MAX );
+        buf[i] = c;
+    }
+    assert( rc == HTTP_SUCCESS );
+    assert( strcmp( s.target, "/foo/bar?baz=qux" ) == 0 );
+    assert( s.nheader == NHEADER && s.ncomplete == 1 );
+
+    // abort
+    http_init( r );
+    memset( &s, 0, sizeof( s ) );
+    s.abort_at = 300;
+    assert( http_parse_request( r, buf, len, UINT16_MAX,
+                                UINT16_MAX ) == HTTP_ECALLBACK );
+    assert( s.nheader == 301 && s.ncomplete == 0 );
+
+    http_free( r );
+    free( buf );
+}
+
+
+static void test_response( void )
+{
+    char res[] = "HTTP/1.1 404 Not Found\r\n"
+                 "X-Hdr: a\r\n"
+                 "X-Hdr: b\r\n"
+                 "\r\n";
+    http_t *r = http_alloc(0);
+    sax_t s = { .abort_at = SIZE_MAX };
+
+    http_setcb( r, &CB, &s );
+    assert( http_parse_response( r, res, sizeof( res ) - 1,
+                                 UINT16_MAX ) == HTTP_SUCCESS );
+    assert( http_status( r ) == HTTP_NOT_FOUND );
+    assert( s.method[0] == 0 );
+    assert( strcmp( s.target, "Not Found" ) == 0 );
+    assert( s.nheader == 2 && strcmp( s.last, "b" ) == 0 );
+    assert( s.ncomplete == 1 );
+
+    http_free( r );
+}
+
+#ifdef TESTS
+
+int main(void)
+{
+    test_unbounded();
+    test_response();
+    return 0;
+}
+
+#endif
@@ -0,0 +1,281 @@
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../src/http.hpp"
+#include "../src/http_view.hpp"
+
+
+static const char *REQUESTS[] = {
+    "GET / HTTP/1.1\r\n\r\n",
+    "GET /foo/bar/baz?qux=quux HTTP/1.1\r\n"
+    "Host: example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64)\r\n"
+    "Accept: */*\r\n"
+    "X-Empty:  \r\n"
+    "X-Ows: \t value \t \r\n"
+    "\r\n",
+    "POST /api HTTP/1.0\n"
+    "Content-Length: 3\n"
+    "\n"
+    "abc",
+    "HEAD /foo HTTP/1.0\r\nHost: example.com\r\n\r\n",
+    "PUT /foo HTTP/1.0\r\n\r\n",
+    "DELETE /foo HTTP/1.1\r\nHost: a\r\n\r\n",
+    "OPTIONS * HTTP/1.1\r\n\r\n",
+    "CONNECT example.com:443 HTTP/1.1\r\n\r\n",
+    "TRACE / HTTP/1.1\r\n\r\n",
+    "GET /foo HTTP/0.9\r\n\r\n",
+    "GET /foo HTTP/0.9\r\nHost: example.com\r\n\r\n",
+    "GET /foo\r\n",
+    "GET /foo\n",
+    "POST /foo\r\n",
+    "GET /foo/bar/baz\r\nHost: example.com\r\n\r\n",
+    "GET /foo HTTP/2.0\r\n\r\n",
+    "GET /foo HTTP/1.1x\r\n\r\n",
+    "get /foo HTTP/1.1\r\n\r\n",
+    "PATCH /foo HTTP/1.1\r\n\r\n",
+    "GET /foo|bar HTTP/1.1\r\n\r\n",
+    "GET /foo HTTP/1.1\r\nHost example.com\r\n\r\n",
+    "GET /foo HTTP/1.1\r\nHost: exa\rmple.com\r\n\r\n",
+    "GET /foo HTTP/1.1\r\nX-Obs: caf\xc3\xa9\r\n\r\n",
+    "GET /foo HTTP/1.1\r\nA: 1\r\nB: 2\r\nC: 3\r\nD: 4\r\nE: 5\r\n\r\n",
+    "GET /foo HTTP/1.1\r\n"
+    "X-Long-Header-Name: 0123456789012345678901234567890123456789\r\n"
+    "\r\n",
+    "GET /0123456789012345678901234567890123456789 HTTP/1.1\r\n\r\n",
+    "GET /foo HTTP/1.1\r\nHost:\r\n\r\n",
+    "GET /foo HTTP/1.1\r\n\r",
+    NULL
+};
+
+static const char *RESPONSES[] = {
+    "HTTP/1.1 200 OK\r\n\r\n",
+    "HTTP/1.1 404 Not Found\r\n"
+    "Content-Type: text/html; charset=utf-8\r\n"
+    "Content-Length: 1234\r\n"
+    "Set-Cookie: a=b; Path=/; HttpOnly\r\n"
+    "\r\n",
+    "HTTP/1.0 301 Moved Permanently\nLocation: /bar\n\n",
+    "HTTP/0.9 200 OK\r\n\r\n",
+    "HTTP/1.1 200\r\n\r\n",
+    "HTTP/1.1 600 Bad\r\n\r\n",
+    "HTTP/1.1 20 OK\r\n\r\n",
+    "HTTP/2.0 200 OK\r\n\r\n",
+    "<html>simple-response</html>",
+    "HTTP/1.1 200 caf\xc3\xa9\r\n\r\n",
+    "HTTP/1.1 200 OK\r\nX: \x01\r\n\r\n",
+    "HTTP/1.1 200 OK\r\nServer: a\r\nDate: b\r\nVary: c\r\nAge: 1\r\n"
+    "Via: d\r\n\r\n",
+    NULL
+};
+
+// bytes that are substituted at each position of the samples
+static const char MUTATIONS[] = {
+    ' ', '\t', '\r', '\n', ':', '/', 'A', 'z', '0', '|', '"', '\x01',
+    '\x7f', '\x80', '\xff'
+};
+
+
+template<class P>
+static void compare( http_t *h, const char *cbuf, int crc,
+                     const http::parser<P> &p, const char *pbuf, int prc,
+                     size_t len )
+{
+    assert( crc == prc );
+    assert( h->phase == p.phase );
+    assert( h->cur == p.cur );
+    assert( h->head == p.head );
+    assert( h->protocol == p.protocol );
+    assert( h->nheader == p.nheader );
+    if( crc == HTTP_SUCCESS ){
+        assert( h->msg == p.msg );
+        assert( h->msglen == p.msglen );
+    }
+    for( uint8_t i = 0; i < h->nheader; i++ )
+    {
+        uintptr_t key, val;
+        uint16_t klen, vlen;
+
+        assert( http_getheader_at( h, &key, &klen, &val, &vlen, i ) == 0 );
+        assert( key == p.headers[i].key );
+        assert( klen == p.headers[i].klen );
+        assert( val == p.headers[i].val );
+        assert( vlen == p.headers[i].vlen );
+    }
+    // keys are converted to lowercase in place
+    assert( std::memcmp( cbuf, pbuf, len ) == 0 );
+}
+
+
+template<class P>
+static int cparse( http_t *h, char *buf, size_t len )
+{
+    if( P::request ){
+        return http_parse_request( h, buf, len, P::maxurilen, P::maxhdrlen );
+    }
+    return http_parse_response( h, buf, len, P::maxhdrlen );
+}
+
+
+/**
+ * parse the whole message at once and then at every split point, and
+ * compare the results of the C and C++ parser
+ */
+template<class P>
+static void check( const std::string &src )
+{
+    size_t len = src.size();
+    std::vector<char> cbuf( src.begin(), src.end() );
+    std::vector<char> pbuf( src.begin(), src.end() );
+    http_t *h = http_alloc( P::maxheader );
+    http::parser<P> p;
+    int crc, prc;
+
+    cbuf.push_back( 0 );
+    pbuf.push_back( 0 );
+
+    http_init( h );
+    crc = cparse<P>( h, cbuf.data(), len );
+    prc = p.parse( pbuf.data(), len );
+    compare( h, cbuf.data(), crc, p, pbuf.data(), prc, len );
+
+    for( size_t split = 1; split < len; split++ )
+    {
+        std::memcpy( cbuf.data(), src.data(), len );
+        std::memcpy( pbuf.data(), src.data(), len );
+        cbuf[split] = pbuf[split] = 0;
+        http_init( h );
+        p.init();
+
+        crc = cparse<P>( h, cbuf.data(), split );
+        prc = p.parse( pbuf.data(), split );
+        compare( h, cbuf.data(), crc, p, pbuf.data(), prc, split );
+        if( crc != HTTP_EAGAIN ){
+            continue;
+        }
+
+        cbuf[split] = pbuf[split] = src[split];
+        crc = cparse<P>( h, cbuf.data(), len );
+        prc = p.parse( pbuf.data(), len );
+        compare( h, cbuf.data(), crc, p, pbuf.data(), prc, len );
+    }
+
+    http_free( h );
+}
+
+
+template<class P>
+static void check_all( const char **samples )
+{
+    for(; *samples; samples++ )
+    {
+        std::string src( *samples );
+
+        check<P>( src );
+        for( size_t i = 0; i < src.size(); i++ )
+        {
+            for( char c : MUTATIONS ){
+                std::string mut( src );
+                mut[i] = c;
+                check<P>( mut );
+            }
+        }
+    }
+}
+
+
+static void test_differential( void )
+{
+    check_all<http::request_policy<>>( REQUESTS );
+    check_all<http::request_policy<true, 3, uint16_t, 16, 32>>( REQUESTS );
+    check_all<http::request_policy<true, 0, uintptr_t>>( REQUESTS );
+    check_all<http::response_policy<>>( RESPONSES );
+    check_all<http::response_policy<true, 2, uint16_t, 24>>( RESPONSES );
+}
+
+
+static void test_lenient( void )
+{
+    char req[] = "GET /foo|bar?q={\"a\"} HTTP/1.1\r\n"
+                 "X-Obs: caf\xc3\xa9\r\n"
+                 "\r\n";
+    char res[] = "HTTP/1.1 200 caf\xc3\xa9\r\n\r\n";
+    http::request_parser<true> sreq;
+    http::request_parser<false> lreq;
+    http::response_parser<true> sres;
+    http::response_parser<false> lres;
+
+    assert( sreq.parse( req, sizeof( req ) - 1 ) == HTTP_EBADURI );
+    assert( lreq.parse( req, sizeof( req ) - 1 ) == HTTP_SUCCESS );
+    assert( lreq.method() == HTTP_MGET && lreq.version() == HTTP_V11 );
+    assert( lreq.msglen == 16 && lreq.nheader == 1 );
+    assert( lreq.headers[0].vlen == 5 );
+
+    assert( sres.parse( res, sizeof( res ) - 1 ) == HTTP_EREASON );
+    assert( lres.parse( res, sizeof( res ) - 1 ) == HTTP_SUCCESS );
+    assert( lres.status() == HTTP_OK );
+}
+
+
+static void test_view( void )
+{
+    char req[] = "POST /foo?bar=baz HTTP/1.1\r\n"
+                 "Host: example.com\r\n"
+                 "X-Empty: \r\n"
+                 "Content-Length: 3\r\n"
+                 "\r\n"
+                 "abc";
+    char res[] = "HTTP/1.1 404 Not Found\r\n"
+                 "Server: libhttp\r\n"
+                 "\r\n";
+    http_t *h = http_alloc(4);
+    size_t n = 0;
+
+    assert( http_parse_request( h, req, sizeof( req ) - 1, UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    http::view v( h, req );
+
+    assert( v.version() == HTTP_V11 && v.code() == HTTP_MPOST );
+    assert( v.method() == "POST" );
+    assert( v.target() == "/foo?bar=baz" );
+    assert( v.size() == 2 );
+    for( auto [key, val] : v.headers() )
+    {
+        if( n++ == 0 ){
+            assert( key == "host" && val == "example.com" );
+        }
+        else {
+            assert( key == "content-length" && val == "3" );
+        }
+    }
+    assert( n == 2 );
+    assert( v.find( "Content-Length" ) == "3" );
+    assert( v.find( "HOST" ) == "example.com" );
+    assert( v.find( "x-empty" ).empty() );
+    assert( v.find( "hos" ).data() == nullptr );
+
+    http_init( h );
+    assert( http_parse_response( h, res, sizeof( res ) - 1,
+                                 UINT16_MAX ) == HTTP_SUCCESS );
+    http::view r( h, res );
+    assert( r.code() == HTTP_NOT_FOUND );
+    assert( r.reason() == "Not Found" );
+    assert( r[0] == http::field_view( "server", "libhttp" ) );
+
+    http_free( h );
+}
+
+
+#ifdef TESTS
+
+int main()
+{
+    test_differential();
+    test_lenient();
+    test_view();
+    return 0;
+}
+
+#endif
@@ -0,0 +1,113 @@
+/**
+ * differential test of the parsers: the samples, their split points, the
+ * limits of the header-length and the single byte mutations are parsed by
+ * the default parser and by the parser under the test, and the results
+ * must be the same.
+ */
+
+// bytes to replace each byte of the samples
+static const char DIFF_MUTATIONS[] = {
+    0, '\r', '\n', ' ', '\t', ':', 'A', '\x01', '\x7f', '\x80'
+};
+
+typedef struct {
+    /* parser under the test, http_parse_request and http_parse_response
+     * if NULL */
+    int (*request)( http_t *h, char *buf, size_t len, uint16_t maxurilen,
+                    uint16_t maxhdrlen );
+    int (*response)( http_t *h, char *buf, size_t len, uint16_t maxhdrlen );
+    /* HTTP_ENGINE_* under the test, or -1 for the default engine */
+    int engine;
+    /* the header-length limits from 0 to nlimit - 1 are checked */
+    uint16_t nlimit;
+} diff_t;
+
+
+static int diff_parse( const diff_t *d, http_t *h, int isreq, char *buf,
+                       size_t len, uint16_t maxhdrlen )
+{
+    http_init( h );
+    if( isreq ){
+        return d && d->request ?
+               d->request( h, buf, len, UINT16_MAX, maxhdrlen ) :
+               http_parse_request( h, buf, len, UINT16_MAX, maxhdrlen );
+    }
+    return d && d->response ? d->response( h, buf, len, maxhdrlen ) :
+                              http_parse_response( h, buf, len, maxhdrlen );
+}
+
+
+static void diff_compare( const diff_t *d, http_t *a, http_t *b, int isreq,
+                          const char *src, size_t len, uint16_t maxhdrlen )
+{
+    static char x[8192], y[8192];
+    uintptr_t ak, av, bk, bv;
+    uint16_t akl, avl, bkl, bvl;
+    uint32_t ah, bh;
+    int rc = 0;
+    uint8_t i = 0;
+
+    memcpy( x, src, len );
+    x[len] = 0;
+    memcpy( y, src, len );
+    y[len] = 0;
+
+    rc = diff_parse( NULL, a, isreq, x, len, maxhdrlen );
+    assert( diff_parse( d, b, isreq, y, len, maxhdrlen ) == rc );
+    assert( memcmp( x, y, len ) == 0 );
+    assert( a->cur == b->cur && a->head == b->head );
+    assert( a->phase == b->phase );
+    assert( a->protocol == b->protocol );
+    assert( a->msg == b->msg && a->msglen == b->msglen );
+    assert( a->nheader == b->nheader );
+    if( rc == HTTP_SUCCESS ){
+        assert( a->key == b->key && a->klen == b->klen );
+    }
+    for(; i < a->nheader; i++ )
+    {
+        assert( http_getheader_at( a, &ak, &akl, &av, &avl, i ) == 0 );
+        assert( http_getheader_at( b, &bk, &bkl, &bv, &bvl, i ) == 0 );
+        assert( ak == bk && akl == bkl && av == bv && avl == bvl );
+        assert( http_gethash_at( a, &ah, i ) == 0 );
+        assert( http_gethash_at( b, &bh, i ) == 0 );
+        assert( ah == bh );
+    }
+}
+
+
+static void test_diff( const diff_t *d, int isreq, const char *src,
+                       uint8_t opts, uint8_t maxheader )
+{
+    http_t *a = http_alloc( maxheader );
+    http_t *b = http_alloc( maxheader );
+    static char buf[8192];
+    size_t len = strlen( src );
+    size_t i = 0;
+    size_t j = 0;
+
+    http_setopt( a, opts );
+    http_setopt( b, opts );
+    if( d->engine >= 0 ){
+        http_setengine( b, d->engine );
+    }
+    // the whole sample and split points
+    for( i = 0; i <= len; i++ ){
+        diff_compare( d, a, b, isreq, src, i, UINT16_MAX );
+    }
+    // limits
+    for( i = 0; i < d->nlimit; i++ ){
+        diff_compare( d, a, b, isreq, src, len, (uint16_t)i );
+    }
+    // single byte mutations
+    for( i = 0; i < len; i++ )
+    {
+        for( j = 0; j < sizeof( DIFF_MUTATIONS ); j++ ){
+            memcpy( buf, src, len );
+            buf[i] = DIFF_MUTATIONS[j];
+            diff_compare( d, a, b, isreq, buf, len, UINT16_MAX );
+        }
+    }
+
+    http_free( a );
+    http_free( b );
+}
@@ -0,0 +1,90 @@
+#include "test_http.h"
+#include "test_diff.h"
+
+
+static const char *REQS[] = {
+    "GET / HTTP/1.1\r\n\r\n",
+    "GET /foo HTTP/1.1\r\n"
+    "Host: example.com:8080\r\n"
+    "Content-Type:text/plain  \r\n"
+    "X-Empty: \t\r\n"
+    "Accept: */*\n"
+    "Referer: http://example.com:8080/a:b:c\r\n"
+    "X-Long-Header-Name-Over-16:\t1 2\t3 \r\n"
+    "\r\n",
+    "POST /bar HTTP/1.0\n"
+    "Content-Length: 3\n"
+    "X-Empty:\n"
+    ":\n"
+    "\n"
+    "abc",
+    "GET /baz\r\n"
+};
+
+static const char *RESS[] = {
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Length: 0\r\n"
+    "Set-Cookie: a=b; Path=/; Expires=Wed, 21 Oct 2015 07:28:00 GMT\r\n"
+    "\r\n",
+    "HTTP/1.0 404 Not Found\n"
+    "Server:x\n"
+    "\n"
+};
+
+// the engines against the default parser
+static const diff_t ENGINES[] = {
+    { .request = NULL, .response = NULL, .engine = HTTP_ENGINE_INDEX,
+      .nlimit = 80 },
+    { .request = NULL, .response = NULL, .engine = HTTP_ENGINE_DFA,
+      .nlimit = 80 }
+};
+
+
+static void test_sample( const diff_t *d )
+{
+    size_t i = 0;
+
+    for( i = 0; i < sizeof( REQS ) / sizeof( REQS[0] ); i++ ){
+        test_diff( d, 1, REQS[i], 0, 4 );
+        test_diff( d, 1, REQS[i], HTTP_OPT_NOMUTATE, 8 );
+    }
+    for( i = 0; i < sizeof( RESS ) / sizeof( RESS[0] ); i++ ){
+        test_diff( d, 0, RESS[i], 0, 1 );
+        test_diff( d, 0, RESS[i], HTTP_OPT_NOMUTATE, 8 );
+    }
+}
+
+
+/**
+ * heads across the blocks of 64 bytes
+ */
+static void test_large( const diff_t *d )
+{
+    static char buf[8192];
+    size_t len = 0;
+    int i = 0;
+
+    len = (size_t)sprintf( buf, "GET /large HTTP/1.1\r\n" );
+    for(; i < 60; i++ ){
+        len += (size_t)sprintf( buf + len, "X-Header-%d:%*s%s:%d\r\n", i,
+                                i % 5, "", "value", i * 7919 );
+    }
+    sprintf( buf + len, "\r\n" );
+    test_diff( d, 1, buf, 0, 64 );
+    test_diff( d, 1, buf, HTTP_OPT_NOMUTATE, 32 );
+}
+
+#ifdef TESTS
+
+int main(void)
+{
+    size_t i = 0;
+
+    for(; i < sizeof( ENGINES ) / sizeof( ENGINES[0] ); i++ ){
+        test_sample( &ENGINES[i] );
+        test_large( &ENGINES[i] );
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,85 @@
+#include "test_http.h"
+#include "test_diff.h"
+
+
+static const char *REQS[] = {
+    "GET / HTTP/1.1\r\n\r\n",
+    "GET /foo HTTP/1.1\r\n"
+    "Host: example.com\r\n"
+    "Content-Type:text/plain  \r\n"
+    "X-Empty: \t\r\n"
+    "Accept: */*\n"
+    "X-Long-Header-Name-Over-16:\t1 2\t3 \r\n"
+    "\r\n",
+    "POST /bar HTTP/1.0\n"
+    "Content-Length: 3\n"
+    "X-Empty:\n"
+    "\n"
+    "abc",
+    "GET /baz\r\n"
+};
+
+static const char *RESS[] = {
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Length: 0\r\n"
+    "Set-Cookie: a=b; Path=/\r\n"
+    "\r\n",
+    "HTTP/1.0 404 Not Found\n"
+    "Server:x\n"
+    "\n"
+};
+
+// the fast path against the default parser
+static const diff_t FAST = {
+    .request = http_parse_request_fast,
+    .response = http_parse_response_fast,
+    .engine = -1,
+    .nlimit = 40
+};
+
+
+static void test_sample( void )
+{
+    size_t i = 0;
+
+    for( i = 0; i < sizeof( REQS ) / sizeof( REQS[0] ); i++ ){
+        test_diff( &FAST, 1, REQS[i], 0, 3 );
+        test_diff( &FAST, 1, REQS[i], HTTP_OPT_NOMUTATE, 3 );
+    }
+    for( i = 0; i < sizeof( RESS ) / sizeof( RESS[0] ); i++ ){
+        test_diff( &FAST, 0, RESS[i], 0, 3 );
+        test_diff( &FAST, 0, RESS[i], HTTP_OPT_NOMUTATE, 3 );
+    }
+}
+
+
+static void test_resume( void )
+{
+    char buf[] = "GET /foo HTTP/1.1\r\n"
+                 "Host: example.com\r\n"
+                 "\r\n";
+    size_t len = strlen( buf );
+    http_t *r = http_alloc(2);
+
+    // the head is not complete
+    assert( http_parse_request_fast( r, buf, 30, UINT16_MAX,
+                                     UINT16_MAX ) == HTTP_EAGAIN );
+    assert( r->phase == HTTP_PHASE_HVAL );
+    assert( http_parse_request_fast( r, buf, len, UINT16_MAX,
+                                     UINT16_MAX ) == HTTP_SUCCESS );
+    assert( r->phase == HTTP_PHASE_DONE );
+    assert( r->nheader == 1 );
+
+    http_free( r );
+}
+
+#ifdef TESTS
+
+int main(void)
+{
+    test_sample();
+    test_resume();
+    return 0;
+}
+
+#endif
@@ -0,0 +1,174 @@
+#include "test_http.h"
+#include <errno.h>
+
+
+static const char *NAMES[] = {
+    "host", "content-length", "cookie"
+};
+
+
+static void test_init( void )
+{
+    const char *upper[] = { "host", "Cookie" };
+    const char *sep[] = { "x:y" };
+    const char *empty[] = { "" };
+    const char *dup[] = { "host", "cookie", "host" };
+    const char *many[HTTP_FILTER_SIZE / 2 + 1];
+    http_filter_t f;
+    size_t i = 0;
+
+    for(; i < HTTP_FILTER_SIZE / 2 + 1; i++ ){
+        many[i] = "x";
+    }
+    assert( http_filter_init( &f, upper, 2 ) == -1 && errno == EINVAL );
+    assert( http_filter_init( &f, sep, 1 ) == -1 && errno == EINVAL );
+    assert( http_filter_init( &f, empty, 1 ) == -1 && errno == EINVAL );
+    assert( http_filter_init( &f, many, HTTP_FILTER_SIZE / 2 + 1 ) == -1 &&
+            errno == ENOSPC );
+    assert( http_filter_init( &f, many, HTTP_FILTER_SIZE / 2 ) == 0 );
+    assert( f.nname == 1 );
+
+    assert( http_filter_init( &f, dup, 3 ) == 0 );
+    assert( f.nname == 2 );
+    assert( http_filter_lookup( &f, "host", 4 ) == 0 );
+    assert( http_filter_lookup( &f, "cookie", 6 ) == 1 );
+    assert( http_filter_lookup( &f, "hosts", 5 ) == -1 );
+    assert( http_filter_lookup( &f, "", 0 ) == -1 );
+}
+
+
+static void test_filter( void )
+{
+    char req[] = "GET /foo HTTP/1.1\r\n"
+                 "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit\r\n"
+                 "Accept: text/html,application/xhtml+xml;q=0.9,*/*;q=0.8\r\n"
+                 "Host: example.com\r\n"
+                 "Accept-Language: en-US,en;q=0.5\r\n"
+                 "Accept-Encoding: gzip, deflate\r\n"
+                 "Cookie: a=b; c=d\r\n"
+                 "X-Empty:\r\n"
+                 "Content-Length: 0\r\n"
+                 "DNT: 1\r\n"
+                 "\r\n";
+    size_t len = sizeof( req ) - 1;
+    char *buf = malloc( len + 1 );
+    http_t *r = http_alloc(3);
+    http_filter_t f;
+    uintptr_t key, val;
+    uint16_t klen, vlen;
+    size_t i = 0;
+    char c = 0;
+    int rc = HTTP_EAGAIN;
+
+    assert( http_filter_init( &f, NAMES, 3 ) == 0 );
+
+    // too many headers without the filter
+    memcpy( buf, req, len + 1 );
+    assert( http_parse_request( r, buf, len, UINT16_MAX,
+                                UINT16_MAX ) == HTTP_ENHDR );
+
+    // only 3 headers take the slots
+    http_setfilter( r, &f );
+    http_init( r );
+    memcpy( buf, req, len + 1 );
+    assert( http_parse_request( r, buf, len, UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( r->cur == len );
+    assert( r->nheader == 3 );
+    assert( http_getheader_at( r, &key, &klen, &val, &vlen, 0 ) == 0 );
+    assert( klen == 4 && memcmp( buf + key, "host", 4 ) == 0 );
+    assert( vlen == 11 && memcmp( buf + val, "example.com", 11 ) == 0 );
+    assert( http_getheader_at( r, &key, &klen, &val, &vlen, 1 ) == 0 );
+    assert( klen == 6 && memcmp( buf + key, "cookie", 6 ) == 0 );
+    assert( http_getheader_at( r, &key, &klen, &val, &vlen, 2 ) == 0 );
+    assert( klen == 14 && memcmp( buf + val, "0", 1 ) == 0 );
+
+    // byte by byte
+    http_init( r );
+    memcpy( buf, req, len + 1 );
+    for( i = 1; rc == HTTP_EAGAIN && i <= len; i++ ){
+        c = buf[i];
+        buf[i] = 0;
+        rc = http_parse_request( r, buf, i, UINT16_MAX, UINT16_MAX );
+        buf[i] = c;
+    }
+    assert( rc == HTTP_SUCCESS );
+    assert( r->cur == len && r->nheader == 3 );
+
+    // skipped headers are still validated
+    http_init( r );
+    memcpy( buf, req, len + 1 );
+    buf[strstr( buf, "Mozilla" ) - buf] = 0x7f;
+    assert( http_parse_request( r, buf, len, UINT16_MAX,
+                                UINT16_MAX ) == HTTP_EHDRFMT );
+    http_init( r );
+    memcpy( buf, req, len + 1 );
+    buf[strstr( buf, "DNT: 1" ) - buf + 7] = 'x';
+    assert( http_parse_request( r, buf, len, UINT16_MAX,
+                                UINT16_MAX ) == HTTP_EHDRFMT );
+    http_init( r );
+    memcpy( buf, req, len + 1 );
+    assert( http_parse_request( r, buf, len, UINT16_MAX,
+                                32 ) == HTTP_EHDRLEN );
+
+    // too many filtered headers
+    http_free( r );
+    r = http_alloc(2);
+    http_setfilter( r, &f );
+    memcpy( buf, req, len + 1 );
+    assert( http_parse_request( r, buf, len, UINT16_MAX,
+                                UINT16_MAX ) == HTTP_ENHDR );
+
+    http_free( r );
+    free( buf );
+}
+
+/**
+ * the skipped headers are accepted as well as the headers in the slots
+ */
+static void test_length( void )
+{
+    const char *reqs[] = {
+        "GET / HTTP/1.1\r\nX-Pad: value        \r\nHost: x\r\n\r\n",
+        "GET / HTTP/1.1\r\nX-Pad:        \r\n\r\n",
+        "GET / HTTP/1.1\r\nX-Padding:\t \t\r\nHost: x\r\n\r\n"
+    };
+    http_t *r = http_alloc(4);
+    http_filter_t f;
+    char buf[128];
+    size_t len = 0;
+    size_t i = 0;
+    uint16_t maxhdrlen = 2;
+    int rc = 0;
+
+    assert( http_filter_init( &f, NAMES, 3 ) == 0 );
+    for(; i < sizeof( reqs ) / sizeof( reqs[0] ); i++ )
+    {
+        len = strlen( reqs[i] );
+        for( maxhdrlen = 2; maxhdrlen < 24; maxhdrlen++ ){
+            http_setfilter( r, NULL );
+            http_init( r );
+            memcpy( buf, reqs[i], len + 1 );
+            rc = http_parse_request( r, buf, len, UINT16_MAX, maxhdrlen );
+            http_setfilter( r, &f );
+            http_init( r );
+            memcpy( buf, reqs[i], len + 1 );
+            assert( http_parse_request( r, buf, len, UINT16_MAX,
+                                        maxhdrlen ) == rc );
+        }
+    }
+
+    http_free( r );
+}
+
+#ifdef TESTS
+
+int main(void)
+{
+    test_init();
+    test_filter();
+    test_length();
+    return 0;
+}
+
+#endif
@@ -0,0 +1,318 @@
+#include "test_http.h"
+
+
+static const char *REQS[] = {
+    "GET / HTTP/1.1\r\n\r\n",
+    "GET /foo HTTP/1.1\r\n"
+    "Host: example.com\r\n"
+    "Content-Type:text/plain  \r\n"
+    "X-Empty: \t\r\n"
+    "Accept: */*\n"
+    "X-Long-Header-Name-Over-16:\t1 2\t3 \r\n"
+    "\r\n",
+    "POST /bar HTTP/1.0\n"
+    "Content-Length: 3\n"
+    "X-Empty:\n"
+    "\n"
+};
+
+
+static int parse( http_t *r, char *buf, size_t len, uint8_t opts )
+{
+    http_init( r );
+    http_setopt( r, opts );
+    return http_parse_request( r, buf, len, UINT16_MAX, UINT16_MAX );
+}
+
+
+/**
+ * the finalized slots and buffer are the same as the default mode
+ */
+static void test_finalize( uint8_t opts )
+{
+    http_t *r = http_alloc(8);
+    http_t *e = http_alloc(8);
+    char a[512], b[512];
+    uintptr_t key, val, ekey, eval;
+    uint16_t klen, vlen, eklen, evlen;
+    uint32_t hash, ehash;
+    size_t len = 0;
+    size_t i = 0;
+    uint8_t j = 0;
+
+    for(; i < sizeof( REQS ) / sizeof( REQS[0] ); i++ )
+    {
+        len = strlen( REQS[i] );
+        memcpy( a, REQS[i], len + 1 );
+        memcpy( b, REQS[i], len + 1 );
+        assert( parse( e, a, len, opts ) == HTTP_SUCCESS );
+
+        // byte by byte
+        for( j = 0; j < len; j++ ){
+            b[j] = 0;
+            assert( parse( r, b, j, opts|HTTP_OPT_LAZY ) == HTTP_EAGAIN );
+            b[j] = REQS[i][j];
+        }
+        assert( parse( r, b, len, opts|HTTP_OPT_LAZY ) == HTTP_SUCCESS );
+        assert( r->cur == e->cur && r->head == e->head );
+        assert( r->protocol == e->protocol );
+        // the lines are not split yet
+        for( j = 0; j < r->nheader; j++ ){
+            assert( http_getheader_at( r, &key, &klen, &val, &vlen, j ) == 0 );
+            assert( val == 0 && vlen == 0 );
+        }
+        assert( memcmp( a, b, len ) == 0 || !( opts & HTTP_OPT_NOMUTATE ) );
+
+        assert( http_finalize( r, b ) == HTTP_SUCCESS );
+        assert( http_finalize( r, b ) == HTTP_SUCCESS );
+        assert( r->nheader == e->nheader );
+        assert( memcmp( a, b, len ) == 0 );
+        for( j = 0; j < r->nheader; j++ ){
+            assert( http_getheader_at( r, &key, &klen, &val, &vlen, j ) == 0 );
+            assert( http_getheader_at( e, &ekey, &eklen, &eval, &evlen,
+                                       j ) == 0 );
+            assert( key == ekey && klen == eklen );
+            assert( val == eval && vlen == evlen );
+            assert( http_gethash_at( r, &hash, j ) == 0 );
+            assert( http_gethash_at( e, &ehash, j ) == 0 );
+            assert( hash == ehash );
+        }
+    }
+
+    http_free( r );
+    http_free( e );
+}
+
+
+static void test_access( void )
+{
+    char buf[] = "GET /foo HTTP/1.1\r\n"
+                 "Host: example.com\r\n"
+                 "X-Bad Key: 1\r\n"
+                 "Content-Type: text/plain\r\n"
+                 "\r\n";
+    http_t *r = http_alloc(3);
+    uintptr_t key, val;
+    uint16_t klen, vlen;
+    uint32_t hash;
+
+    http_setopt( r, HTTP_OPT_LAZY|HTTP_OPT_NOMUTATE );
+    assert( http_parse_request( r, buf, strlen( buf ), UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( r->nheader == 3 );
+
+    // the lines are matched without being split
+    assert( http_findheader( r, buf, "content-type", 12 ) == 2 );
+    assert( http_findheader( r, buf, "HOST", 4 ) == 0 );
+    assert( http_findheader( r, buf, "hos", 3 ) == -1 );
+    assert( http_findheader( r, buf, "content-typ", 11 ) == -1 );
+
+    // split on the first access
+    assert( http_getheader_lazy( r, buf, &key, &klen, &val, &vlen, 2 ) == 0 );
+    assert( klen == 12 && memcmp( buf + key, "Content-Type", 12 ) == 0 );
+    assert( vlen == 10 && memcmp( buf + val, "text/plain", 10 ) == 0 );
+    assert( http_gethash_at( r, &hash, 2 ) == 0 );
+    assert( hash == http_hash( "content-type", 12 ) );
+    assert( http_findheader( r, buf, "content-type", 12 ) == 2 );
+    assert( http_getheader_lazy( r, buf, &key, &klen, &val, &vlen, 2 ) == 0 );
+    assert( klen == 12 && vlen == 10 );
+    assert( http_getheader_lazy( r, buf, &key, &klen, &val, &vlen, 3 ) == -1 );
+
+    // the invalid line is detected on access or by http_finalize
+    assert( http_getheader_lazy( r, buf, &key, &klen, &val, &vlen,
+                                 1 ) == HTTP_EHDRFMT );
+    assert( http_finalize( r, buf ) == HTTP_EHDRFMT );
+
+    http_free( r );
+}
+
+
+static void test_error( void )
+{
+    http_t *r = http_alloc(2);
+    char buf[256];
+    uintptr_t key, val;
+    uint16_t klen, vlen;
+    const char *invalid[] = {
+        "Host example.com\r\n",
+        ": example.com\r\n",
+        "Host: example\r.com\r\n",
+        "Host: example\x01.com\r\n",
+        "Host: example\x80.com\r\n",
+        " Host: example.com\r\n",
+        "\rHost: example.com\r\n"
+    };
+    size_t i = 0;
+
+    http_setopt( r, HTTP_OPT_LAZY );
+    for(; i < sizeof( invalid ) / sizeof( invalid[0] ); i++ )
+    {
+        snprintf( buf, sizeof( buf ), "GET / HTTP/1.1\r\n%s\r\n", invalid[i] );
+        http_init( r );
+        assert( http_parse_request( r, buf, strlen( buf ), UINT16_MAX,
+                                    UINT16_MAX ) == HTTP_SUCCESS );
+        assert( r->nheader == 1 );
+        // an empty key is valid as well as the default mode
+        if( i == 1 ){
+            assert( http_finalize( r, buf ) == HTTP_SUCCESS );
+            continue;
+        }
+        assert( http_getheader_lazy( r, buf, &key, &klen, &val, &vlen,
+                                     0 ) == HTTP_EHDRFMT );
+        // the failed line is kept as it was
+        assert( http_getheader_lazy( r, buf, &key, &klen, &val, &vlen,
+                                     0 ) == HTTP_EHDRFMT );
+        assert( i < 2 || i > 4 || http_findheader( r, buf, "host", 4 ) == 0 );
+        assert( http_finalize( r, buf ) == HTTP_EHDRFMT );
+    }
+
+    // too many headers
+    strcpy( buf, "GET / HTTP/1.1\r\nA: 1\r\nB: 2\r\nC: 3\r\n\r\n" );
+    http_init( r );
+    assert( http_parse_request( r, buf, strlen( buf ), UINT16_MAX,
+                                UINT16_MAX ) == HTTP_ENHDR );
+
+    // header-length too large
+    strcpy( buf, "GET / HTTP/1.1\r\nHost: example.com\r\n\r\n" );
+    http_init( r );
+    assert( http_parse_request( r, buf, strlen( buf ), UINT16_MAX,
+                                16 ) == HTTP_EHDRLEN );
+    http_init( r );
+    assert( http_parse_request( r, buf, 30, UINT16_MAX, 16 ) == HTTP_EAGAIN );
+    http_init( r );
+    assert( http_parse_request( r, buf, 34, UINT16_MAX,
+                                16 ) == HTTP_EHDRLEN );
+    http_init( r );
+    assert( http_parse_request( r, buf, strlen( buf ), UINT16_MAX,
+                                17 ) == HTTP_SUCCESS );
+
+    // not done
+    http_init( r );
+    assert( http_parse_request( r, buf, 20, UINT16_MAX,
+                                UINT16_MAX ) == HTTP_EAGAIN );
+    assert( http_finalize( r, buf ) == HTTP_EAGAIN );
+
+    http_free( r );
+}
+
+/**
+ * the limits of the lines are the same as the default mode
+ */
+static void test_limit( uint8_t opts )
+{
+    const char *reqs[] = {
+        "GET / HTTP/1.1\r\nA:\r\nB:\r\nHost: x\r\n\r\n",
+        "GET / HTTP/1.1\r\nA: 1\r\nB: \t\r\nC: 3\r\nD:\r\n\r\n",
+        "GET / HTTP/1.1\r\nA: 1\r\nB: 2\r\nC:\r\n\r\n",
+        "GET / HTTP/1.1\r\nA:\r\nB\r\nC: 3\r\nD: 4\r\n\r\n",
+        "GET / HTTP/1.1\r\nHost: example.com      \r\n\r\n",
+        "GET / HTTP/1.1\r\nHost: example.com \t \r\nA: 1234567890123\r\n"
+        "\r\n",
+        "GET / HTTP/1.1\r\nHost:            \r\n\r\n",
+        // the empty hval is checked by the key-length only
+        "HEAD HEAD HTTP/1.1\nX-E: \r\n\r\n",
+        "GET / HTTP/1.1\r\nX-Empty-Value:\t\t \r\nA: 1\r\n\r\n"
+    };
+    char a[256], b[256];
+    size_t len = 0;
+    size_t i = 0;
+    uint8_t maxheader = 0;
+    uint16_t maxhdrlen = 0;
+    int rc = 0;
+
+    for(; i < sizeof( reqs ) / sizeof( reqs[0] ); i++ )
+    {
+        for( maxheader = 0; maxheader < 4; maxheader++ )
+        {
+            http_t *r = http_alloc( maxheader );
+            http_t *e = http_alloc( maxheader );
+
+            for( maxhdrlen = 2; maxhdrlen < 19; maxhdrlen++ ){
+                len = strlen( reqs[i] );
+                memcpy( a, reqs[i], len + 1 );
+                memcpy( b, reqs[i], len + 1 );
+                http_init( e );
+                http_setopt( e, opts );
+                rc = http_parse_request( e, a, len, UINT16_MAX, maxhdrlen );
+                http_init( r );
+                http_setopt( r, opts|HTTP_OPT_LAZY );
+                assert( http_parse_request( r, b, len, UINT16_MAX,
+                                            maxhdrlen ) == rc );
+                if( rc == HTTP_SUCCESS ){
+                    assert( http_finalize( r, b ) == HTTP_SUCCESS );
+                    assert( r->nheader == e->nheader );
+                    assert( memcmp( a, b, len ) == 0 );
+                }
+            }
+            http_free( r );
+            http_free( e );
+        }
+    }
+}
+
+/**
+ * the trailing OWS over the uint16_t length of the slot: the lines are
+ * UINT16_MAX + 3 bytes
+ */
+static void test_ows( uint8_t opts )
+{
+    const char *lines[] = { "X-A: v", "X-B:" };
+    char *a = malloc( UINT16_MAX + 64 );
+    char *b = malloc( UINT16_MAX + 64 );
+    http_t *r = http_alloc(2);
+    http_t *e = http_alloc(2);
+    uintptr_t key, val, ekey, eval;
+    uint16_t klen, vlen, eklen, evlen;
+    size_t len = 0;
+    size_t i = 0;
+    uint8_t j = 0;
+
+    for(; i < sizeof( lines ) / sizeof( lines[0] ); i++ )
+    {
+        len = (size_t)sprintf( a, "GET / HTTP/1.1\r\n%s", lines[i] );
+        memset( a + len, ' ', UINT16_MAX + 3 - strlen( lines[i] ) );
+        len += UINT16_MAX + 3 - strlen( lines[i] );
+        len += (size_t)sprintf( a + len, "\r\nB: 1\r\n\r\n" );
+        memcpy( b, a, len + 1 );
+
+        http_init( e );
+        http_setopt( e, opts );
+        assert( http_parse_request( e, a, len, UINT16_MAX,
+                                    UINT16_MAX ) == HTTP_SUCCESS );
+        http_init( r );
+        http_setopt( r, opts|HTTP_OPT_LAZY );
+        assert( http_parse_request( r, b, len, UINT16_MAX,
+                                    UINT16_MAX ) == HTTP_SUCCESS );
+        assert( http_finalize( r, b ) == HTTP_SUCCESS );
+        assert( r->nheader == e->nheader );
+        for( j = 0; j < r->nheader; j++ ){
+            assert( http_getheader_at( r, &key, &klen, &val, &vlen, j ) == 0 );
+            assert( http_getheader_at( e, &ekey, &eklen, &eval, &evlen,
+                                       j ) == 0 );
+            assert( key == ekey && klen == eklen );
+            assert( val == eval && vlen == evlen );
+        }
+    }
+
+    free( (void*)a );
+    free( (void*)b );
+    http_free( r );
+    http_free( e );
+}
+
+#ifdef TESTS
+
+int main(void)
+{
+    test_finalize( 0 );
+    test_finalize( HTTP_OPT_NOMUTATE );
+    test_access();
+    test_error();
+    test_limit( 0 );
+    test_limit( HTTP_OPT_NOMUTATE );
+    test_ows( 0 );
+    test_ows( HTTP_OPT_NOMUTATE );
+    return 0;
+}
+
+#endif
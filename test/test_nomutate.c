@@ -0,0 +1,118 @@
+#include "test_http.h"
+#include <sys/mman.h>
+
+
+static void test_strcaseeq( void )
+{
+    char a[64], b[64];
+    size_t len = 0;
+    size_t i = 0;
+
+    for( i = 0; i < sizeof( a ); i++ ){
+        a[i] = (char)( 'a' + i % 26 );
+        b[i] = (char)( 'A' + i % 26 );
+    }
+    for(; len <= sizeof( a ); len++ )
+    {
+        assert( http_strcaseeq( a, b, len ) );
+        // a difference at every position
+        for( i = 0; i < len; i++ ){
+            char c = b[i];
+            b[i] = '@';
+            assert( !http_strcaseeq( a, b, len ) );
+            b[i] = c;
+        }
+    }
+    // only the ASCII letters are folded
+    assert( !http_strcaseeq( "[\\]^_`", "{|}~\x7f\x80", 6 ) );
+    assert( !http_strcaseeq( "\xc0\xc1\xc2\xc3\xc4\xc5\xc6\xc7\xc8\xc9\xca\xcb"
+                             "\xcc\xcd\xce\xcf",
+                             "\xe0\xe1\xe2\xe3\xe4\xe5\xe6\xe7\xe8\xe9\xea\xeb"
+                             "\xec\xed\xee\xef", 16 ) );
+    assert( http_hash( "Content-Length", 14 ) ==
+            http_hash( "content-length", 14 ) );
+    assert( http_hash( "Host", 4 ) != http_hash( "Hosts", 5 ) );
+}
+
+
+static void test_readonly( void )
+{
+    const char req[] = "GET /foo HTTP/1.1\r\n"
+                       "Host: example.com\r\n"
+                       "Content-Type: text/plain\r\n"
+                       "X-Long-Header-Name-Over-16: 1\r\n"
+                       "\r\n";
+    size_t len = sizeof( req ) - 1;
+    char *buf = mmap( NULL, 4096, PROT_READ|PROT_WRITE,
+                      MAP_PRIVATE|MAP_ANONYMOUS, -1, 0 );
+    http_t *r = http_alloc(4);
+    const char *names[] = { "host", "x-long-header-name-over-16" };
+    http_filter_t f;
+    uintptr_t key, val;
+    uint16_t klen, vlen;
+    uint32_t hash;
+    size_t i = 0;
+
+    assert( buf != MAP_FAILED );
+    memcpy( buf, req, len + 1 );
+    assert( mprotect( buf, 4096, PROT_READ ) == 0 );
+
+    http_setopt( r, HTTP_OPT_NOMUTATE );
+    assert( http_parse_request( r, buf, len, UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( r->nheader == 3 );
+    assert( memcmp( buf, req, len ) == 0 );
+
+    // keys are kept as is
+    assert( http_getheader_at( r, &key, &klen, &val, &vlen, 1 ) == 0 );
+    assert( klen == 12 && memcmp( buf + key, "Content-Type", 12 ) == 0 );
+    assert( http_gethash_at( r, &hash, 1 ) == 0 );
+    assert( hash == http_hash( "content-type", 12 ) );
+    assert( http_gethash_at( r, &hash, 3 ) == -1 );
+
+    assert( http_findheader( r, buf, "host", 4 ) == 0 );
+    assert( http_findheader( r, buf, "CONTENT-TYPE", 12 ) == 1 );
+    assert( http_findheader( r, buf, "x-long-header-name-over-16", 26 ) == 2 );
+    assert( http_findheader( r, buf, "x-long-header-name-over-17", 26 ) == -1 );
+    assert( http_findheader( r, buf, "content-typ", 11 ) == -1 );
+
+    // http_init keeps the options
+    http_init( r );
+    assert( r->opts == HTTP_OPT_NOMUTATE );
+
+    // byte by byte, the buffer is null-terminated at each length
+    for( i = 1; i <= len; i++ )
+    {
+        assert( mprotect( buf, 4096, PROT_READ|PROT_WRITE ) == 0 );
+        memcpy( buf, req, i );
+        buf[i] = 0;
+        assert( mprotect( buf, 4096, PROT_READ ) == 0 );
+        assert( http_parse_request( r, buf, i, UINT16_MAX, UINT16_MAX ) ==
+                ( i < len ? HTTP_EAGAIN : HTTP_SUCCESS ) );
+    }
+    assert( r->nheader == 3 );
+    assert( memcmp( buf, req, len ) == 0 );
+
+    // the filter matches the keys case-insensitively
+    assert( http_filter_init( &f, names, 2 ) == 0 );
+    http_setfilter( r, &f );
+    http_init( r );
+    assert( http_parse_request( r, buf, len, UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( r->nheader == 2 );
+    assert( http_findheader( r, buf, "X-Long-Header-Name-Over-16", 26 ) == 1 );
+
+    http_free( r );
+    munmap( buf, 4096 );
+}
+
+#ifdef TESTS
+
+int main(void)
+{
+    test_strcaseeq();
+    test_readonly();
+    return 0;
+}
+
+#endif
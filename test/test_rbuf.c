@@ -0,0 +1,162 @@
+#include "test_http.h"
+#include <errno.h>
+#include "../src/http_rbuf.h"
+
+
+static void feed( http_rbuf_t *b, const char *str, size_t len )
+{
+    size_t space = 0;
+    char *tail = NULL;
+
+    while( len )
+    {
+        tail = http_rbuf_reserve( b, &space );
+        assert( tail );
+        if( space > len ){
+            space = len;
+        }
+        memcpy( tail, str, space );
+        http_rbuf_commit( b, space );
+        str += space;
+        len -= space;
+    }
+}
+
+
+static void test_pipelined( void )
+{
+    const char pipelined[] =
+        "GET /foo HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "X-Empty:  \r\n"
+        "\r\n"
+        "POST /bar HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "Content-Length: 3\r\n"
+        "\r\n"
+        "baz"
+        "HEAD /qux HTTP/1.0\r\n"
+        "\r\n";
+    const char *str = pipelined;
+    size_t len = sizeof( pipelined ) - 1;
+    http_rbuf_t *b = http_rbuf_alloc( 8, 128 );
+    http_t *r = http_alloc(3);
+    uintptr_t key, val;
+    uint16_t klen, vlen;
+    int nreq = 0;
+    int rc;
+
+    // feed 5 bytes at a time
+    while( nreq < 3 )
+    {
+        if( len ){
+            size_t n = len > 5 ? 5 : len;
+            feed( b, str, n );
+            str += n;
+            len -= n;
+        }
+
+        rc = http_rbuf_parse_request( b, r, UINT16_MAX, UINT16_MAX );
+        if( rc == HTTP_EAGAIN ){
+            assert( len );
+            continue;
+        }
+        assert( rc == HTTP_SUCCESS );
+
+        switch( nreq++ ){
+            case 0:
+                assert( r->protocol == ( HTTP_MGET | HTTP_V11 ) );
+                assert( r->msglen == 4 );
+                assert( !memcmp( http_rbuf_msg( b ) + r->msg, "/foo", 4 ) );
+                assert( r->nheader == 1 );
+                http_rbuf_consume( b, r->cur );
+            break;
+
+            case 1:
+                assert( r->protocol == ( HTTP_MPOST | HTTP_V11 ) );
+                assert( !memcmp( http_rbuf_msg( b ) + r->msg, "/bar", 4 ) );
+                assert( r->nheader == 2 );
+                http_getheader_at( r, &key, &klen, &val, &vlen, 1 );
+                assert( !memcmp( http_rbuf_msg( b ) + key, "content-length",
+                                 klen ) );
+                assert( !memcmp( http_rbuf_msg( b ) + val, "3", vlen ) );
+                // wait for the body
+                while( http_rbuf_msglen( b ) < r->cur + 3 ){
+                    size_t n = len > 5 ? 5 : len;
+                    assert( n );
+                    feed( b, str, n );
+                    str += n;
+                    len -= n;
+                }
+                assert( !memcmp( http_rbuf_msg( b ) + r->cur, "baz", 3 ) );
+                http_rbuf_consume( b, r->cur + 3 );
+            break;
+
+            default:
+                assert( r->protocol == ( HTTP_MHEAD | HTTP_V10 ) );
+                assert( !memcmp( http_rbuf_msg( b ) + r->msg, "/qux", 4 ) );
+                assert( r->nheader == 0 );
+                http_rbuf_consume( b, r->cur );
+        }
+        http_init( r );
+    }
+
+    // all bytes are consumed
+    assert( len == 0 );
+    assert( b->head == 0 && b->len == 0 );
+    // never grows beyond the largest message
+    assert( b->size <= 128 );
+
+    http_free( r );
+    http_rbuf_free( b );
+}
+
+
+static void test_head_budget( void )
+{
+    const char req[] =
+        "GET /foo HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "User-Agent: libhttp\r\n"
+        "\r\n";
+    http_rbuf_t *b = http_rbuf_alloc( 4, 32 );
+    http_t *r = http_alloc(3);
+    size_t space = 0;
+    size_t i = 0;
+    char *tail = NULL;
+    int rc = HTTP_EAGAIN;
+
+    assert( !http_rbuf_alloc( 0, 32 ) && errno == EINVAL );
+    assert( !http_rbuf_alloc( 64, 32 ) && errno == EINVAL );
+
+    while( rc == HTTP_EAGAIN )
+    {
+        if( !( tail = http_rbuf_reserve( b, &space ) ) ){
+            break;
+        }
+        *tail = req[i++];
+        http_rbuf_commit( b, 1 );
+        rc = http_rbuf_parse_request( b, r, UINT16_MAX, UINT16_MAX );
+    }
+
+    // head budget exhausted
+    assert( rc == HTTP_EAGAIN );
+    assert( errno == ENOBUFS );
+    assert( b->size == 32 );
+    assert( http_rbuf_msglen( b ) == 32 );
+
+    http_free( r );
+    http_rbuf_free( b );
+}
+
+#ifdef TESTS
+
+int main(void)
+{
+    test_pipelined();
+    test_head_budget();
+    return 0;
+}
+
+#endif
+
@@ -0,0 +1,123 @@
+#include "test_http.h"
+
+
+static void test_request( void )
+{
+    char buf[] = "GET /foo HTTP/1.1\r\n"
+                 "Host: example.com\r\n"
+                 "\r\n";
+    size_t len = strlen( buf );
+    http_t *r = http_alloc(2);
+    uintptr_t key, val;
+    uint16_t klen, vlen;
+    size_t i = 0;
+
+    http_setopt( r, HTTP_OPT_REQLINE );
+    assert( http_parse_request( r, buf, len, UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( r->phase == HTTP_PHASE_HEADER );
+    assert( r->cur == 19 && r->head == 19 );
+    assert( r->protocol == ( HTTP_MGET|HTTP_V11 ) );
+    assert( r->msglen == 4 && memcmp( buf + r->msg, "/foo", 4 ) == 0 );
+    assert( r->nheader == 0 );
+
+    // resume the header parse
+    assert( http_parse_request( r, buf, len, UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( r->phase == HTTP_PHASE_DONE );
+    assert( r->cur == len );
+    assert( r->nheader == 1 );
+    assert( http_getheader_at( r, &key, &klen, &val, &vlen, 0 ) == 0 );
+    assert( klen == 4 && memcmp( buf + key, "host", 4 ) == 0 );
+
+    // byte by byte
+    for( i = 0; i <= len; i++ )
+    {
+        char c = buf[i];
+
+        http_init( r );
+        buf[i] = 0;
+        assert( http_parse_request( r, buf, i, UINT16_MAX, UINT16_MAX ) ==
+                ( i < 19 ? HTTP_EAGAIN : HTTP_SUCCESS ) );
+        assert( i < 19 || r->phase == HTTP_PHASE_HEADER );
+        buf[i] = c;
+    }
+
+    // HTTP/0.9 has no header
+    strcpy( buf, "GET /\r\n" );
+    http_init( r );
+    assert( http_parse_request( r, buf, strlen( buf ), UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( r->phase == HTTP_PHASE_DONE );
+
+    http_free( r );
+}
+
+
+static void test_response( void )
+{
+    char buf[] = "HTTP/1.1 200 OK\r\n"
+                 "Content-Length: 0\r\n"
+                 "\r\n";
+    size_t len = strlen( buf );
+    http_t *r = http_alloc(2);
+
+    http_setopt( r, HTTP_OPT_REQLINE );
+    assert( http_parse_response( r, buf, len, UINT16_MAX ) == HTTP_SUCCESS );
+    assert( r->phase == HTTP_PHASE_HEADER );
+    assert( r->cur == 17 );
+    assert( http_status( r ) == 200 );
+
+    assert( http_parse_response( r, buf, len, UINT16_MAX ) == HTTP_SUCCESS );
+    assert( r->phase == HTTP_PHASE_DONE );
+    assert( r->nheader == 1 );
+
+    http_free( r );
+}
+
+
+static int NCOMPLETE = 0;
+
+static int on_headers_complete( http_t *h, void *udata )
+{
+    (void)h;
+    (void)udata;
+    NCOMPLETE++;
+    return 0;
+}
+
+
+static void test_callback( void )
+{
+    char buf[] = "GET /foo HTTP/1.1\r\n"
+                 "Host: example.com\r\n"
+                 "\r\n";
+    http_cb_t cb = {
+        .on_headers_complete = on_headers_complete
+    };
+    http_t *r = http_alloc(0);
+
+    http_setopt( r, HTTP_OPT_REQLINE );
+    http_setcb( r, &cb, NULL );
+    assert( http_parse_request( r, buf, strlen( buf ), UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    // not the end of the head
+    assert( NCOMPLETE == 0 );
+    assert( http_parse_request( r, buf, strlen( buf ), UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( NCOMPLETE == 1 );
+
+    http_free( r );
+}
+
+#ifdef TESTS
+
+int main(void)
+{
+    test_request();
+    test_response();
+    test_callback();
+    return 0;
+}
+
+#endif
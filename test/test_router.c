@@ -0,0 +1,297 @@
+#include "test_http.h"
+#include <errno.h>
+#include "../src/http_router.h"
+
+
+// handlers are the distinct addresses
+static char H[16];
+
+
+static int match( http_router_t *r, int method, const char *path,
+                  http_route_t *route )
+{
+    return http_router_match( r, method, path, strlen( path ), route );
+}
+
+
+static void assert_param( const char *path, const http_route_t *route,
+                          uint8_t i, const char *val )
+{
+    assert( i < route->nparam );
+    assert( route->params[i].vlen == strlen( val ) );
+    assert( memcmp( path + route->params[i].val, val,
+                    route->params[i].vlen ) == 0 );
+}
+
+
+static void test_static( void )
+{
+    // the later patterns split the labels of the earlier ones
+    const char *patterns[] = {
+        "/users/new", "/users", "/user", "/us", "/", "/users/newer",
+        "/about", "/a", NULL
+    };
+    const char *misses[] = {
+        "", "/u", "/user/", "/users/ne", "/abou", "/aboutx", "users", NULL
+    };
+    http_router_t *r = http_router_alloc();
+    http_route_t route;
+    int i = 0;
+
+    assert( r );
+    for(; patterns[i]; i++ ){
+        assert( http_router_add( r, HTTP_MGET, patterns[i], &H[i] ) == 0 );
+    }
+    for( i = 0; patterns[i]; i++ ){
+        assert( match( r, HTTP_MGET, patterns[i], &route ) ==
+                HTTP_ROUTER_FOUND );
+        assert( route.handler == &H[i] && route.nparam == 0 );
+    }
+    for( i = 0; misses[i]; i++ ){
+        assert( match( r, HTTP_MGET, misses[i], &route ) ==
+                HTTP_ROUTER_ENOTFOUND );
+        assert( !route.handler );
+    }
+    // the path is not null-terminated
+    assert( http_router_match( r, HTTP_MGET, "/usersX", 6, &route ) ==
+            HTTP_ROUTER_FOUND );
+    assert( route.handler == &H[1] );
+
+    http_router_free( r );
+}
+
+
+static void test_param( void )
+{
+    http_router_t *r = http_router_alloc();
+    http_route_t route;
+    const char *path = NULL;
+
+    assert( http_router_add( r, HTTP_MGET, "/users/:id", &H[0] ) == 0 );
+    assert( http_router_add( r, HTTP_MGET, "/users/:id/posts/:post",
+                             &H[1] ) == 0 );
+    assert( http_router_add( r, HTTP_MGET, "/users/me", &H[2] ) == 0 );
+    assert( http_router_add( r, HTTP_MGET, "/files/*path", &H[3] ) == 0 );
+    assert( http_router_add( r, HTTP_MGET, "/a/b/d", &H[4] ) == 0 );
+    assert( http_router_add( r, HTTP_MGET, "/a/:x/c", &H[5] ) == 0 );
+    assert( http_router_add( r, HTTP_MGET, "/a/*rest", &H[6] ) == 0 );
+    // literal ':' that is not at the head of a segment
+    assert( http_router_add( r, HTTP_MGET, "/time/12:00", &H[7] ) == 0 );
+
+    path = "/users/42";
+    assert( match( r, HTTP_MGET, path, &route ) == HTTP_ROUTER_FOUND );
+    assert( route.handler == &H[0] && route.nparam == 1 );
+    assert_param( path, &route, 0, "42" );
+
+    path = "/users/42/posts/hello-world";
+    assert( match( r, HTTP_MGET, path, &route ) == HTTP_ROUTER_FOUND );
+    assert( route.handler == &H[1] && route.nparam == 2 );
+    assert_param( path, &route, 0, "42" );
+    assert_param( path, &route, 1, "hello-world" );
+
+    // static is chosen over the capture
+    assert( match( r, HTTP_MGET, "/users/me", &route ) == HTTP_ROUTER_FOUND );
+    assert( route.handler == &H[2] && route.nparam == 0 );
+    assert( match( r, HTTP_MGET, "/users/meme", &route ) ==
+            HTTP_ROUTER_FOUND );
+    assert( route.handler == &H[0] );
+
+    // empty segment is not captured
+    assert( match( r, HTTP_MGET, "/users/", &route ) ==
+            HTTP_ROUTER_ENOTFOUND );
+    assert( match( r, HTTP_MGET, "/users//posts/x", &route ) ==
+            HTTP_ROUTER_ENOTFOUND );
+
+    // the rest including the empty one
+    path = "/files/css/site.css";
+    assert( match( r, HTTP_MGET, path, &route ) == HTTP_ROUTER_FOUND );
+    assert( route.handler == &H[3] && route.nparam == 1 );
+    assert_param( path, &route, 0, "css/site.css" );
+    assert( match( r, HTTP_MGET, "/files/", &route ) == HTTP_ROUTER_FOUND );
+    assert( route.handler == &H[3] && route.params[0].vlen == 0 );
+    assert( match( r, HTTP_MGET, "/files", &route ) ==
+            HTTP_ROUTER_ENOTFOUND );
+
+    // backtrack from the static to the capture, and to the rest
+    assert( match( r, HTTP_MGET, "/a/b/d", &route ) == HTTP_ROUTER_FOUND );
+    assert( route.handler == &H[4] );
+    path = "/a/b/c";
+    assert( match( r, HTTP_MGET, path, &route ) == HTTP_ROUTER_FOUND );
+    assert( route.handler == &H[5] && route.nparam == 1 );
+    assert_param( path, &route, 0, "b" );
+    path = "/a/b/e";
+    assert( match( r, HTTP_MGET, path, &route ) == HTTP_ROUTER_FOUND );
+    assert( route.handler == &H[6] && route.nparam == 1 );
+    assert_param( path, &route, 0, "b/e" );
+
+    assert( match( r, HTTP_MGET, "/time/12:00", &route ) ==
+            HTTP_ROUTER_FOUND );
+    assert( route.handler == &H[7] );
+    assert( match( r, HTTP_MGET, "/time/13:00", &route ) ==
+            HTTP_ROUTER_ENOTFOUND );
+
+    http_router_free( r );
+}
+
+
+static void test_method( void )
+{
+    http_router_t *r = http_router_alloc();
+    http_route_t route;
+
+    assert( http_router_add( r, HTTP_MGET, "/items/:id", &H[0] ) == 0 );
+    assert( http_router_add( r, HTTP_MPUT, "/items/:id", &H[1] ) == 0 );
+    assert( http_router_add( r, 0, "/any", &H[2] ) == 0 );
+    assert( http_router_add( r, HTTP_MPOST, "/any", &H[3] ) == 0 );
+
+    assert( match( r, HTTP_MGET, "/items/1", &route ) == HTTP_ROUTER_FOUND );
+    assert( route.handler == &H[0] );
+    assert( match( r, HTTP_MPUT, "/items/1", &route ) == HTTP_ROUTER_FOUND );
+    assert( route.handler == &H[1] );
+    assert( match( r, HTTP_MDELETE, "/items/1", &route ) ==
+            HTTP_ROUTER_EMETHOD );
+    assert( !route.handler );
+    assert( route.allow == ( ( 1 << HTTP_MGET ) | ( 1 << HTTP_MPUT ) ) );
+
+    // the handler of any method
+    assert( match( r, HTTP_MPOST, "/any", &route ) == HTTP_ROUTER_FOUND );
+    assert( route.handler == &H[3] );
+    assert( match( r, HTTP_MDELETE, "/any", &route ) == HTTP_ROUTER_FOUND );
+    assert( route.handler == &H[2] );
+    assert( match( r, 0, "/any", &route ) == HTTP_ROUTER_FOUND );
+    assert( route.handler == &H[2] );
+
+    http_router_free( r );
+}
+
+
+static void test_invalid( void )
+{
+    http_router_t *r = http_router_alloc();
+    char many[256] = "";
+    int i = 0;
+
+    errno = 0;
+    assert( http_router_add( r, HTTP_MGET, "", &H[0] ) == -1 );
+    assert( errno == EINVAL );
+    assert( http_router_add( r, HTTP_MGET, "users", &H[0] ) == -1 );
+    assert( http_router_add( r, HTTP_MGET, "/users/:", &H[0] ) == -1 );
+    assert( http_router_add( r, HTTP_MGET, "/users/:id/", &H[0] ) == 0 );
+    assert( http_router_add( r, HTTP_MGET, "/files/*/x", &H[0] ) == -1 );
+    assert( http_router_add( r, HTTP_MGET, "/files/*", &H[0] ) == 0 );
+    assert( http_router_add( r, -1, "/", &H[0] ) == -1 );
+    assert( http_router_add( r, HTTP_ROUTER_NMETHOD, "/", &H[0] ) == -1 );
+    assert( http_router_add( r, HTTP_MGET, "/", NULL ) == -1 );
+    assert( errno == EINVAL );
+
+    assert( http_router_add( r, HTTP_MGET, "/users/:name/", &H[1] ) == -1 );
+    assert( errno == EEXIST );
+
+    // HTTP_ROUTER_MAXPARAM captures
+    for(; i < HTTP_ROUTER_MAXPARAM; i++ ){
+        strcat( many, "/:p" );
+    }
+    assert( http_router_add( r, HTTP_MGET, many, &H[2] ) == 0 );
+    strcat( many, "/:p" );
+    assert( http_router_add( r, HTTP_MGET, many, &H[2] ) == -1 );
+    assert( errno == EINVAL );
+
+    http_router_free( r );
+}
+
+
+static void test_lookup( void )
+{
+    char req[] = "GET /users/42/posts/7?sort=desc HTTP/1.1\r\n"
+                 "Host: example.com\r\n"
+                 "\r\n";
+    char abs[] = "DELETE http://example.com/users/42/posts/7 HTTP/1.1\r\n"
+                 "\r\n";
+    char root[] = "GET http://example.com?q=/users HTTP/1.1\r\n"
+                  "\r\n";
+    http_router_t *r = http_router_alloc();
+    http_t *h = http_alloc(4);
+    http_route_t route;
+
+    assert( http_router_add( r, HTTP_MGET, "/users/:id/posts/:post",
+                             &H[0] ) == 0 );
+    assert( http_router_add( r, HTTP_MGET, "/*rest", &H[1] ) == 0 );
+
+    assert( http_parse_request( h, req, strlen( req ), UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( http_router_lookup( r, h, req, &route ) == HTTP_ROUTER_FOUND );
+    assert( route.handler == &H[0] && route.nparam == 2 );
+    assert_param( req, &route, 0, "42" );
+    assert_param( req, &route, 1, "7" );
+
+    http_init( h );
+    assert( http_parse_request( h, abs, strlen( abs ), UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( http_router_lookup( r, h, abs, &route ) == HTTP_ROUTER_EMETHOD );
+    assert( route.allow == ( 1 << HTTP_MGET ) );
+    assert_param( abs, &route, 0, "42" );
+    assert_param( abs, &route, 1, "7" );
+
+    // empty path of the absolute-form
+    http_init( h );
+    assert( http_parse_request( h, root, strlen( root ), UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( http_router_lookup( r, h, root, &route ) == HTTP_ROUTER_FOUND );
+    assert( route.handler == &H[1] && route.params[0].vlen == 0 );
+
+    http_free( h );
+    http_router_free( r );
+}
+
+
+static void test_random( void )
+{
+    static char patterns[2000][32];
+    http_router_t *r = http_router_alloc();
+    http_route_t route;
+    unsigned seed = 1;
+    const char *abc = "ab/";
+    int n = 0;
+    int i = 0;
+    int j = 0;
+
+    // static patterns that share many prefixes
+    while( n < 2000 )
+    {
+        int len = 1 + rand_r( &seed ) % 12;
+
+        patterns[n][0] = '/';
+        for( j = 1; j <= len; j++ ){
+            patterns[n][j] = abc[rand_r( &seed ) % 3];
+        }
+        patterns[n][j] = 0;
+        for( i = 0; i < n && strcmp( patterns[i], patterns[n] ); i++ ){}
+        if( i == n ){
+            assert( http_router_add( r, HTTP_MGET, patterns[n],
+                                     patterns[n] ) == 0 );
+            n++;
+        }
+    }
+    for( i = 0; i < n; i++ ){
+        assert( match( r, HTTP_MGET, patterns[i], &route ) ==
+                HTTP_ROUTER_FOUND );
+        assert( route.handler == patterns[i] );
+    }
+
+    http_router_free( r );
+}
+
+#ifdef TESTS
+
+int main(void)
+{
+    test_static();
+    test_param();
+    test_method();
+    test_invalid();
+    test_lookup();
+    test_random();
+    return 0;
+}
+
+#endif
@@ -0,0 +1,194 @@
+#include "test_http.h"
+#include <errno.h>
+
+
+// the snapshots are moved to this block
+static uint64_t MOVED[512];
+
+
+static void compare( http_t *s, http_t *h, const char *buf )
+{
+    char *sbuf = http_snapshot_buf( s );
+    uintptr_t skey, sval, key, val;
+    uint16_t sklen, svlen, klen, vlen;
+    uint8_t i = 0;
+
+    assert( s->maxheader == h->nheader );
+    assert( s->nheader == h->nheader );
+    assert( s->phase == HTTP_PHASE_DONE );
+    assert( s->cur == h->cur );
+    assert( s->protocol == h->protocol );
+    assert( s->msg == h->msg && s->msglen == h->msglen );
+    assert( !s->cb && !s->udata && !s->filter );
+    assert( memcmp( sbuf + s->msg, buf + h->msg, h->msglen ) == 0 );
+    assert( sbuf[http_snapshot_headlen( s )] == 0 );
+    for(; i < h->nheader; i++ )
+    {
+        assert( http_getheader_at( s, &skey, &sklen, &sval, &svlen, i ) == 0 );
+        assert( http_getheader_at( h, &key, &klen, &val, &vlen, i ) == 0 );
+        assert( skey == key && sklen == klen );
+        assert( sval == val && svlen == vlen );
+        assert( memcmp( sbuf + skey, buf + key, klen ) == 0 );
+        assert( memcmp( sbuf + sval, buf + val, vlen ) == 0 );
+    }
+    assert( http_getheader_at( s, &skey, &sklen, &sval, &svlen, i ) == -1 );
+}
+
+
+static void test_request( void )
+{
+    char buf[] = "GET /foo?a=b HTTP/1.1\r\n"
+                 "Host: example.com\r\n"
+                 "Content-Type: text/plain\r\n"
+                 "Accept: */*\r\n"
+                 "\r\n"
+                 "body";
+    char orig[sizeof( buf )];
+    size_t len = strlen( buf );
+    http_t *r = http_alloc(8);
+    http_t *s = NULL;
+    size_t size = 0;
+    uintptr_t key, val;
+    uint16_t klen, vlen;
+    int i = 0;
+
+    assert( http_parse_request( r, buf, len, UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    memcpy( orig, buf, sizeof( buf ) );
+
+    // exactly the head bytes
+    size = http_snapshot_size( r );
+    assert( size == http_alloc_size( 3 ) + len - 4 + 1 );
+    assert( http_snapshot( r, buf, MOVED, size - 1 ) == -1 );
+    assert( errno == ENOBUFS );
+    assert( http_snapshot( r, buf, MOVED, size ) == 0 );
+    compare( (http_t*)MOVED, r, orig );
+
+    // independent of the original buffer and of the position
+    assert( ( s = http_snapshot_dup( r, buf ) ) );
+    memset( buf, 'x', len );
+    memset( MOVED, 0, sizeof( MOVED ) );
+    memcpy( MOVED, (void*)s, size );
+    memset( (void*)s, 0, size );
+    http_free( s );
+    s = (http_t*)MOVED;
+    compare( s, r, orig );
+
+    i = http_findheader( s, http_snapshot_buf( s ), "content-type", 12 );
+    assert( i == 1 );
+    assert( http_getheader_at( s, &key, &klen, &val, &vlen, (uint8_t)i ) == 0 );
+    assert( vlen == 10 );
+    assert( memcmp( http_snapshot_buf( s ) + val, "text/plain", vlen ) == 0 );
+
+    http_free( r );
+}
+
+
+static void test_response( void )
+{
+    char buf[] = "HTTP/1.0 404 Not Found\n"
+                 "Server:x\n"
+                 "\n";
+    size_t len = strlen( buf );
+    http_t *r = http_alloc(2);
+    http_t *s = NULL;
+
+    assert( http_parse_response( r, buf, len, UINT16_MAX ) == HTTP_SUCCESS );
+    assert( ( s = http_snapshot_dup( r, buf ) ) );
+    compare( s, r, buf );
+    assert( http_status( s ) == 404 );
+    assert( memcmp( http_snapshot_buf( s ) + s->msg, "Not Found", 9 ) == 0 );
+    http_free( s );
+
+    http_free( r );
+}
+
+
+static void test_lazy( void )
+{
+    char buf[] = "GET / HTTP/1.1\r\n"
+                 "Host: example.com\r\n"
+                 "X-Empty: \r\n"
+                 "\r\n";
+    size_t len = strlen( buf );
+    http_t *r = http_alloc(4);
+    http_t *s = NULL;
+    uintptr_t key, val;
+    uint16_t klen, vlen;
+
+    http_setopt( r, HTTP_OPT_LAZY );
+    assert( http_parse_request( r, buf, len, UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( ( s = http_snapshot_dup( r, buf ) ) );
+    memset( buf, 'x', len );
+
+    // the lines are split in the snapshot
+    assert( http_getheader_lazy( s, http_snapshot_buf( s ), &key, &klen, &val,
+                                 &vlen, 0 ) == HTTP_SUCCESS );
+    assert( klen == 4 && vlen == 11 );
+    assert( memcmp( http_snapshot_buf( s ) + key, "host", klen ) == 0 );
+    assert( memcmp( http_snapshot_buf( s ) + val, "example.com", vlen ) == 0 );
+    assert( http_finalize( s, http_snapshot_buf( s ) ) == HTTP_SUCCESS );
+    assert( s->nheader == 1 );
+    http_free( s );
+
+    http_free( r );
+}
+
+
+static void test_http09( void )
+{
+    char buf[] = "GET /index.html\r\n";
+    char orig[sizeof( buf )];
+    http_t *r = http_alloc(2);
+    http_t *s = NULL;
+
+    assert( http_parse_request( r, buf, strlen( buf ), UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( http_version( r ) == HTTP_V09 );
+    memcpy( orig, buf, sizeof( buf ) );
+
+    // the request-target is after the cursor
+    assert( r->cur < (uintptr_t)r->msg + r->msglen );
+    assert( http_snapshot_size( r ) ==
+            http_alloc_size( 0 ) + r->msg + r->msglen + 1 );
+    assert( ( s = http_snapshot_dup( r, buf ) ) );
+    memset( buf, 'x', strlen( buf ) );
+    compare( s, r, orig );
+    assert( memcmp( http_snapshot_buf( s ) + s->msg, "/index.html",
+                    11 ) == 0 );
+    http_free( s );
+
+    http_free( r );
+}
+
+
+static void test_incomplete( void )
+{
+    char buf[] = "GET / HTTP/1.1\r\n"
+                 "Host: example.com\r\n";
+    http_t *r = http_alloc(2);
+
+    assert( http_parse_request( r, buf, strlen( buf ), UINT16_MAX,
+                                UINT16_MAX ) == HTTP_EAGAIN );
+    assert( http_snapshot( r, buf, MOVED, sizeof( MOVED ) ) == -1 );
+    assert( errno == EAGAIN );
+    assert( !http_snapshot_dup( r, buf ) );
+    assert( errno == EAGAIN );
+
+    http_free( r );
+}
+
+#ifdef TESTS
+
+int main(void)
+{
+    test_request();
+    test_response();
+    test_lazy();
+    test_http09();
+    test_incomplete();
+    return 0;
+}
+
+#endif
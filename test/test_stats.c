@@ -0,0 +1,104 @@
+#include "test_http.h"
+#include <errno.h>
+#include <pthread.h>
+
+
+static void *parse_thread( void *arg )
+{
+    char req[] = "GET /foo HTTP/1.1\r\n"
+                 "Host: example.com\r\n"
+                 "\r\n";
+    http_t *r = http_alloc(3);
+    http_stats_t *s = http_stats_attach();
+    int i = 0;
+
+    (void)arg;
+    assert( s );
+    assert( ( (uintptr_t)s % HTTP_STATS_ALIGN ) == 0 );
+    assert( http_stats_attach() == s );
+    for(; i < 10; i++ ){
+        http_init( r );
+        assert( http_parse_request( r, req, sizeof( req ) - 1, UINT16_MAX,
+                                    UINT16_MAX ) == HTTP_SUCCESS );
+    }
+    http_free( r );
+
+    return NULL;
+}
+
+
+static void test_stats( void )
+{
+    char req[] = "GET /foo HTTP/1.1\r\n"
+                 "Host: example.com\r\n"
+                 "\r\n";
+    size_t len = sizeof( req ) - 1;
+    char bad[] = "GET /foo HTTP/2.0\r\n\r\n";
+    http_t *r = http_alloc(3);
+    http_stats_t *s = http_stats_attach();
+    http_stats_t total;
+    pthread_t th;
+    size_t i = 0;
+    uint64_t ncall = 0;
+    int rc = 0;
+
+    // not counted before attach
+    assert( s && s->calls == 0 );
+
+    // feed 4 bytes at a time
+    for( i = 4; i < len; i += 4, ncall++ ){
+        assert( http_parse_request( r, req, i, UINT16_MAX,
+                                    UINT16_MAX ) == HTTP_EAGAIN );
+    }
+    assert( http_parse_request( r, req, len, UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( s->calls == ncall + 1 );
+    assert( s->resumes > 0 && s->resumes < s->calls );
+    assert( s->consumed == len );
+    assert( s->bytes >= s->consumed );
+    assert( s->bytes - s->consumed == s->rescanned );
+    assert( s->results[0] == 1 );
+    assert( s->results[-HTTP_EAGAIN] == ncall );
+    assert( s->exits[HTTP_PHASE_DONE] == 1 );
+
+    http_init( r );
+    assert( http_parse_request( r, bad, sizeof( bad ) - 1, UINT16_MAX,
+                                UINT16_MAX ) == HTTP_EVERSION );
+    assert( s->results[-HTTP_EVERSION] == 1 );
+
+    // not counted after detach
+    http_stats_detach();
+    http_init( r );
+    http_parse_request( r, bad, sizeof( bad ) - 1, UINT16_MAX, UINT16_MAX );
+    assert( s->results[-HTTP_EVERSION] == 1 );
+
+    // the block of the exited thread is aggregated
+    assert( pthread_create( &th, NULL, parse_thread, NULL ) == 0 );
+    assert( pthread_join( th, NULL ) == 0 );
+    rc = http_stats_aggregate( &total );
+    assert( rc == 2 );
+    assert( total.calls == s->calls + 10 );
+    assert( total.results[0] == 11 );
+    assert( total.results[-HTTP_EVERSION] == 1 );
+
+    http_free( r );
+}
+
+#ifdef TESTS
+
+int main(void)
+{
+    http_stats_t s;
+
+    // built without --enable-stats
+    if( !http_stats_attach() ){
+        assert( errno == ENOTSUP );
+        assert( http_stats_aggregate( &s ) == -1 );
+        return 77;
+    }
+    http_stats_detach();
+    test_stats();
+    return 0;
+}
+
+#endif
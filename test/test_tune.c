@@ -0,0 +1,97 @@
+#include "test_http.h"
+
+
+static void test_name( void )
+{
+    int engine = 0;
+
+    for(; engine < HTTP_NENGINE; engine++ ){
+        assert( http_engine_lookup( http_engine_name( engine ) ) == engine );
+    }
+    assert( http_engine_lookup( "state" ) == HTTP_ENGINE_STATE );
+    assert( http_engine_lookup( "index" ) == HTTP_ENGINE_INDEX );
+    assert( http_engine_lookup( "dfa" ) == HTTP_ENGINE_DFA );
+    assert( http_engine_lookup( "auto" ) == -1 );
+    assert( http_engine_name( HTTP_NENGINE ) == NULL );
+    assert( http_engine_name( -1 ) == NULL );
+}
+
+
+static void test_default( void )
+{
+    http_tune_t t;
+    http_t *r = NULL;
+
+    // not selected
+    assert( http_gettune( &t ) == HTTP_ENGINE_STATE );
+    assert( t.source == HTTP_TUNE_NONE );
+    r = http_alloc(2);
+    assert( r->engine == HTTP_ENGINE_STATE );
+    // http_init keeps the engine
+    http_setengine( r, HTTP_ENGINE_DFA );
+    http_init( r );
+    assert( r->engine == HTTP_ENGINE_DFA );
+    http_free( r );
+}
+
+
+static void test_bench( void )
+{
+    http_tune_t t, g;
+    http_t *r = NULL;
+    int engine = 0;
+
+    unsetenv( "HTTP_ENGINE" );
+    engine = http_autotune( &t );
+    assert( engine >= 0 && engine < HTTP_NENGINE );
+    assert( t.engine == engine );
+    assert( t.source == HTTP_TUNE_BENCH );
+    for( engine = 0; engine < HTTP_NENGINE; engine++ ){
+        assert( t.ns[engine] > 0 && t.ns[engine] != UINT64_MAX );
+    }
+    // selected engine is not slower than the state machine
+    assert( t.ns[t.engine] <= t.ns[HTTP_ENGINE_STATE] );
+
+    assert( http_gettune( &g ) == t.engine );
+    assert( memcmp( &g, &t, sizeof( t ) ) == 0 );
+    r = http_alloc(2);
+    assert( r->engine == t.engine );
+    http_free( r );
+}
+
+
+static void test_env( void )
+{
+    http_tune_t t;
+    http_t *r = NULL;
+
+    setenv( "HTTP_ENGINE", "index", 1 );
+    assert( http_autotune( &t ) == HTTP_ENGINE_INDEX );
+    assert( t.source == HTTP_TUNE_ENV );
+    assert( t.ns[HTTP_ENGINE_STATE] == 0 );
+    r = http_alloc(2);
+    assert( r->engine == HTTP_ENGINE_INDEX );
+    http_free( r );
+
+    // unknown name is measured
+    setenv( "HTTP_ENGINE", "auto", 1 );
+    assert( http_autotune( &t ) >= 0 );
+    assert( t.source == HTTP_TUNE_BENCH );
+    unsetenv( "HTTP_ENGINE" );
+}
+
+#ifdef TESTS
+
+int main(void)
+{
+    // the default is not selected at the load without HTTP_ENGINE
+    if( !getenv( "HTTP_ENGINE" ) ){
+        test_default();
+    }
+    test_name();
+    test_bench();
+    test_env();
+    return 0;
+}
+
+#endif
@@ -0,0 +1,228 @@
+#include "test_http.h"
+#include <errno.h>
+#include "../src/http_vhost.h"
+
+
+// udata are the distinct addresses
+static char U[16];
+
+
+static void *lookup( http_vhost_t *v, const char *host )
+{
+    return http_vhost_lookup( v, host, strlen( host ) );
+}
+
+
+static void test_exact( void )
+{
+    http_vhost_t *v = http_vhost_alloc();
+
+    assert( v );
+    assert( http_vhost_add( v, "example.com", &U[0] ) == 0 );
+    assert( http_vhost_add( v, "WWW.Example.COM", &U[1] ) == 0 );
+    assert( http_vhost_add( v, "[::1]", &U[2] ) == 0 );
+    assert( http_vhost_add( v, "127.0.0.1.", &U[3] ) == 0 );
+
+    assert( lookup( v, "example.com" ) == &U[0] );
+    assert( lookup( v, "EXAMPLE.com" ) == &U[0] );
+    assert( lookup( v, "www.example.com" ) == &U[1] );
+    // port and trailing dot
+    assert( lookup( v, "example.com:8080" ) == &U[0] );
+    assert( lookup( v, "example.com." ) == &U[0] );
+    assert( lookup( v, "example.com.:80" ) == &U[0] );
+    assert( lookup( v, "example.com:" ) == &U[0] );
+    assert( lookup( v, "[::1]" ) == &U[2] );
+    assert( lookup( v, "[::1]:443" ) == &U[2] );
+    assert( lookup( v, "127.0.0.1" ) == &U[3] );
+    assert( lookup( v, "127.0.0.1:80" ) == &U[3] );
+
+    assert( lookup( v, "" ) == NULL );
+    assert( lookup( v, "example.co" ) == NULL );
+    assert( lookup( v, "xexample.com" ) == NULL );
+    assert( lookup( v, "foo.example.com" ) == NULL );
+    // the host is not null-terminated
+    assert( http_vhost_lookup( v, "example.comX", 11 ) == &U[0] );
+
+    http_vhost_free( v );
+}
+
+
+static void test_wildcard( void )
+{
+    http_vhost_t *v = http_vhost_alloc();
+
+    assert( http_vhost_add( v, "*.example.com", &U[0] ) == 0 );
+    assert( http_vhost_add( v, "*.api.example.com", &U[1] ) == 0 );
+    assert( http_vhost_add( v, "www.example.com", &U[2] ) == 0 );
+
+    assert( lookup( v, "foo.example.com" ) == &U[0] );
+    assert( lookup( v, "a.b.example.com:80" ) == &U[0] );
+    // the exact name, and the longest wildcard
+    assert( lookup( v, "WWW.example.com" ) == &U[2] );
+    assert( lookup( v, "v1.API.example.com" ) == &U[1] );
+    assert( lookup( v, "x.v1.api.example.com" ) == &U[1] );
+    assert( lookup( v, "api.example.com" ) == &U[0] );
+    // the wildcard does not match the name itself
+    assert( lookup( v, "example.com" ) == NULL );
+    assert( lookup( v, ".example.com" ) == NULL );
+    assert( lookup( v, "xexample.com" ) == NULL );
+
+    // the default
+    assert( http_vhost_add( v, "*", &U[3] ) == 0 );
+    assert( lookup( v, "example.com" ) == &U[3] );
+    assert( lookup( v, "example.org" ) == &U[3] );
+    assert( lookup( v, "" ) == &U[3] );
+    assert( lookup( v, "foo.example.com" ) == &U[0] );
+
+    http_vhost_free( v );
+}
+
+
+static void test_invalid( void )
+{
+    http_vhost_t *v = http_vhost_alloc();
+    char name[HTTP_VHOST_MAXNAME + 2];
+
+    errno = 0;
+    assert( http_vhost_add( v, "", &U[0] ) == -1 );
+    assert( errno == EINVAL );
+    assert( http_vhost_add( v, ".", &U[0] ) == -1 );
+    assert( http_vhost_add( v, "*.", &U[0] ) == -1 );
+    assert( http_vhost_add( v, "a*.example.com", &U[0] ) == -1 );
+    assert( http_vhost_add( v, "*example.com", &U[0] ) == -1 );
+    assert( http_vhost_add( v, "exa mple.com", &U[0] ) == -1 );
+    assert( http_vhost_add( v, "example.com/", &U[0] ) == -1 );
+    assert( http_vhost_add( v, "example.com", NULL ) == -1 );
+    assert( errno == EINVAL );
+
+    assert( http_vhost_add( v, "example.com", &U[0] ) == 0 );
+    assert( http_vhost_add( v, "Example.Com.", &U[1] ) == -1 );
+    assert( errno == EEXIST );
+    assert( http_vhost_add( v, "*.example.com", &U[1] ) == 0 );
+    assert( http_vhost_add( v, "*.EXAMPLE.com", &U[1] ) == -1 );
+    assert( errno == EEXIST );
+    assert( http_vhost_add( v, "*", &U[2] ) == 0 );
+    assert( http_vhost_add( v, "*", &U[2] ) == -1 );
+    assert( errno == EEXIST );
+
+    // HTTP_VHOST_MAXNAME bytes
+    memset( name, 'a', sizeof( name ) - 1 );
+    name[sizeof( name ) - 1] = 0;
+    assert( http_vhost_add( v, name, &U[3] ) == -1 );
+    assert( errno == EINVAL );
+    name[HTTP_VHOST_MAXNAME] = 0;
+    assert( http_vhost_add( v, name, &U[3] ) == 0 );
+    assert( lookup( v, name ) == &U[3] );
+    name[HTTP_VHOST_MAXNAME] = 'a';
+    assert( lookup( v, name ) == &U[2] );
+
+    http_vhost_free( v );
+}
+
+
+static void test_request( void )
+{
+    char req[] = "GET /index.html HTTP/1.1\r\n"
+                 "Accept: */*\r\n"
+                 "host: WWW.example.com:8080\r\n"
+                 "\r\n";
+    char abs[] = "GET http://user@foo.example.com:80/a?b HTTP/1.1\r\n"
+                 "Host: www.example.com\r\n"
+                 "\r\n";
+    char query[] = "GET https://www.example.com?q=/x HTTP/1.1\r\n"
+                   "\r\n";
+    char connect[] = "CONNECT foo.example.com:443 HTTP/1.1\r\n"
+                     "Host: www.example.com\r\n"
+                     "\r\n";
+    char nohost[] = "GET / HTTP/1.1\r\n"
+                    "\r\n";
+    char lazy[] = "GET / HTTP/1.1\r\n"
+                  "Accept: */*\r\n"
+                  "Host: foo.example.com\r\n"
+                  "\r\n";
+    http_vhost_t *v = http_vhost_alloc();
+    http_t *h = http_alloc(4);
+
+    assert( http_vhost_add( v, "www.example.com", &U[0] ) == 0 );
+    assert( http_vhost_add( v, "*.example.com", &U[1] ) == 0 );
+
+    assert( http_parse_request( h, req, strlen( req ), UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( http_vhost_request( v, h, req ) == &U[0] );
+
+    // the authority of the absolute-form is chosen over the Host header
+    http_init( h );
+    assert( http_parse_request( h, abs, strlen( abs ), UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( http_vhost_request( v, h, abs ) == &U[1] );
+
+    http_init( h );
+    assert( http_parse_request( h, query, strlen( query ), UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( http_vhost_request( v, h, query ) == &U[0] );
+
+    http_init( h );
+    assert( http_parse_request( h, connect, strlen( connect ), UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( http_vhost_request( v, h, connect ) == &U[1] );
+
+    http_init( h );
+    assert( http_parse_request( h, nohost, strlen( nohost ), UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( http_vhost_request( v, h, nohost ) == NULL );
+
+    // the Host line is split on the access
+    http_init( h );
+    http_setopt( h, HTTP_OPT_LAZY );
+    assert( http_parse_request( h, lazy, strlen( lazy ), UINT16_MAX,
+                                UINT16_MAX ) == HTTP_SUCCESS );
+    assert( http_vhost_request( v, h, lazy ) == &U[1] );
+    assert( http_vhost_request( v, h, lazy ) == &U[1] );
+
+    http_free( h );
+    http_vhost_free( v );
+}
+
+
+static void test_random( void )
+{
+    static char names[4000][32];
+    http_vhost_t *v = http_vhost_alloc();
+    char host[64];
+    unsigned seed = 1;
+    int i = 0;
+
+    // exact names and wildcards of the grown table
+    for(; i < 4000; i++ ){
+        snprintf( names[i], sizeof( names[i] ), "%sh%d.d%d.example",
+                  i % 4 ? "" : "*.", rand_r( &seed ), i % 97 );
+        assert( http_vhost_add( v, names[i], names[i] ) == 0 );
+    }
+    for( i = 0; i < 4000; i++ )
+    {
+        if( i % 4 ){
+            assert( lookup( v, names[i] ) == names[i] );
+        }
+        else {
+            snprintf( host, sizeof( host ), "X%s:80", names[i] + 1 );
+            assert( lookup( v, host ) == names[i] );
+            assert( lookup( v, names[i] + 2 ) == NULL );
+        }
+    }
+
+    http_vhost_free( v );
+}
+
+#ifdef TESTS
+
+int main(void)
+{
+    test_exact();
+    test_wildcard();
+    test_invalid();
+    test_request();
+    test_random();
+    return 0;
+}
+
+#endif
@@ -0,0 +1,157 @@
+#include "test_http.h"
+#include "wheel.h"
+
+#define NTIMER  1024
+
+
+static size_t drain( wheel_timer_t *expired, wheel_timer_t *timers,
+                     uint64_t now, int *fired )
+{
+    wheel_timer_t *t = NULL;
+    size_t n = 0;
+
+    while( ( t = expired->next ) != expired )
+    {
+        wheel_list_del( t );
+        assert( t->expire <= now );
+        fired[t - timers] = 1;
+        n++;
+    }
+
+    return n;
+}
+
+
+static void test_order( void )
+{
+    wheel_t w;
+    wheel_timer_t timers[4], expired;
+    int fired[4] = { 0 };
+    uint64_t now = 10;
+    int i = 0;
+
+    wheel_init( &w, now );
+    for(; i < 4; i++ ){
+        wheel_timer_init( &timers[i] );
+        assert( !wheel_pending( &timers[i] ) );
+    }
+    // level 0, level 1, level 2 and a past tick
+    wheel_add( &w, &timers[0], now + 5 );
+    wheel_add( &w, &timers[1], now + 100 );
+    wheel_add( &w, &timers[2], now + 5000 );
+    wheel_add( &w, &timers[3], now - 5 );
+    assert( w.ntimer == 4 );
+
+    // the past tick expires at the current tick
+    assert( wheel_expire( &w, now, &expired ) == 1 );
+    assert( drain( &expired, timers, now, fired ) == 1 && fired[3] );
+    assert( !wheel_pending( &timers[3] ) );
+
+    assert( wheel_expire( &w, now + 4, &expired ) == 0 );
+    assert( wheel_expire( &w, now + 5, &expired ) == 1 );
+    assert( drain( &expired, timers, now + 5, fired ) == 1 && fired[0] );
+    assert( wheel_expire( &w, now + 99, &expired ) == 0 );
+    assert( wheel_expire( &w, now + 100, &expired ) == 1 );
+    assert( drain( &expired, timers, now + 100, fired ) == 1 && fired[1] );
+    assert( wheel_expire( &w, now + 4999, &expired ) == 0 );
+    assert( wheel_expire( &w, now + 5000, &expired ) == 1 );
+    assert( drain( &expired, timers, now + 5000, fired ) == 1 && fired[2] );
+    assert( w.ntimer == 0 );
+
+    // nothing linked: jumps to the tick
+    assert( wheel_expire( &w, now + 100000, &expired ) == 0 );
+    assert( w.now == now + 100001 );
+}
+
+
+static void test_del( void )
+{
+    wheel_t w;
+    wheel_timer_t a, b, expired;
+
+    wheel_init( &w, 0 );
+    wheel_timer_init( &a );
+    wheel_timer_init( &b );
+    wheel_add( &w, &a, 70 );
+    wheel_add( &w, &b, 70 );
+    wheel_del( &w, &a );
+    wheel_del( &w, &a );
+    assert( !wheel_pending( &a ) && wheel_pending( &b ) );
+    assert( w.ntimer == 1 );
+
+    // re-add moves the timer
+    wheel_add( &w, &b, 200 );
+    assert( w.ntimer == 1 );
+    assert( wheel_expire( &w, 199, &expired ) == 0 );
+    assert( wheel_expire( &w, 200, &expired ) == 1 );
+    assert( expired.next == &b && b.next == &expired );
+
+    // the farthest tick is clamped
+    wheel_list_del( &b );
+    wheel_add( &w, &b, UINT64_MAX );
+    assert( b.expire == w.now + WHEEL_MAXTICK );
+}
+
+
+static void test_random( void )
+{
+    static wheel_timer_t timers[NTIMER];
+    static int fired[NTIMER];
+    wheel_t w;
+    wheel_timer_t expired;
+    unsigned seed = 1;
+    // start near the boundary of the top level
+    uint64_t now = ( UINT64_C(1) << 24 ) - 100;
+    uint64_t end = now + ( UINT64_C(1) << 20 );
+    size_t n = 0;
+    int i = 0;
+
+    wheel_init( &w, now );
+    for(; i < NTIMER; i++ ){
+        wheel_timer_init( &timers[i] );
+    }
+
+    while( now < end )
+    {
+        // add, re-add and delete the random timers
+        for( i = 0; i < 8; i++ )
+        {
+            wheel_timer_t *t = &timers[rand_r( &seed ) % NTIMER];
+            int r = rand_r( &seed );
+
+            if( r % 5 == 0 ){
+                wheel_del( &w, t );
+            }
+            else {
+                wheel_add( &w, t, now + (uint64_t)( r % ( 1 << ( r % 23 ) ) ) );
+            }
+        }
+
+        now += (uint64_t)( rand_r( &seed ) % 300 );
+        memset( fired, 0, sizeof( fired ) );
+        n = wheel_expire( &w, now, &expired );
+        assert( drain( &expired, timers, now, fired ) == n );
+        // no timer that is due remains linked
+        for( i = 0; i < NTIMER; i++ ){
+            assert( !wheel_pending( &timers[i] ) ||
+                    timers[i].expire > now );
+        }
+    }
+
+    for( i = 0, n = 0; i < NTIMER; i++ ){
+        n += (size_t)wheel_pending( &timers[i] );
+    }
+    assert( n == w.ntimer );
+}
+
+#ifdef TESTS
+
+int main(void)
+{
+    test_order();
+    test_del();
+    test_random();
+    return 0;
+}
+
+#endif